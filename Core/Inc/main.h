@@ -66,9 +66,11 @@ void Error_Handler(void);
 
 /* USER CODE BEGIN EFP */
 void InitSystem(void);
-void TimerCaptureCompare_Callback(void);
-uint32_t getTimeDelay(void);
-void setTime(uint32_t t);
+void TimerUpdate_Callback(void);
+void HeaterFire_Callback(void);
+void ControlTimer_Callback(void);
+void InputTimer_Callback(void);
+void TelemetryTx_Callback(void);
 void setTemp(uint16_t t);
 /* USER CODE END EFP */
 
@@ -86,13 +88,10 @@ void setTemp(uint16_t t);
 #define RIGHT_GPIO_Port GPIOB
 #define DOWN_Pin GPIO_PIN_2
 #define DOWN_GPIO_Port GPIOB
-#define DOWN_EXTI_IRQn EXTI2_IRQn
 #define SELECT_Pin GPIO_PIN_10
 #define SELECT_GPIO_Port GPIOB
-#define SELECT_EXTI_IRQn EXTI15_10_IRQn
 #define UP_Pin GPIO_PIN_11
 #define UP_GPIO_Port GPIOB
-#define UP_EXTI_IRQn EXTI15_10_IRQn
 #define CS2_Pin GPIO_PIN_12
 #define CS2_GPIO_Port GPIOB
 #define CS_Pin GPIO_PIN_15
@@ -102,6 +101,7 @@ void setTemp(uint16_t t);
 #define TCK_Pin GPIO_PIN_14
 #define TCK_GPIO_Port GPIOA
 /* USER CODE BEGIN Private defines */
+#define TELEMETRY_BAUDRATE 115200
 
 /* USER CODE END Private defines */
 
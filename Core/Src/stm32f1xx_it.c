@@ -23,6 +23,9 @@
 #include "stm32f1xx_it.h"
 /* Private includes ----------------------------------------------------------*/
 /* USER CODE BEGIN Includes */
+#include "Timebase.h"
+#include "Trace.h"
+#include "Stack.h"
 /* USER CODE END Includes */
 
 /* Private typedef -----------------------------------------------------------*/
@@ -56,6 +59,9 @@
 /* USER CODE END 0 */
 
 /* External variables --------------------------------------------------------*/
+extern DMA_HandleTypeDef hdma_i2c1_tx;
+extern I2C_HandleTypeDef hi2c1;
+extern DMA_HandleTypeDef hdma_spi2_rx;
 extern SPI_HandleTypeDef hspi2;
 /* USER CODE BEGIN EV */
 
@@ -182,10 +188,11 @@ void PendSV_Handler(void)
 void SysTick_Handler(void)
 {
   /* USER CODE BEGIN SysTick_IRQn 0 */
-
+	Stack_SampleIsr(TRACE_ISR_SYSTICK);
   /* USER CODE END SysTick_IRQn 0 */
   HAL_IncTick();
   /* USER CODE BEGIN SysTick_IRQn 1 */
+  Timebase_Update();
 
   /* USER CODE END SysTick_IRQn 1 */
 }
@@ -198,17 +205,48 @@ void SysTick_Handler(void)
 /******************************************************************************/
 
 /**
-  * @brief This function handles EXTI line2 interrupt.
+  * @brief This function handles DMA1 channel4 global interrupt.
   */
-void EXTI2_IRQHandler(void)
+void DMA1_Channel4_IRQHandler(void)
 {
-  /* USER CODE BEGIN EXTI2_IRQn 0 */
+  /* USER CODE BEGIN DMA1_Channel4_IRQn 0 */
+	Trace_IsrEnter(TRACE_ISR_SPI_DMA);
+  /* USER CODE END DMA1_Channel4_IRQn 0 */
+  HAL_DMA_IRQHandler(&hdma_spi2_rx);
+  /* USER CODE BEGIN DMA1_Channel4_IRQn 1 */
+	Trace_IsrExit(TRACE_ISR_SPI_DMA);
+  /* USER CODE END DMA1_Channel4_IRQn 1 */
+}
 
-  /* USER CODE END EXTI2_IRQn 0 */
-  HAL_GPIO_EXTI_IRQHandler(GPIO_PIN_2);
-  /* USER CODE BEGIN EXTI2_IRQn 1 */
+/**
+  * @brief This function handles DMA1 channel6 global interrupt.
+  */
+void DMA1_Channel6_IRQHandler(void)
+{
+  /* USER CODE BEGIN DMA1_Channel6_IRQn 0 */
+	Trace_IsrEnter(TRACE_ISR_I2C_DMA);
+  /* USER CODE END DMA1_Channel6_IRQn 0 */
+  HAL_DMA_IRQHandler(&hdma_i2c1_tx);
+  /* USER CODE BEGIN DMA1_Channel6_IRQn 1 */
+	Trace_IsrExit(TRACE_ISR_I2C_DMA);
+  /* USER CODE END DMA1_Channel6_IRQn 1 */
+}
 
-  /* USER CODE END EXTI2_IRQn 1 */
+/**
+  * @brief This function handles DMA1 channel7 global interrupt.
+  */
+void DMA1_Channel7_IRQHandler(void)
+{
+  /* USER CODE BEGIN DMA1_Channel7_IRQn 0 */
+	Trace_IsrEnter(TRACE_ISR_TELEMETRY);
+	if(LL_DMA_IsActiveFlag_TC7(DMA1) == 1) {
+		LL_DMA_ClearFlag_TC7(DMA1);
+		TelemetryTx_Callback();
+	}
+  /* USER CODE END DMA1_Channel7_IRQn 0 */
+  /* USER CODE BEGIN DMA1_Channel7_IRQn 1 */
+	Trace_IsrExit(TRACE_ISR_TELEMETRY);
+  /* USER CODE END DMA1_Channel7_IRQn 1 */
 }
 
 /**
@@ -217,58 +255,123 @@ void EXTI2_IRQHandler(void)
 void EXTI9_5_IRQHandler(void)
 {
   /* USER CODE BEGIN EXTI9_5_IRQn 0 */
-
+	Trace_IsrEnter(TRACE_ISR_ZEROCROSS);
   /* USER CODE END EXTI9_5_IRQn 0 */
   HAL_GPIO_EXTI_IRQHandler(GPIO_PIN_7);
   /* USER CODE BEGIN EXTI9_5_IRQn 1 */
-
+	Trace_IsrExit(TRACE_ISR_ZEROCROSS);
   /* USER CODE END EXTI9_5_IRQn 1 */
 }
 
+/**
+  * @brief This function handles TIM1 update interrupt.
+  */
+void TIM1_UP_IRQHandler(void)
+{
+  /* USER CODE BEGIN TIM1_UP_IRQn 0 */
+	Trace_IsrEnter(TRACE_ISR_INPUT);
+	if(LL_TIM_IsActiveFlag_UPDATE(TIM1) == 1) {
+		LL_TIM_ClearFlag_UPDATE(TIM1);
+		InputTimer_Callback();
+	}
+  /* USER CODE END TIM1_UP_IRQn 0 */
+  /* USER CODE BEGIN TIM1_UP_IRQn 1 */
+	Trace_IsrExit(TRACE_ISR_INPUT);
+  /* USER CODE END TIM1_UP_IRQn 1 */
+}
+
+/**
+  * @brief This function handles TIM2 global interrupt.
+  */
+void TIM2_IRQHandler(void)
+{
+  /* USER CODE BEGIN TIM2_IRQn 0 */
+	Trace_IsrEnter(TRACE_ISR_CONTROL);
+	if(LL_TIM_IsActiveFlag_UPDATE(TIM2) == 1) {
+		LL_TIM_ClearFlag_UPDATE(TIM2);
+		ControlTimer_Callback();
+	}
+  /* USER CODE END TIM2_IRQn 0 */
+  /* USER CODE BEGIN TIM2_IRQn 1 */
+	Trace_IsrExit(TRACE_ISR_CONTROL);
+  /* USER CODE END TIM2_IRQn 1 */
+}
+
 /**
   * @brief This function handles TIM3 global interrupt.
   */
 void TIM3_IRQHandler(void)
 {
   /* USER CODE BEGIN TIM3_IRQn 0 */
+	Trace_IsrEnter(TRACE_ISR_GATE);
 	if(LL_TIM_IsActiveFlag_CC1(TIM3) == 1) {
 		LL_TIM_ClearFlag_CC1(TIM3);
-		TimerCaptureCompare_Callback();
+		HeaterFire_Callback();
 	}
 
   /* USER CODE END TIM3_IRQn 0 */
   /* USER CODE BEGIN TIM3_IRQn 1 */
-
+	Trace_IsrExit(TRACE_ISR_GATE);
   /* USER CODE END TIM3_IRQn 1 */
 }
 
 /**
-  * @brief This function handles SPI2 global interrupt.
+  * @brief This function handles TIM4 global interrupt.
   */
-void SPI2_IRQHandler(void)
+void TIM4_IRQHandler(void)
 {
-  /* USER CODE BEGIN SPI2_IRQn 0 */
-
-  /* USER CODE END SPI2_IRQn 0 */
-  HAL_SPI_IRQHandler(&hspi2);
-  /* USER CODE BEGIN SPI2_IRQn 1 */
-
-  /* USER CODE END SPI2_IRQn 1 */
+  /* USER CODE BEGIN TIM4_IRQn 0 */
+	Trace_IsrEnter(TRACE_ISR_SENSOR_TIMER);
+	if(LL_TIM_IsActiveFlag_UPDATE(TIM4) == 1) {
+		LL_TIM_ClearFlag_UPDATE(TIM4);
+		TimerUpdate_Callback();
+	}
+  /* USER CODE END TIM4_IRQn 0 */
+  /* USER CODE BEGIN TIM4_IRQn 1 */
+	Trace_IsrExit(TRACE_ISR_SENSOR_TIMER);
+  /* USER CODE END TIM4_IRQn 1 */
 }
 
 /**
-  * @brief This function handles EXTI line[15:10] interrupts.
+  * @brief This function handles I2C1 event interrupt.
   */
-void EXTI15_10_IRQHandler(void)
+void I2C1_EV_IRQHandler(void)
 {
-  /* USER CODE BEGIN EXTI15_10_IRQn 0 */
+  /* USER CODE BEGIN I2C1_EV_IRQn 0 */
+	Trace_IsrEnter(TRACE_ISR_I2C);
+  /* USER CODE END I2C1_EV_IRQn 0 */
+  HAL_I2C_EV_IRQHandler(&hi2c1);
+  /* USER CODE BEGIN I2C1_EV_IRQn 1 */
+	Trace_IsrExit(TRACE_ISR_I2C);
+  /* USER CODE END I2C1_EV_IRQn 1 */
+}
 
-  /* USER CODE END EXTI15_10_IRQn 0 */
-  HAL_GPIO_EXTI_IRQHandler(GPIO_PIN_10);
-  HAL_GPIO_EXTI_IRQHandler(GPIO_PIN_11);
-  /* USER CODE BEGIN EXTI15_10_IRQn 1 */
+/**
+  * @brief This function handles I2C1 error interrupt.
+  */
+void I2C1_ER_IRQHandler(void)
+{
+  /* USER CODE BEGIN I2C1_ER_IRQn 0 */
+	Trace_IsrEnter(TRACE_ISR_I2C_ERROR);
+  /* USER CODE END I2C1_ER_IRQn 0 */
+  HAL_I2C_ER_IRQHandler(&hi2c1);
+  /* USER CODE BEGIN I2C1_ER_IRQn 1 */
+	Trace_IsrExit(TRACE_ISR_I2C_ERROR);
+  /* USER CODE END I2C1_ER_IRQn 1 */
+}
 
-  /* USER CODE END EXTI15_10_IRQn 1 */
+/**
+  * @brief This function handles SPI2 global interrupt.
+  */
+void SPI2_IRQHandler(void)
+{
+  /* USER CODE BEGIN SPI2_IRQn 0 */
+	Trace_IsrEnter(TRACE_ISR_SPI);
+  /* USER CODE END SPI2_IRQn 0 */
+  HAL_SPI_IRQHandler(&hspi2);
+  /* USER CODE BEGIN SPI2_IRQn 1 */
+	Trace_IsrExit(TRACE_ISR_SPI);
+  /* USER CODE END SPI2_IRQn 1 */
 }
 
 /* USER CODE BEGIN 1 */
@@ -0,0 +1,131 @@
+/*******************************************************************************
+ * Copyright (C) 2019 Julian Hellner - All Rights Reserved
+ *
+ * The file Autotune.h is part of Reflow.
+ *
+ * Unauthorized copying of this file, via any medium is strictly prohibited
+ * Proprietary and confidential
+ *
+ * Written by Julian Hellner <hellnerjulian@gmail.com>, Jul 22, 2019
+ *
+ ******************************************************************************/
+
+#ifndef AUTOTUNE_H_
+#define AUTOTUNE_H_
+
+#include "stm32f1xx_hal.h"
+#include "FixedPoint.h"
+#include "Sensors/SampleHistory.h"
+
+#define AUTOTUNE_TEMPRATURE 150 // °C used when no setpoint is chosen
+#define AUTOTUNE_HYSTERESIS 1 // °C around the setpoint, keeps noise from toggling the relay
+#define AUTOTUNE_SKIP 1 // First cycles are not measured, the oscillation still settles
+#define AUTOTUNE_CYCLES 4 // Measured cycles
+#define AUTOTUNE_TIMEOUT 3600000 // ms
+
+typedef enum {
+	AUTOTUNE_IDLE,
+	AUTOTUNE_HEATING, // Full power until the setpoint is crossed the first time
+	AUTOTUNE_RELAY, // Relay oscillation around the setpoint
+	AUTOTUNE_DONE,
+	AUTOTUNE_FAILED
+} AUTOTUNE_STATE_t;
+
+typedef enum {
+	TUNING_ZIEGLER_NICHOLS, // Classic, fast but about 25 % overshoot
+	TUNING_TYREUS_LUYBEN, // Slower integral, little overshoot
+	TUNING_SOME_OVERSHOOT,
+	TUNING_NO_OVERSHOOT,
+	TUNING_RULE_COUNT
+} TUNING_RULE_t;
+
+/**
+ * Relay feedback experiment after Åström and Hägglund
+ *
+ * @note the relay switches the heater between two powers around the setpoint,
+ * the oscillation gives the ultimate gain Ku = 4d/(pi*sqrt(a^2 - e^2)) and
+ * the ultimate period Pu
+ */
+class Autotune {
+private:
+	AUTOTUNE_STATE_t state;
+	Q16_16 setpoint;
+	uint8_t high; // Relay powers in %
+	uint8_t low;
+	uint8_t relayOn;
+	uint32_t startTick;
+	uint32_t lastTick; // Tick of the last sample used
+	uint32_t lastSwitch; // Tick the relay last switched on
+	uint8_t switches;
+	Q16_16 maxX; // Extremes since the relay last switched on
+	Q16_16 minX;
+	uint8_t cycles;
+	uint32_t periodSum; // ms
+	Q16_16 amplitudeSum; // °C
+	Q16_16 ultimateGain;
+	uint32_t ultimatePeriod; // ms
+
+	void finish(void);
+public:
+	/**
+	 * Initializes an idle tuner
+	 */
+	Autotune(void);
+	/**
+	 * Starts the experiment
+	 *
+	 * @param setpoint: Temprature the oven oscillates around in °C
+	 * @param high: Relay power above in %
+	 * @param low: Relay power below in %
+	 */
+	void start(uint16_t setpoint, uint8_t high, uint8_t low);
+	/**
+	 * Runs the relay with the newest sample
+	 *
+	 * @note needs to be called in the control loop, every sample is only used once
+	 * @param *history: Samples of the controlled thermocouple
+	 * @returns heater power in %
+	 */
+	uint8_t update(SampleHistory *history);
+	/**
+	 * Returns the state of the experiment
+	 *
+	 * @returns @ref AUTOTUNE_STATE_t state
+	 */
+	AUTOTUNE_STATE_t getState(void);
+	/**
+	 * Returns the temprature the relay switches around
+	 *
+	 * @returns setpoint in °C
+	 */
+	uint16_t getSetpoint(void);
+	/**
+	 * Returns the number of measured cycles
+	 *
+	 * @returns cycles, AUTOTUNE_CYCLES when done
+	 */
+	uint8_t getCycles(void);
+	/**
+	 * Returns the ultimate gain
+	 *
+	 * @returns Ku in % per °C
+	 */
+	Q16_16 getUltimateGain(void);
+	/**
+	 * Returns the ultimate period
+	 *
+	 * @returns Pu in ms
+	 */
+	uint32_t getUltimatePeriod(void);
+	/**
+	 * Calculates PID gains from the ultimate gain and period
+	 *
+	 * @param rule: @ref TUNING_RULE_t tuning rule
+	 * @param *kp: Proportional gain in % per °C
+	 * @param *ki: Integral gain in % per °C s
+	 * @param *kd: Derivative gain in % per °C/s
+	 */
+	void getGains(TUNING_RULE_t rule, Q16_16 *kp, Q16_16 *ki, Q16_16 *kd);
+};
+
+#endif /* AUTOTUNE_H_ */
@@ -0,0 +1,108 @@
+/*******************************************************************************
+ * Copyright (C) 2019 Julian Hellner - All Rights Reserved
+ *
+ * The file ControlLoop.h is part of Reflow.
+ *
+ * Unauthorized copying of this file, via any medium is strictly prohibited
+ * Proprietary and confidential
+ *
+ * Written by Julian Hellner <hellnerjulian@gmail.com>, Jul 24, 2019
+ *
+ ******************************************************************************/
+
+#ifndef CONTROLLOOP_H_
+#define CONTROLLOOP_H_
+
+#include "main.h"
+
+#define CONTROL_TIMER_CLOCK 100000 // Hz after the prescaler (TIM2 runs at 100 kHz)
+#define CONTROL_PERIOD_MAX 655 // ms, 16 bit reload
+
+/**
+ * Runs the control step from a timer interrupt at a fixed rate
+ *
+ * @note the step runs in interrupt context, the main loop has to lock()
+ * while it changes state the step uses
+ */
+class ControlLoop {
+private:
+	TIM_TypeDef *tim;
+	IRQn_Type irq;
+	void (*step)(void);
+	uint32_t period; // ms
+	volatile uint32_t runs;
+	volatile uint32_t overruns;
+	volatile uint32_t worstCycles; // Longest step in CPU cycles
+	volatile uint32_t worstLatency; // Latest start after the update in timer ticks
+public:
+	/**
+	 * Initializes the control loop, the timer is not started yet
+	 *
+	 * @note the timer must be set up as up counter at CONTROL_TIMER_CLOCK
+	 * with its update interrupt enabled in the NVIC
+	 *
+	 * @param *tim: Timer pacing the steps
+	 * @param irq: Interrupt of the timer
+	 * @param *step: Function run every period, in interrupt context
+	 * @param period: Period in ms, CONTROL_PERIOD_MAX at most
+	 */
+	ControlLoop(TIM_TypeDef *tim, IRQn_Type irq, void (*step)(void), uint32_t period);
+	/**
+	 * Starts the timer, the first step runs one period later
+	 */
+	void start(void);
+	/**
+	 * Stops the timer, a running step finishes
+	 */
+	void stop(void);
+	/**
+	 * Returns the period
+	 *
+	 * @returns period in ms
+	 */
+	uint32_t getPeriod(void);
+	/**
+	 * Holds back the step, e.g. while the main loop starts a profile
+	 *
+	 * @note a step that gets due meanwhile runs late on unlock(), keep it short
+	 */
+	void lock(void);
+	/**
+	 * Lets the step run again
+	 */
+	void unlock(void);
+	/**
+	 * Returns the number of steps run
+	 *
+	 * @returns steps
+	 */
+	uint32_t getRuns(void);
+	/**
+	 * Returns the number of steps that did not finish within their period
+	 *
+	 * @returns overruns
+	 */
+	uint32_t getOverruns(void);
+	/**
+	 * Returns the longest runtime of a step
+	 *
+	 * @returns worst case execution time in µs
+	 */
+	uint32_t getWorstRuntime(void);
+	/**
+	 * Returns the largest delay of a step after its timer update
+	 *
+	 * @returns latency in µs
+	 */
+	uint32_t getWorstLatency(void);
+	/**
+	 * Clears the runtime, latency and overrun statistics
+	 */
+	void resetStats(void);
+	/**
+	 * Handles the update interrupt of the timer, runs the step
+	 */
+	void __handleTimerUpdate(void);
+};
+
+#endif /* CONTROLLOOP_H_ */
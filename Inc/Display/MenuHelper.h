@@ -18,6 +18,8 @@
 #include "Display/SSD1306v2.h"
 #include "Display/fonts.h"
 #include "ProfileController.h"
+#include "Input.h"
+#include "Settings.h"
 
 typedef struct {
 	uint8_t id;
@@ -45,9 +47,11 @@ private:
 	OvenHelper *oven;
 	SSD1306 *display;
 	uint8_t active;
+	uint8_t redraw;
 	PAGE_t activePage;
 	uint8_t activeElement;
 	MODE_t mode;
+	Settings *settings;
 	/**
 	 * Internal function to draw the Mode Selection to RAM
 	 */
@@ -64,6 +68,12 @@ public:
 	 * @param *display: to show menu on
 	 */
 	MenuHelper(OvenHelper *oven, SSD1306 *display);
+	/**
+	 * Sets where the tuning rule is read from and stored
+	 *
+	 * @param *settings: Persistent settings, NULL hides the rule
+	 */
+	void setSettings(Settings *settings);
 	/**
 	 * Returns wheter Menu is active or not
 	 *
@@ -73,6 +83,8 @@ public:
 	/**
 	 * Sets menu active or not
 	 *
+	 * @note activating the menu marks it for redraw
+	 *
 	 * @param active: boolean active or not
 	 */
 	void setActive(uint8_t active);
@@ -82,15 +94,26 @@ public:
 	 */
 	MODE_t getMode(void);
 	/**
-	 * Function to draw Menu to RAM
+	 * Returns wheter the menu changed since it was last shown
+	 *
+	 * @returns boolean redraw needed
+	 */
+	uint8_t needsRedraw(void);
+	/**
+	 * Draws the menu and starts sending it to the display
+	 *
+	 * @note stays marked for redraw while the previous frame is still in flight
 	 */
 	void showMenu(void);
 	/**
-	 * Function to handle button pushes on interrupts
+	 * Handles a button press, only changes the menu state
+	 *
+	 * @note the menu is drawn by the next showMenu(), so several presses
+	 * cost one redraw
 	 *
-	 * @param GPIO_PIN: GPIO pin with interrupt
+	 * @param key: @ref INPUT_KEY_t pressed key
 	 */
-	void buttonHandler(uint16_t GPIO_PIN);
+	void buttonHandler(INPUT_KEY_t key);
 
 };
 
@@ -0,0 +1,18 @@
+/* Generated by Tools/bitmap2pages.py from Src/Display/fonts.c, Src/Display/Sprite.cpp, do not edit */
+
+#ifndef DISPLAY_PAGEFONTS_H_
+#define DISPLAY_PAGEFONTS_H_
+
+#include "Display/fonts.h"
+#include "Display/Sprite.h"
+
+extern const PageFontDef_t PageFont_7x10;
+extern const PageFontDef_t PageFont_11x18;
+extern const PageFontDef_t PageFont_16x26;
+extern const PageSpriteDef_t PageBootlogo;
+extern const PageSpriteDef_t PageAnimation1;
+extern const PageSpriteDef_t PageAnimation2;
+extern const PageSpriteDef_t PageAnimation3;
+extern const PageSpriteDef_t PageAnimation4;
+
+#endif /* DISPLAY_PAGEFONTS_H_ */
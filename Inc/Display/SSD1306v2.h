@@ -17,12 +17,15 @@
 
 #include "fonts.h"
 #include "Display/Sprite.h"
+#include "Display/PageFonts.h"
 
 #include "stdlib.h"
 #include "string.h"
 
 #define SSD1306_WIDTH 128
 #define SSD1306_HEIGHT 64
+#define SSD1306_PAGES (SSD1306_HEIGHT/8)
+#define SSD1306_BUFFERSIZE (SSD1306_WIDTH*SSD1306_PAGES)
 
 typedef enum {
 	BLACK = 0x00, /*!< Black color, no pixel */
@@ -36,6 +39,19 @@ typedef enum {
 	CENTER = 0x03
 } ALIGMENT_t;
 
+typedef enum {
+	FLUSH_BLOCKING = 0x00, /*!< Polled transfer, returns when the frame is on the display */
+	FLUSH_DMA = 0x01,      /*!< Whole frame in one DMA transfer, returns immediately */
+	FLUSH_DIRTY = 0x02     /*!< Only changed column spans per page via DMA, returns immediately */
+} FLUSH_MODE_t;
+
+typedef struct {
+	uint8_t x0;    /*!< Start column */
+	uint8_t x1;    /*!< End column */
+	uint8_t page0; /*!< Start page */
+	uint8_t page1; /*!< End page */
+} SSD1306_WINDOW_t;
+
 #define SSD1306_MEMORYMODE          0x20 ///< See datasheet
 #define SSD1306_COLUMNADDR          0x21 ///< See datasheet
 #define SSD1306_PAGEADDR            0x22 ///< See datasheet
@@ -77,6 +93,7 @@ class I2C {
 private:
 	I2C_HandleTypeDef *hi2c;
 	uint8_t address;
+	uint32_t bytesSent;
 public:
 	/**
 	 * Initializes SSD1306 I²C communication
@@ -100,17 +117,55 @@ public:
 	 * @param  count: how many bytes will be written
 	 */
 	void writeMulti(uint8_t reg, uint8_t *data, uint16_t count);
+	/**
+	 * Writes multi bytes to slave using DMA
+	 *
+	 * @note   data must stay valid until the transfer completed
+	 * @param  reg: register to write to
+	 * @param  *data: pointer to data array to write it to slave
+	 * @param  count: how many bytes will be written
+	 * @returns HAL_OK when transfer was started
+	 */
+	HAL_StatusTypeDef writeMultiDMA(uint8_t reg, uint8_t *data, uint16_t count);
+	/**
+	 * Returns whether a transfer is in progress
+	 *
+	 * @returns boolean: bus busy
+	 */
+	uint8_t isBusy(void);
+	/**
+	 * Returns the amount of bytes sent to the slave, control bytes included
+	 *
+	 * @returns bytes sent since last reset
+	 */
+	uint32_t getBytesSent(void);
+	/**
+	 * Resets the sent bytes counter
+	 */
+	void resetBytesSent(void);
 };
 
 class SSD1306 {
 private:
-	I2C *i2c;
+	I2C i2c;
 	uint16_t width;
 	uint16_t height;
 	uint16_t currentX;
 	uint16_t currentY;
 	uint8_t inverted;
-	uint8_t buffer [SSD1306_WIDTH*SSD1306_HEIGHT/8];
+	uint8_t buffer [SSD1306_BUFFERSIZE];
+	uint8_t frame [SSD1306_BUFFERSIZE];
+	uint8_t frameValid;
+	uint8_t dirtyStart [SSD1306_PAGES];
+	uint8_t dirtyEnd [SSD1306_PAGES];
+	SSD1306_WINDOW_t flushSpans [SSD1306_PAGES];
+	uint8_t flushCount;
+	uint8_t flushIndex;
+	uint8_t flushStage;
+	uint8_t windowCmd [6];
+	volatile uint8_t flushing;
+	void (*flushCallback)(void);
+	volatile uint32_t flushErrors;
 	/**
 	 * Shortcut for writing commands to register 0x00
 	 *
@@ -123,6 +178,57 @@ private:
 	 * @param  data: Data to be send
 	 */
 	void writeData(uint8_t data);
+	/**
+	 * Sets column and page window for horizontal addressing mode
+	 *
+	 * @param  x0: Start column
+	 * @param  x1: End column
+	 * @param  p0: Start page
+	 * @param  p1: End page
+	 */
+	void setWindow(uint8_t x0, uint8_t x1, uint8_t p0, uint8_t p1);
+	/**
+	 * Marks columns of a page as changed since the last flush
+	 *
+	 * @param  x0: First changed column
+	 * @param  x1: Last changed column
+	 * @param  page: Page of the columns
+	 */
+	void markDirty(uint8_t x0, uint8_t x1, uint8_t page);
+	/**
+	 * Marks the entire display as changed since the last flush
+	 */
+	void markAllDirty(void);
+	/**
+	 * Starts the next transfer of the pending flush spans
+	 *
+	 * @note a transfer that fails to start ends the flush and counts as error
+	 * @returns 1 when a transfer was started, 0 when all spans were sent or on error
+	 */
+	uint8_t flushNext(void);
+	/**
+	 * Writes vertical pixel columns into the page buffer
+	 *
+	 * @note   Clipping is done once for the whole block, cleared bits are drawn with the opposite color
+	 * @param  x: X location of the first column
+	 * @param  y: Y location of the top row
+	 * @param  *columns: Pixel columns, bit n is row n
+	 * @param  w: Number of columns
+	 * @param  h: Number of rows, max 32
+	 * @param  color: Color used for set bits. This parameter can be a value of @ref SSD1306_COLOR_t enumeration
+	 */
+	void blitColumns(uint16_t x, uint16_t y, const uint32_t *columns, uint8_t w, uint8_t h, SSD1306_COLOR_t color);
+	/**
+	 * Draws a row major bit stream (sprites, images) with the column blitter
+	 *
+	 * @param  *data: Bit stream, MSB first, rows are not padded
+	 * @param  w: Width of the image
+	 * @param  h: Height of the image
+	 * @param  xloc: X location
+	 * @param  yloc: Y location
+	 * @param  color: Color used for drawing. This parameter can be a value of @ref SSD1306_COLOR_t enumeration
+	 */
+	void blitStream(const uint16_t *data, uint16_t w, uint16_t h, uint16_t xloc, uint16_t yloc, SSD1306_COLOR_t color);
 public:
 	/**
 	 * Initializes SSD1306 OLED display
@@ -137,6 +243,57 @@ public:
 	 * @note   This function must be called each time you do some changes to display, to update buffer from RAM to display
 	 */
 	void updateScreen(void);
+	/**
+	 * Updates buffer from internal RAM to display with the selected transfer mode
+	 *
+	 * @note   With @ref FLUSH_DMA and @ref FLUSH_DIRTY the current frame is sent from a second buffer, drawing can continue immediately
+	 * @param  mode: @ref FLUSH_MODE_t transfer mode
+	 * @returns HAL_OK when the frame was sent/started, HAL_BUSY when the previous frame is still in flight
+	 */
+	HAL_StatusTypeDef updateScreen(FLUSH_MODE_t mode);
+	/**
+	 * Returns whether a frame is currently being transferred
+	 *
+	 * @returns boolean: transfer in progress
+	 */
+	uint8_t isFlushing(void);
+	/**
+	 * Sets function called when a DMA frame transfer finished
+	 *
+	 * @note   callback is called from interrupt context, not for a failed frame
+	 * @param  *callback: function to be called, NULL to disable
+	 */
+	void setFlushCallback(void (*callback)(void));
+	/**
+	 * Handles the callback when a DMA frame transfer finished
+	 *
+	 * @param *hi2c: I2C
+	 */
+	void __handleI2C_TxCallback(I2C_HandleTypeDef *hi2c);
+	/**
+	 * Handles the callback when a DMA transfer failed
+	 *
+	 * @param *hi2c: I2C
+	 */
+	void __handleI2C_ErrorCallback(I2C_HandleTypeDef *hi2c);
+	/**
+	 * Returns the number of DMA frame transfers that failed
+	 *
+	 * @note   the display is sent completely with the next frame after an error
+	 * @returns failed frames since boot
+	 */
+	uint32_t getFlushErrors(void);
+	/**
+	 * Returns the amount of bytes sent to the display
+	 *
+	 * @note   Used to measure the savings of @ref FLUSH_DIRTY
+	 * @returns bytes sent since last reset
+	 */
+	uint32_t getBytesSent(void);
+	/**
+	 * Resets the sent bytes counter
+	 */
+	void resetBytesSent(void);
 	/**
 	 * Toggles pixels inversion inside internal RAM
 	 *
@@ -206,6 +363,29 @@ public:
 	 * @param  yloc: Y location. This parameter can be a value between 0 and this height - 1
 	 */
 	void drawSprite(const SpriteDef_t *image, SSD1306_COLOR_t color, uint16_t xloc, uint16_t yloc);
+	/**
+	 * Draws page ordered bitmap to specific location internal RAM
+	 *
+	 * @note   @ref updateScreen() must be called after that in order to see updated display screen
+	 * @param  *pages: Bitmap in display layout, (height+7)/8 rows of stride bytes, bit 0 is the top pixel
+	 * @param  w: Width of bitmap, columns drawn from each row
+	 * @param  stride: Bytes per row of the bitmap, at least w
+	 * @param  h: Height of bitmap
+	 * @param  color: Color used for drawing. This parameter can be a value of @ref SSD1306_COLOR_t enumeration
+	 * @param  xloc: X location. This parameter can be a value between 0 and this width - 1
+	 * @param  yloc: Y location. This parameter can be a value between 0 and this height - 1
+	 */
+	void drawBitmap(const uint8_t *pages, uint8_t w, uint8_t stride, uint8_t h, SSD1306_COLOR_t color, uint16_t xloc, uint16_t yloc);
+	/**
+	 * Draws page layout Sprite to specific location internal RAM
+	 *
+	 * @note   @ref updateScreen() must be called after that in order to see updated display screen
+	 * @param  *image: @ref PageSpriteDef_t Pointer to Sprite
+	 * @param  color: Color used for drawing. This parameter can be a value of @ref SSD1306_COLOR_t enumeration
+	 * @param  xloc: X location. This parameter can be a value between 0 and this width - 1
+	 * @param  yloc: Y location. This parameter can be a value between 0 and this height - 1
+	 */
+	void drawSprite(const PageSpriteDef_t *image, SSD1306_COLOR_t color, uint16_t xloc, uint16_t yloc);
 	/**
 	 * Puts character to internal RAM
 	 *
@@ -216,6 +396,16 @@ public:
 	 * @returns Character written
 	 */
 	char putC(char ch, FontDef_t* font, SSD1306_COLOR_t color);
+	/**
+	 * Puts character from a page layout font to internal RAM
+	 *
+	 * @note   @ref updateScreen() must be called after that in order to see updated display screen
+	 * @param  ch: Character to be written
+	 * @param  *Font: Pointer to @ref PageFontDef_t structure with used font
+	 * @param  color: Color used for drawing. This parameter can be a value of @ref SSD1306_COLOR_t enumeration
+	 * @returns Character written
+	 */
+	char putC(char ch, const PageFontDef_t* font, SSD1306_COLOR_t color);
 	/**
 	 * Puts string to internal RAM
 	 *
@@ -238,6 +428,28 @@ public:
 	 * @returns Zero on success or character value when function failed
 	 */
 	char putS(char* str, FontDef_t* font, SSD1306_COLOR_t color, ALIGMENT_t aligment);
+	/**
+	 * Puts string from a page layout font to internal RAM
+	 *
+	 * @note   @ref updateScreen() must be called after that in order to see updated display screen
+	 * @param  *str: String to be written
+	 * @param  *Font: Pointer to @ref PageFontDef_t structure with used font
+	 * @param  color: Color used for drawing. This parameter can be a value of @ref SSD1306_COLOR_t enumeration
+	 * @returns Zero on success or character value when function failed
+	 */
+	char putS(const char* str, const PageFontDef_t* font, SSD1306_COLOR_t color);
+	/**
+	 * Puts string from a page layout font with alignment to internal RAM
+	 *
+	 * @note   currentPosition will be (partly) ignored
+	 * @note   @ref updateScreen() must be called after that in order to see updated display screen
+	 * @param  *str: String to be written
+	 * @param  *Font: Pointer to @ref PageFontDef_t structure with used font
+	 * @param  color: Color used for drawing. This parameter can be a value of @ref SSD1306_COLOR_t enumeration
+	 * @param  aligment: @ref ALIGMENT_t aligment on i.e. horizontal/vertical center
+	 * @returns Zero on success or character value when function failed
+	 */
+	char putS(const char* str, const PageFontDef_t* font, SSD1306_COLOR_t color, ALIGMENT_t aligment);
 	/**
 	 * Draws line on display
 	 *
@@ -21,6 +21,12 @@ typedef struct {
 	const uint16_t *data;
 } SpriteDef_t;
 
+typedef struct {
+	uint8_t spriteWidth;
+	uint8_t spriteHeight;
+	const uint8_t *data; /*!< (spriteHeight+7)/8 rows of spriteWidth bytes, generated by Tools/bitmap2pages.py */
+} PageSpriteDef_t;
+
 extern SpriteDef_t bootlogo;
 extern SpriteDef_t animation1;
 extern SpriteDef_t animation2;
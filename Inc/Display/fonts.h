@@ -56,6 +56,20 @@ typedef struct {
 	const uint16_t *data; /*!< Pointer to data font data array */
 } FontDef_t;
 
+/**
+ * @brief  Font structure in SSD1306 page layout, generated by Tools/bitmap2pages.py
+ * @note   Glyph n starts at data[n * FontWidth * ((FontHeight+7)/8)], bit 0 is the top pixel
+ */
+typedef struct {
+	uint8_t FontWidth;     /*!< Glyph cell width in pixels */
+	uint8_t FontHeight;    /*!< Glyph cell height in pixels */
+	uint8_t first;         /*!< Character of the first glyph */
+	uint8_t count;         /*!< Number of glyphs */
+	uint8_t degree;        /*!< Index of the degree sign glyph */
+	const uint8_t *widths; /*!< Advance of every glyph in pixels */
+	const uint8_t *data;   /*!< Glyphs in page layout */
+} PageFontDef_t;
+
 /** 
  * @brief  String length and height 
  */
@@ -0,0 +1,81 @@
+/*******************************************************************************
+ * Copyright (C) 2019 Julian Hellner - All Rights Reserved
+ *
+ * The file FeedForward.h is part of Reflow.
+ *
+ * Unauthorized copying of this file, via any medium is strictly prohibited
+ * Proprietary and confidential
+ *
+ * Written by Julian Hellner <hellnerjulian@gmail.com>, Jul 21, 2019
+ *
+ ******************************************************************************/
+
+#ifndef FEEDFORWARD_H_
+#define FEEDFORWARD_H_
+
+#include "stm32f1xx_hal.h"
+#include "FixedPoint.h"
+
+#define FEEDFORWARD_POINTS 13
+#define FEEDFORWARD_STEP 25 // °C between table entries, first entry at 0 °C
+
+/**
+ * Power the oven needs to follow a planned setpoint:
+ * u = loss(w) + gain * dw/dt
+ *
+ * @note loss and gain are fitted from logged runs with Tools/ff_fit.py
+ */
+class FeedForward {
+private:
+	uint16_t table[FEEDFORWARD_POINTS]; // Power holding the temprature in 0.1 %
+	Q16_16 gain; // % power per °C/s
+	uint32_t lead; // ms the setpoint is looked ahead
+public:
+	/**
+	 * Initializes the model with the default fit
+	 */
+	FeedForward(void);
+	/**
+	 * Sets the steady state heat loss
+	 *
+	 * @param *table: FEEDFORWARD_POINTS powers in 0.1 %, every FEEDFORWARD_STEP °C from 0 °C
+	 */
+	void setTable(const uint16_t *table);
+	/**
+	 * Sets the thermal gain
+	 *
+	 * @param gain: Power in % needed per °C/s of heating rate
+	 */
+	void setGain(Q16_16 gain);
+	/**
+	 * Sets how far the planned setpoint is looked ahead
+	 *
+	 * @note should match the dead time of the oven
+	 *
+	 * @param lead: Time in ms
+	 */
+	void setLead(uint32_t lead);
+	/**
+	 * Returns how far the planned setpoint is looked ahead
+	 *
+	 * @returns time in ms
+	 */
+	uint32_t getLead(void);
+	/**
+	 * Returns the power holding a temprature
+	 *
+	 * @param w: Temprature in °C
+	 * @returns power in %
+	 */
+	Q16_16 getLoss(Q16_16 w);
+	/**
+	 * Calculates the feed-forward power
+	 *
+	 * @param w: Planned setpoint in °C
+	 * @param slope: Planned rate of the setpoint in °C/s
+	 * @returns power in % (0-100)
+	 */
+	Q16_16 compute(Q16_16 w, Q16_16 slope);
+};
+
+#endif /* FEEDFORWARD_H_ */
@@ -0,0 +1,86 @@
+/*******************************************************************************
+ * Copyright (C) 2019 Julian Hellner - All Rights Reserved
+ *
+ * The file FixedPoint.h is part of Reflow.
+ *
+ * Unauthorized copying of this file, via any medium is strictly prohibited
+ * Proprietary and confidential
+ *
+ * Written by Julian Hellner <hellnerjulian@gmail.com>, 10.07.2019
+ *
+ ******************************************************************************/
+
+#ifndef FIXEDPOINT_H_
+#define FIXEDPOINT_H_
+
+#include <stdint.h>
+
+/**
+ * Signed 32 bit fixed point number with FRAC fraction bits
+ *
+ * @note the Cortex-M3 has no FPU, all operations are integer only.
+ * Products and quotients are calculated in 64 bit and are not saturated.
+ */
+template<uint8_t FRAC>
+class FixedPoint {
+private:
+	int32_t value;
+public:
+	static constexpr int32_t ONE = (int32_t)1 << FRAC;
+
+	constexpr FixedPoint() : value(0) {}
+	constexpr FixedPoint(int v) : value(v * ONE) {}
+	/**
+	 * Converts a float, rounding to the nearest step
+	 *
+	 * @note uses soft-float, meant for constants and configuration only
+	 */
+	constexpr explicit FixedPoint(float v) : value((int32_t)(v * ONE + (v < 0 ? -0.5f : 0.5f))) {}
+
+	/**
+	 * Creates a number from its raw representation
+	 *
+	 * @param raw: value scaled by 2^FRAC
+	 */
+	static constexpr FixedPoint fromRaw(int32_t raw) {
+		FixedPoint f;
+		f.value = raw;
+		return f;
+	}
+	/**
+	 * Creates the quotient of two integers
+	 *
+	 * @param num: Numerator
+	 * @param den: Denominator, must not be zero
+	 */
+	static constexpr FixedPoint fromRatio(int32_t num, int32_t den) {
+		return fromRaw((int32_t)(((int64_t)num * ONE) / den));
+	}
+	constexpr int32_t raw() const { return value; }
+
+	/** Truncates towards zero like a float to int cast */
+	constexpr explicit operator int() const { return value / ONE; }
+	constexpr explicit operator float() const { return (float)value / ONE; }
+
+	constexpr FixedPoint operator-() const { return fromRaw(-value); }
+	constexpr FixedPoint operator+(FixedPoint b) const { return fromRaw(value + b.value); }
+	constexpr FixedPoint operator-(FixedPoint b) const { return fromRaw(value - b.value); }
+	constexpr FixedPoint operator*(FixedPoint b) const { return fromRaw((int32_t)(((int64_t)value * b.value) >> FRAC)); }
+	constexpr FixedPoint operator/(FixedPoint b) const { return fromRaw((int32_t)(((int64_t)value * ONE) / b.value)); }
+
+	FixedPoint& operator+=(FixedPoint b) { value += b.value; return *this; }
+	FixedPoint& operator-=(FixedPoint b) { value -= b.value; return *this; }
+	FixedPoint& operator*=(FixedPoint b) { return *this = *this * b; }
+	FixedPoint& operator/=(FixedPoint b) { return *this = *this / b; }
+
+	constexpr bool operator==(FixedPoint b) const { return value == b.value; }
+	constexpr bool operator!=(FixedPoint b) const { return value != b.value; }
+	constexpr bool operator<(FixedPoint b) const { return value < b.value; }
+	constexpr bool operator>(FixedPoint b) const { return value > b.value; }
+	constexpr bool operator<=(FixedPoint b) const { return value <= b.value; }
+	constexpr bool operator>=(FixedPoint b) const { return value >= b.value; }
+};
+
+typedef FixedPoint<16> Q16_16;
+
+#endif /* FIXEDPOINT_H_ */
@@ -0,0 +1,147 @@
+/*******************************************************************************
+ * Copyright (C) 2019 Julian Hellner - All Rights Reserved
+ *
+ * The file HeaterDriver.h is part of Reflow.
+ *
+ * Unauthorized copying of this file, via any medium is strictly prohibited
+ * Proprietary and confidential
+ *
+ * Written by Julian Hellner <hellnerjulian@gmail.com>, Jul 13, 2019
+ *
+ ******************************************************************************/
+
+#ifndef HEATERDRIVER_H_
+#define HEATERDRIVER_H_
+
+#include "main.h"
+
+#define HEATER_POWER_MAX 1000 // Power resolution, 0.1 %
+#define HEATER_LUT_SIZE 65
+#define HEATER_TIMER_DIV 16 // CPU cycles per timer tick (TIM3 runs at 4 MHz)
+#define HEATER_LOCK_COUNT 8 // Valid half cycles needed to lock on the mains
+#define HEATER_GATE_GUARD 4000 // Gate released 1 ms before the next zero cross
+#define HEATER_MIN_GATE 400 // Shortest gate pulse worth firing (100 µs)
+#define HEATER_BURST_DELAY 40 // Burst fire delay after the zero cross (10 µs)
+
+typedef enum {
+	HEATER_PHASE, // Phase angle control every half cycle
+	HEATER_BURST // Full cycles on or off, fired at the zero cross
+} HEATER_MODE_t;
+
+typedef enum {
+	MAINS_UNKNOWN = 0,
+	MAINS_50HZ = 50,
+	MAINS_60HZ = 60
+} MAINS_t;
+
+class HeaterDriver {
+private:
+	TIM_TypeDef *tim;
+	volatile HEATER_MODE_t mode;
+	volatile uint16_t power;
+	volatile uint16_t phaseDelay; // Fraction of the half cycle, 1/65536
+	volatile MAINS_t mains;
+	volatile uint32_t lastCrossing; // DWT cycles
+	volatile uint32_t halfPeriod; // DWT cycles
+	uint8_t lockCount;
+	uint8_t halfCycle;
+	uint8_t burstOn;
+	uint16_t accumulator;
+	volatile uint32_t crossings;
+	volatile uint32_t fired;
+	volatile uint32_t missed;
+	volatile uint32_t glitches;
+	volatile uint16_t gateDelay; // Of the last gate pulse, µs
+
+	MAINS_t classify(uint32_t period);
+	void unlock(void);
+public:
+	/**
+	 * Initializes the heater drive
+	 *
+	 * @note the timer must be set up in one pulse PWM2 mode on channel 1
+	 *
+	 * @param *tim: Timer driving the triac gate
+	 */
+	HeaterDriver(TIM_TypeDef *tim);
+	/**
+	 * Sets the modulation mode
+	 *
+	 * @param mode: @ref HEATER_MODE_t phase angle or burst fire
+	 */
+	void setMode(HEATER_MODE_t mode);
+	/**
+	 * Returns the modulation mode
+	 *
+	 * @returns @ref HEATER_MODE_t mode
+	 */
+	HEATER_MODE_t getMode(void);
+	/**
+	 * Sets the heating power
+	 *
+	 * @note the firing angle is linearized, so the delivered power follows the setting
+	 *
+	 * @param power: 0 - HEATER_POWER_MAX
+	 */
+	void setPower(uint16_t power);
+	/**
+	 * Returns the heating power
+	 *
+	 * @returns power 0 - HEATER_POWER_MAX
+	 */
+	uint16_t getPower(void);
+	/**
+	 * Returns the detected mains frequency
+	 *
+	 * @returns @ref MAINS_t frequency, MAINS_UNKNOWN while the heater is locked out
+	 */
+	MAINS_t getMains(void);
+	/**
+	 * Returns the number of zero crosses seen
+	 *
+	 * @returns zero crosses
+	 */
+	uint32_t getCrossings(void);
+	/**
+	 * Returns the number of half cycles the triac was fired in
+	 *
+	 * @returns fired half cycles
+	 */
+	uint32_t getFired(void);
+	/**
+	 * Returns the number of zero crosses that did not arrive in time
+	 *
+	 * @returns missed zero crosses
+	 */
+	uint32_t getMissed(void);
+	/**
+	 * Returns the number of zero cross edges ignored as noise
+	 *
+	 * @returns ignored edges
+	 */
+	uint32_t getGlitches(void);
+	/**
+	 * Returns the delay from the zero cross to the last gate pulse
+	 *
+	 * @note the gate interrupt overwrites it on every pulse, a halfword store is atomic
+	 *
+	 * @returns delay in µs, the last one when no gate fired since
+	 */
+	uint16_t getGateDelay(void);
+	/**
+	 * Locks the heater out when the zero cross signal stopped
+	 *
+	 * @note needs to be called in the control loop, at least every 60 s
+	 */
+	void check(void);
+	/**
+	 * Handles the zero cross interrupt, arms the gate timer for this half cycle
+	 */
+	void __handleZeroCross(void);
+	/**
+	 * Handles the gate timer compare interrupt when the triac is fired
+	 */
+	void __handleFire(void);
+};
+
+#endif /* HEATERDRIVER_H_ */
@@ -0,0 +1,101 @@
+/*******************************************************************************
+ * Copyright (C) 2019 Julian Hellner - All Rights Reserved
+ *
+ * The file Input.h is part of Reflow.
+ *
+ * Unauthorized copying of this file, via any medium is strictly prohibited
+ * Proprietary and confidential
+ *
+ * Written by Julian Hellner <hellnerjulian@gmail.com>, Jul 29, 2019
+ *
+ ******************************************************************************/
+
+#ifndef INPUT_H_
+#define INPUT_H_
+
+#include "main.h"
+#include "Scheduler.h"
+
+#define INPUT_TICK 1 // ms, timer update period
+#define INPUT_DEBOUNCE_DIV 5 // Keys are sampled every 5 ticks, 4 equal samples change the state (20 ms)
+#define INPUT_LONG_PRESS 500 // ms
+#define INPUT_REPEAT_START 200 // ms between the first repeats
+#define INPUT_REPEAT_MIN 40 // ms between repeats at full speed, each repeat is 1/4 faster
+#define INPUT_ENCODER_STEPS 4 // Quadrature steps per detent
+
+#define INPUT_EVENT(type, key) ((uint16_t)((type) << 8 | (key)))
+#define INPUT_EVENT_TYPE(event) ((INPUT_EVENT_t)((event) >> 8))
+#define INPUT_EVENT_KEY(event) ((INPUT_KEY_t)((event) & 0xFF))
+
+typedef enum {
+	INPUT_KEY_UP,
+	INPUT_KEY_DOWN,
+	INPUT_KEY_SELECT,
+	INPUT_KEY_COUNT
+} INPUT_KEY_t;
+
+typedef enum {
+	INPUT_PRESS,
+	INPUT_RELEASE,
+	INPUT_LONG, // Held for INPUT_LONG_PRESS
+	INPUT_REPEAT, // Still held after the long press, faster and faster
+	INPUT_TURN // Encoder detent, UP clockwise and DOWN counter clockwise
+} INPUT_EVENT_t;
+
+/**
+ * Buttons and encoder sampled from a timer tick
+ *
+ * @note the keys are active high on port B, the encoder (A on LEFT, B on
+ * RIGHT) is pulled up and rests with both high. Events are posted to the
+ * scheduler as INPUT_EVENT(type, key).
+ */
+class Input {
+private:
+	TIM_TypeDef *tim;
+	Scheduler *scheduler;
+	uint8_t divider;
+	uint8_t state; // Debounced, a bit per key
+	uint8_t count0; // Vertical counter, low bit per key
+	uint8_t count1; // Vertical counter, high bit per key
+	uint16_t held[INPUT_KEY_COUNT]; // Samples since the press
+	uint16_t nextRepeat[INPUT_KEY_COUNT];
+	uint16_t interval[INPUT_KEY_COUNT];
+	uint8_t encoder; // Last two quadrature states
+	int8_t encoderCount;
+	volatile uint32_t dropped;
+
+	void post(INPUT_EVENT_t type, uint8_t key);
+	void debounce(uint8_t sample);
+	void decodeEncoder(uint8_t ab);
+public:
+	/**
+	 * Initializes the input sampling
+	 *
+	 * @param *tim: Timer with an update every INPUT_TICK ms
+	 * @param *scheduler: Receives the events
+	 */
+	Input(TIM_TypeDef *tim, Scheduler *scheduler);
+	/**
+	 * Starts sampling
+	 */
+	void start(void);
+	/**
+	 * Returns the debounced state of a key
+	 *
+	 * @param key: @ref INPUT_KEY_t key
+	 * @returns 1 while the key is held
+	 */
+	uint8_t isHeld(INPUT_KEY_t key);
+	/**
+	 * Returns the number of events lost because the scheduler queue was full
+	 *
+	 * @returns events
+	 */
+	uint32_t getDropped(void);
+	/**
+	 * Handles the timer update, samples keys and encoder
+	 */
+	void __handleTick(void);
+};
+
+#endif /* INPUT_H_ */
@@ -15,33 +15,127 @@
 
 #include "ProfileController.h"
 #include "Sensors/Sensor.h"
+#include "HeaterDriver.h"
+#include "FeedForward.h"
+#include "Autotune.h"
+#include "Settings.h"
+#include "SmithPredictor.h"
 
 typedef enum {
 	STATE_OFF,
 	STATE_BAKE,
-	STATE_REFLOW
+	STATE_REFLOW,
+	STATE_AUTOTUNE
 } STATE_t;
 
+#define OVEN_PERIOD 100 // ms between calls of loop() by default
+
+#define AUTOTUNE_POWER_HIGH 100 // Relay powers in %
+#define AUTOTUNE_POWER_LOW 0
+
+#define CASCADE_OUTER_PERIOD 1000 // ms between runs of the board loop
+#define CASCADE_BOARD_LAG 30000 // ms the board follows the air with by default
+#define CASCADE_AIR_OFFSET 40 // °C the board loop may correct the air setpoint
+#define CASCADE_AIR_BAND 20 // °C the air setpoint may lead the air
+#define CASCADE_AIR_MAX 260 // °C
+#define CASCADE_STALE 2000 // ms without a board reading until the air is controlled directly
+
 class OvenHelper {
 private:
-	PIDController *pid;
+	FixedPID_t *pid;
 	MAX6675 *sensor;
+	HeaterDriver *heater;
 	STATE_t state;
 	uint8_t power;
-	ProfileController *profcon;
+	ProfileController profileController; // Reloaded for every run
+	ProfileController *profcon; // NULL until the first run
+	FeedForward *feedForward;
+	Autotune autotune;
+	Settings *settings;
+	SmithPredictor *smith;
+	FixedPID_t *inner; // Air loop of the cascade, NULL for single loop control
+	Q16_16 airSetpoint;
+	uint32_t boardLag; // ms
+	uint32_t period; // ms between calls of loop()
+	uint16_t outerSteps; // Calls of loop() until the board loop runs again
+	GAINSET_t defaultGains; // Of the heater PID, kept while a segment scales them
+	const GAINSET_t *activeGains; // NULL while the default gains are used
+
+	void updateFeedForward(void);
+	void scheduleGains(const GAINSET_t *gains);
+	void startCascade(void);
+	void updateCascade(Q16_16 planned);
+	uint8_t regulate(SampleHistory *history);
+	void finishAutotune(void);
 public:
 	/**
 	 * Initialize OvenHelper
 	 *
-	 * @param *pid: PID Controller for the Oven
+	 * @param *pid: PID Controller for the Oven, holds the setpoint
 	 * @param *sensor: MAX6675 sensor for controll
+	 * @param *heater: Triac drive of the heating element
 	 */
-	OvenHelper(PIDController *pid, MAX6675 *sensor);
+	OvenHelper(FixedPID_t *pid, MAX6675 *sensor, HeaterDriver *heater);
 	/** Gets the current ProfileController
 	 *
 	 * @returns the current ProfCon
 	 */
 	ProfileController* getProfCon(void);
+	/**
+	 * Sets the model the planned power is calculated with
+	 *
+	 * @param *feedForward: Heat loss and thermal gain of the oven, NULL for PID only
+	 */
+	void setFeedForward(FeedForward *feedForward);
+	/**
+	 * Sets cascade control, the PID passed to the constructor then
+	 * controls the board thermocouple and sets the air temprature for
+	 * the inner PID
+	 *
+	 * @param *inner: PID of the air thermocouple, NULL for single loop control on the air
+	 */
+	void setCascade(FixedPID_t *inner);
+	/**
+	 * Sets the time constant the board follows the air with
+	 *
+	 * @note heavy loads lag more, the board loop corrects the rest
+	 *
+	 * @param lag: Time constant in ms
+	 */
+	void setBoardLag(uint32_t lag);
+	/**
+	 * Sets the rate loop() is called at, the PIDs use it as fixed time step
+	 *
+	 * @param period: Time between calls in ms, CASCADE_OUTER_PERIOD at most
+	 */
+	void setPeriod(uint32_t period);
+	/** Gets the PID driving the heater
+	 *
+	 * @returns the inner PID in cascade mode, else the PID of the setpoint
+	 */
+	FixedPID_t* getHeaterPID(void);
+	/** Gets the air temprature the cascade asks for
+	 *
+	 * @returns air setpoint in °C
+	 */
+	Q16_16 getAirSetpoint(void);
+	/**
+	 * Sets the dead time compensation
+	 *
+	 * @param *smith: Predictor the PID controls the undelayed temprature with, NULL for the measured one
+	 */
+	void setSmithPredictor(SmithPredictor *smith);
+	/**
+	 * Sets where tuned gains are stored and which tuning rule is used
+	 *
+	 * @param *settings: Persistent settings, NULL does not store the gains
+	 */
+	void setSettings(Settings *settings);
+	/** Gets the relay experiment
+	 *
+	 * @returns the autotuner, for progress and results
+	 */
+	Autotune* getAutotune(void);
 	/**
 	 * Returns the current state of the Oven i.e. Off, Bake or Reflow
 	 *
@@ -68,12 +162,18 @@ public:
 	 * Start the Oven in Baking mode
 	 */
 	void startBaking();
+	/**
+	 * Start the relay autotune, the gains are set and stored when done
+	 *
+	 * @param temprature: Temprature to tune at in °C, 0 for the current setpoint
+	 */
+	void startAutotune(uint16_t temprature);
 	/**
 	 * Power off the oven
 	 */
 	void switchOff();
 	/**
-	 * Main loop needed to be called to regulate the oven
+	 * Main loop needed to be called every period to regulate the oven
 	 */
 	void loop();
 };
@@ -0,0 +1,34 @@
+/*******************************************************************************
+ * Copyright (C) 2019 Julian Hellner - All Rights Reserved
+ *
+ * The file PIDBenchmark.h is part of Reflow.
+ *
+ * Unauthorized copying of this file, via any medium is strictly prohibited
+ * Proprietary and confidential
+ *
+ * Written by Julian Hellner <hellnerjulian@gmail.com>, 10.07.2019
+ *
+ ******************************************************************************/
+
+#ifndef PIDBENCHMARK_H_
+#define PIDBENCHMARK_H_
+
+#include "PIDController.h"
+
+#define PID_BENCHMARK_STEPS 64
+
+typedef struct {
+	uint32_t floatCycles; // Average cycles per float controller step
+	uint32_t fixedCycles; // Average cycles per Q16_16 controller step
+	uint8_t maxDifference; // Largest output difference in percent
+} PID_BENCHMARK_t;
+
+/**
+ * Runs the float and the Q16_16 controller over the same heating ramp and
+ * counts the cycles of each step with the DWT cycle counter
+ *
+ * @param *result: Cycle counts and output difference
+ */
+void PID_Benchmark(PID_BENCHMARK_t *result);
+
+#endif /* PIDBENCHMARK_H_ */
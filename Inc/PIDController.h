@@ -14,24 +14,48 @@
 #define PIDCONTROLLER_H_
 
 #include "stm32f1xx_hal.h"
+#include "FixedPoint.h"
 
+/**
+ * PID controller with the number type as template parameter
+ *
+ * @note instantiated for float and Q16_16, use Q16_16 on target as the
+ * Cortex-M3 has no FPU
+ */
+template<typename T>
 class PIDController {
 private:
-	uint16_t w;
-	float Kp;
-	float Ki;
-	float Kd;
-	int previousError;
-	int integral;
-	float derivative;
-	float dt;
-	uint32_t lastControlTime;
+	T w;
+	T Kp;
+	T Ki;
+	T Kd;
+	T integral; // Integral part, already multiplied by Ki
+	T feedForward; // Output added in front of the PID terms
+	T outputMin;
+	T outputMax;
+	T previousX;
+	T previousError; // Of the last step, to switch gains bumpless
+	T previousSlope;
+	uint8_t hasPrevious;
+	uint64_t lastControlTime; // µs
+	uint32_t period; // ms between steps, 0 when measured
+	T KiDt; // Ki times the period, precomputed for fixed rate
+	T rate; // Steps per second, precomputed for fixed rate
 	/**
 	 * Calculates time difference from last control loop. Also sets new last control time.
 	 *
 	 * @returns dt: time difference to last control loop pass
 	 */
 	uint32_t calculate_dt(void);
+	/**
+	 * Runs one controller step with the integral gain already scaled by the time step
+	 *
+	 * @param x: process variable in °C
+	 * @param slope: rate of change of x in °C/s
+	 * @param kiDt: Ki times the time step in s
+	 * @returns control variable within the limits
+	 */
+	T step(T x, T slope, T kiDt);
 public:
 	/**
 	 * Initialize PID controller
@@ -41,18 +65,83 @@ public:
 	 * @param Ki: Integral gain
 	 * @param Kd: Derivative gain
 	 */
-	PIDController(uint16_t w, float Kp, float Ki, float Kd);
+	PIDController(uint16_t w, T Kp, T Ki, T Kd);
 	/**
 	 * Set the setpoint
 	 *
 	 * @param w: Setpoint
 	 */
 	void set(uint16_t w);
+	/**
+	 * Set the setpoint with fraction, e.g. from a ramp
+	 *
+	 * @param w: Setpoint
+	 */
+	void setPrecise(T w);
 	/** Gets the setpoint
 	 *
 	 * @returns the setpoint w
 	 */
 	uint16_t get(void);
+	/** Gets the setpoint with fraction
+	 *
+	 * @returns the setpoint w
+	 */
+	T getPrecise(void);
+	/**
+	 * Set the gains
+	 *
+	 * @param Kp: Proportional gain
+	 * @param Ki: Integral gain
+	 * @param Kd: Derivative gain
+	 */
+	void setGains(T Kp, T Ki, T Kd);
+	/**
+	 * Set the gains without a step in the output
+	 *
+	 * @note the integral is re-initialized, so the last output stays the same
+	 * with the new proportional and derivative gains
+	 *
+	 * @param Kp: Proportional gain
+	 * @param Ki: Integral gain
+	 * @param Kd: Derivative gain
+	 */
+	void setGainsBumpless(T Kp, T Ki, T Kd);
+	/**
+	 * Get the gains
+	 *
+	 * @param *Kp: Proportional gain
+	 * @param *Ki: Integral gain
+	 * @param *Kd: Derivative gain
+	 */
+	void getGains(T *Kp, T *Ki, T *Kd);
+	/**
+	 * Set the feed-forward output the PID terms are added to
+	 *
+	 * @param u: Feed-forward in percent, 0 disables it
+	 */
+	void setFeedForward(T u);
+	/**
+	 * Set the range of the output
+	 *
+	 * @note 0-100 % by default, an outer cascade loop outputs a setpoint instead
+	 *
+	 * @param min: Lowest output
+	 * @param max: Highest output
+	 */
+	void setLimits(T min, T max);
+	/**
+	 * Set a fixed time step, e.g. when called from a timer interrupt
+	 *
+	 * @note the gains are scaled once here instead of every step
+	 *
+	 * @param period: Time between calls in ms, 0 measures it with the SysTick
+	 */
+	void setPeriod(uint32_t period);
+	/**
+	 * Clears integral and derivative history
+	 */
+	void reset(void);
 	/**
 	 * Calculate whether temprature has reached setpoint wihtin a margin
 	 *
@@ -63,10 +152,44 @@ public:
 	/**
 	 * Calculate control variable based on the process variable (output of the system)
 	 *
+	 * @note the derivative is taken from the change of x since the last call
+	 *
 	 * @param x: process variable: measured output to be compared with w
 	 * @returns control variable: Can be between 0-100 so percentage
 	 */
-	uint8_t control(uint16_t x);
+	uint8_t control(T x);
+	/**
+	 * Calculate control variable with a measured slope as derivative input
+	 *
+	 * @param x: process variable: measured output to be compared with w
+	 * @param slope: rate of change of x in °C/s
+	 * @returns control variable: Can be between 0-100 so percentage
+	 */
+	uint8_t control(T x, T slope);
+	/**
+	 * Calculate control variable with fraction, e.g. for a setpoint of an inner loop
+	 *
+	 * @param x: process variable: measured output to be compared with w
+	 * @param slope: rate of change of x in °C/s
+	 * @returns control variable within the limits
+	 */
+	T controlPrecise(T x, T slope);
+	/**
+	 * Runs one controller step with a given time step
+	 *
+	 * @note derivative on measurement, setpoint steps do not kick the output.
+	 * Anti-windup by back-calculation: the integral is trimmed so the output
+	 * including the feed-forward never exceeds the limits.
+	 *
+	 * @param x: process variable in °C
+	 * @param slope: rate of change of x in °C/s
+	 * @param dt: time step in ms
+	 * @returns control variable within the limits
+	 */
+	T compute(T x, T slope, uint32_t dt);
 };
 
+typedef PIDController<float> FloatPID_t;
+typedef PIDController<Q16_16> FixedPID_t;
+
 #endif /* PIDCONTROLLER_H_ */
@@ -16,37 +16,91 @@
 #include "main.h"
 #include "PIDController.h"
 
+#define PROFILE_MAX_POINTS 10
+#define PROFILE_MAX_PIECES (3*PROFILE_MAX_POINTS) // A peak is made of three pieces
+#define PROFILE_SLOPE_SHIFT 8 // Slopes are Q16.16 per ms scaled by 2^8
+#define PROFILE_START_DEFAULT 25 // °C assumed when there is no reading yet
+
+typedef enum {
+	SEGMENT_RAMP, // Setpoint moves to temprature with rate
+	SEGMENT_SOAK, // Setpoint stays at temprature for time
+	SEGMENT_PEAK // Rises to temprature with rate, stays for time and falls back with rate
+} SEGMENT_TYPE_t;
+
+/*
+ * PID gains of a profile phase, as factors of the default gains so they follow
+ * a retune (e.g. autotune)
+ */
 typedef struct {
-	uint32_t time;
-	uint16_t temprature;
+	Q16_16 kp;
+	Q16_16 ki;
+	Q16_16 kd;
+} GAINSET_t;
+
+typedef struct {
+	SEGMENT_TYPE_t type;
+	uint16_t temprature; // °C
+	uint16_t rate; // 0.01 °C/s, ramps and peaks
+	uint16_t time; // s, soaks and peaks
+	const GAINSET_t *gains; // Used during the segment, NULL for the default gains
 } DATAPOINT_t;
 
 typedef struct {
 	uint8_t id;
 	char* name;
 	uint8_t pointslen;
-	const DATAPOINT_t *points[10];
+	const DATAPOINT_t *points;
 } CURVE_t;
 
+/*
+ * Linear piece of the setpoint trajectory:
+ * w(t) = base + slope*(t - start) >> PROFILE_SLOPE_SHIFT
+ */
+typedef struct {
+	uint32_t start; // ms since profile start
+	uint32_t end; // ms since profile start
+	int32_t base; // Q16.16 raw setpoint at start
+	int32_t slope; // Q16.16 raw per ms << PROFILE_SLOPE_SHIFT
+	const GAINSET_t *gains; // Of the segment the piece belongs to
+} PROFILE_PIECE_t;
+
 const uint8_t curveslen = 2;
 extern CURVE_t curves[curveslen];
 
 class ProfileController {
 private:
-	PIDController *pid;
+	FixedPID_t *pid;
 	CURVE_t *profile;
-	uint32_t starttime;
-	uint32_t indexstarttime;
+	uint64_t starttime; // µs
+	PROFILE_PIECE_t pieces[PROFILE_MAX_PIECES];
+	uint8_t pieceCount;
 	uint8_t index;
+	uint32_t duration; // ms
+	Q16_16 setpoint;
 	uint8_t finished;
+
+	Q16_16 addPiece(Q16_16 from, Q16_16 to, uint32_t time, const GAINSET_t *gains);
+	Q16_16 addRamp(Q16_16 from, Q16_16 to, uint16_t rate, const GAINSET_t *gains);
+	const PROFILE_PIECE_t* findPiece(uint32_t t);
 public:
 	/**
 	 * Initializes the Profile Controller when using Temprature Curves as operting mode
 	 *
+	 * @note no profile is loaded, the controller is finished until load()
+	 *
 	 * @param *pid: @ref PIDController controller for setting temprature
+	 */
+	ProfileController(FixedPID_t *pid);
+	/**
+	 * Loads a profile and starts following it
+	 *
+	 * @note the trajectory is calculated here once, the first ramp starts at the current temprature.
+	 * Replaces the previous profile, so one controller serves every run.
+	 *
 	 * @param *profile: The profile that should be followed
+	 * @param start: Temprature of the oven when the profile starts
 	 */
-	ProfileController(PIDController *pid, CURVE_t *profile);
+	void load(CURVE_t *profile, Q16_16 start);
 	/**
 	 * Calculates time since start
 	 *
@@ -54,13 +108,62 @@ public:
 	 */
 	uint32_t getTimePassed();
 	/**
-	 * Function that sets temprature at certain time
+	 * Returns the time until the profile is finished
+	 *
+	 * @returns remaining time in ms
+	 */
+	uint32_t getTimeRemaining();
+	/**
+	 * Returns the total time of the profile
+	 *
+	 * @returns duration in ms
+	 */
+	uint32_t getDuration();
+	/**
+	 * Returns the setpoint of the last control call
+	 *
+	 * @returns setpoint in °C
+	 */
+	Q16_16 getSetpoint();
+	/**
+	 * Returns the planned setpoint
+	 *
+	 * @param t: Time since start of the profile in ms, not before the last control call
+	 * @returns setpoint in °C, 0 after the end of the profile
+	 */
+	Q16_16 getSetpointAt(uint32_t t);
+	/**
+	 * Returns the planned rate of the setpoint
+	 *
+	 * @param t: Time since start of the profile in ms, not before the last control call
+	 * @returns rate in °C/s
+	 */
+	Q16_16 getSlopeAt(uint32_t t);
+	/**
+	 * Returns the gains of the current segment
+	 *
+	 * @returns gain set, NULL for the default gains
+	 */
+	const GAINSET_t* getGains(void);
+	/**
+	 * Returns the profile followed
+	 *
+	 * @returns profile
+	 */
+	CURVE_t* getProfile(void);
+	/**
+	 * Returns the piece of the trajectory the profile is in
+	 *
+	 * @returns index of the piece, the number of pieces once finished
+	 */
+	uint8_t getPiece(void);
+	/**
+	 * Sets the setpoint for the current time of the profile
 	 *
-	 * @note needs to be called in main loop to operate
-	 * @param x: current temprature
+	 * @note needs to be called in the control loop to operate
 	 * @returns 0 or 1 - 1 for finished 0 for ongoing
 	 */
-	uint8_t control(uint16_t x);
+	uint8_t control(void);
 };
 
 #endif /* PROFILECONTROLLER_H_ */
@@ -0,0 +1,122 @@
+/*******************************************************************************
+ * Copyright (C) 2019 Julian Hellner - All Rights Reserved
+ *
+ * The file Scheduler.h is part of Reflow.
+ *
+ * Unauthorized copying of this file, via any medium is strictly prohibited
+ * Proprietary and confidential
+ *
+ * Written by Julian Hellner <hellnerjulian@gmail.com>, Jul 13, 2019
+ *
+ ******************************************************************************/
+
+#ifndef SCHEDULER_H_
+#define SCHEDULER_H_
+
+#include "main.h"
+#include "Timebase.h"
+#include "Trace.h"
+#include "SpscQueue.h"
+
+#define SCHEDULER_MAX_TASKS 8
+#define SCHEDULER_EVENTS 16 // Must be a power of two
+
+typedef struct {
+	const char *name;
+	void (*run)(void);
+	uint32_t period; // ms
+	uint64_t nextRun; // µs the task is due
+	uint32_t runs;
+	uint32_t worstCycles; // Longest runtime in CPU cycles
+	uint32_t worstJitter; // Latest start after being due in µs
+} TASK_t;
+
+class Scheduler {
+private:
+	TASK_t tasks[SCHEDULER_MAX_TASKS];
+	uint8_t taskCount;
+	SpscQueue<uint16_t, SCHEDULER_EVENTS> events;
+	volatile uint32_t droppedEvents;
+	void (*eventHandler)(uint16_t event);
+public:
+	/**
+	 * Initializes an empty scheduler
+	 */
+	Scheduler(void);
+	/**
+	 * Adds a periodic task
+	 *
+	 * @param *name: Name of the task for reports
+	 * @param *run: Function run every period, must return without blocking
+	 * @param period: Period in ms
+	 * @returns task id, -1 when all slots are used
+	 */
+	int8_t addTask(const char *name, void (*run)(void), uint32_t period);
+	/**
+	 * Sets the function events are passed to
+	 *
+	 * @param *handler: Called from the scheduler loop for every event
+	 */
+	void setEventHandler(void (*handler)(uint16_t event));
+	/**
+	 * Queues an event, safe to call from interrupts
+	 *
+	 * @param event: Event to queue, e.g. an INPUT_EVENT
+	 * @returns 1 when queued, 0 when the queue is full
+	 */
+	uint8_t postEvent(uint16_t event);
+	/**
+	 * Makes a task due now, it runs on the next pass of the loop
+	 *
+	 * @note call from the scheduler loop only, not from interrupts. The
+	 * task keeps its period from then on.
+	 *
+	 * @param id: Task id
+	 */
+	void trigger(int8_t id);
+	/**
+	 * Runs due tasks and queued events, sleeps with WFI when idle
+	 *
+	 * @note never returns
+	 */
+	void run(void);
+	/**
+	 * Returns the number of registered tasks
+	 *
+	 * @returns tasks
+	 */
+	uint8_t getTaskCount(void);
+	/**
+	 * Returns a task with its statistics
+	 *
+	 * @param id: Task id
+	 * @returns task, NULL for an invalid id
+	 */
+	const TASK_t* getTask(uint8_t id);
+	/**
+	 * Returns the longest runtime of a task
+	 *
+	 * @param id: Task id
+	 * @returns runtime in µs
+	 */
+	uint32_t getWorstRuntime(uint8_t id);
+	/**
+	 * Returns the largest start delay of a task
+	 *
+	 * @param id: Task id
+	 * @returns jitter in µs
+	 */
+	uint32_t getWorstJitter(uint8_t id);
+	/**
+	 * Returns the number of events lost because the queue was full
+	 *
+	 * @returns dropped events
+	 */
+	uint32_t getDroppedEvents(void);
+	/**
+	 * Clears the runtime and jitter statistics of all tasks
+	 */
+	void resetStats(void);
+};
+
+#endif /* SCHEDULER_H_ */
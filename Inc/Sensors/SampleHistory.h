@@ -0,0 +1,118 @@
+/*******************************************************************************
+ * Copyright (C) 2019 Julian Hellner - All Rights Reserved
+ *
+ * The file SampleHistory.h is part of Reflow.
+ *
+ * Unauthorized copying of this file, via any medium is strictly prohibited
+ * Proprietary and confidential
+ *
+ * Written by Julian Hellner <hellnerjulian@gmail.com>, Jun 11, 2019
+ *
+ ******************************************************************************/
+
+#ifndef SAMPLEHISTORY_H_
+#define SAMPLEHISTORY_H_
+
+#include "stm32f1xx_hal.h"
+#include "FixedPoint.h"
+
+#define SAMPLEHISTORY_SIZE 16 // Must be a power of two
+#define SAMPLEHISTORY_MASK (SAMPLEHISTORY_SIZE-1)
+#define SAMPLEHISTORY_MEDIAN_MAX 7
+#define SAMPLEHISTORY_IIR_MAX 8
+#define SAMPLEHISTORY_FRAC 8 // Fraction bits of the filtered values
+
+typedef struct {
+	uint32_t tick;
+	int16_t raw; // Input in 0.25 °C
+	int32_t value; // Filtered value in 1/256 °C
+} HISTORY_ENTRY_t;
+
+class SampleHistory {
+private:
+	HISTORY_ENTRY_t entries[SAMPLEHISTORY_SIZE];
+	uint8_t head;
+	uint8_t count;
+
+	int16_t medianWindow[SAMPLEHISTORY_MEDIAN_MAX];
+	uint8_t medianIndex;
+	uint8_t medianCount;
+	uint8_t medianSize;
+
+	int32_t iirAccumulator;
+	uint8_t iirShift;
+	uint8_t window;
+
+	int16_t median(int16_t raw);
+	uint8_t windowSize(void);
+public:
+	/**
+	 * Initializes an empty history
+	 *
+	 * @note defaults to median of 3, IIR shift of 2 and a window of 8 samples
+	 */
+	SampleHistory(void);
+	/**
+	 * Configures the filter pipeline
+	 *
+	 * @param median: Number of samples for the median filter (1 disables it)
+	 * @param iirShift: IIR weight of a new sample is 1/2^iirShift (0 disables it)
+	 * @param window: Number of samples used for slope and variance
+	 */
+	void configure(uint8_t median, uint8_t iirShift, uint8_t window);
+	/**
+	 * Drops all samples and filter state
+	 */
+	void reset(void);
+	/**
+	 * Filters a sample and adds it to the history
+	 *
+	 * @param tick: Time of the sample in ms
+	 * @param raw: Measured value in 0.25 °C
+	 */
+	void push(uint32_t tick, int16_t raw);
+	/**
+	 * Returns the number of samples in the history
+	 *
+	 * @returns samples stored
+	 */
+	uint8_t getCount(void);
+	/**
+	 * Returns the time of the latest sample
+	 *
+	 * @returns tick in ms
+	 */
+	uint32_t getTick(void);
+	/**
+	 * Returns the latest filtered value
+	 *
+	 * @returns temperature in °C, -1 when empty
+	 */
+	float getValue(void);
+	/**
+	 * Returns the latest filtered value in fixed point
+	 *
+	 * @returns temperature in °C, -1 when empty
+	 */
+	Q16_16 getValueQ(void);
+	/**
+	 * Returns the slope of the filtered values over the window (least squares)
+	 *
+	 * @returns slope in °C/s, 0 with less than two samples
+	 */
+	float getSlope(void);
+	/**
+	 * Returns the slope of the filtered values over the window in fixed point
+	 *
+	 * @returns slope in °C/s, 0 with less than two samples
+	 */
+	Q16_16 getSlopeQ(void);
+	/**
+	 * Returns the variance of the unfiltered input over the window
+	 *
+	 * @returns variance in °C²
+	 */
+	float getVariance(void);
+};
+
+#endif /* SAMPLEHISTORY_H_ */
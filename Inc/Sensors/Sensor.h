@@ -15,6 +15,10 @@
 
 #include "stm32f1xx_hal.h"
 #include "main.h"
+#include "Sensors/SampleHistory.h"
+#include "SpscQueue.h"
+
+#define MAX6675_RING_SIZE 8 // Must be a power of two
 
 enum {
 	TRANSFER_WAIT,
@@ -22,6 +26,16 @@ enum {
 	TRANSFER_ERROR
 };
 
+/**
+ * One acquisition of both thermocouples
+ *
+ * raw holds the unprocessed 16 bit MAX6675 words of sensor 1 and 2
+ */
+typedef struct {
+	uint32_t tick;
+	uint16_t raw[2];
+} MAX6675_SAMPLE_t;
+
 class MAX6675 {
 private:
 	SPI_HandleTypeDef *hspi;
@@ -29,10 +43,19 @@ private:
 	GPIO_TypeDef *CS2_PORT;
 	uint16_t CS1Pin;
 	uint16_t CS2Pin;
-	uint8_t currentSensor;
+	volatile uint8_t currentSensor;
 	float temprature1;
 	float temprature2;
-	volatile uint16_t rxBuffer[1];
+	volatile uint16_t rxBuffer[2];
+
+	SpscQueue<MAX6675_SAMPLE_t, MAX6675_RING_SIZE> ring;
+	volatile uint32_t dropped;
+	volatile uint32_t overruns;
+	SampleHistory history1;
+	SampleHistory history2;
+
+	void startRead(uint8_t sensor);
+	void releaseCS(void);
 
 public:
 	/**
@@ -46,11 +69,24 @@ public:
 	 */
 	MAX6675(SPI_HandleTypeDef *hspi, GPIO_TypeDef *CS1_PORT, uint16_t CS1_Pin, GPIO_TypeDef *CS2_PORT, uint16_t CS2Pin);
 	/**
-	 * Starts the temperature reading with Interrupts
+	 * Starts the free running acquisition
+	 *
+	 * @note TIM4 paces one read of both sensors every conversion period (220 ms)
+	 */
+	void start(void);
+	/**
+	 * Consumes all acquired samples and updates the temperatures
 	 *
-	 * @note temperature reading takes some time in the background
+	 * @note never blocks, the temperatures keep their value when no new sample arrived
 	 */
 	void readTemprature(void);
+	/**
+	 * Takes the oldest acquired sample out of the ring buffer
+	 *
+	 * @param *sample: Destination of the sample
+	 * @returns 1 when a sample was read, 0 when the buffer is empty
+	 */
+	uint8_t getSample(MAX6675_SAMPLE_t *sample);
 	/**
 	 * Returns Temperature from Sensor 1
 	 *
@@ -64,11 +100,45 @@ public:
 	 */
 	float getTemprature2(void);
 	/**
-	 * Handles the callback when reading the first sensor finished
+	 * Returns the filtered sample history of Sensor 1
+	 *
+	 * @returns history 1
+	 */
+	SampleHistory* getHistory1(void);
+	/**
+	 * Returns the filtered sample history of Sensor 2
+	 *
+	 * @returns history 2
+	 */
+	SampleHistory* getHistory2(void);
+	/**
+	 * Returns the number of conversions that were skipped or failed
+	 *
+	 * @returns dropped conversions
+	 */
+	uint32_t getDropped(void);
+	/**
+	 * Returns the number of samples lost because the ring buffer was full
+	 *
+	 * @returns overrun samples
+	 */
+	uint32_t getOverruns(void);
+	/**
+	 * Handles the conversion timer, starts reading the first sensor
+	 */
+	void __handleTIM_UpdateCallback(void);
+	/**
+	 * Handles the callback when reading a sensor finished
 	 *
 	 * @param *hspi: SPI
 	 */
 	void __handleSPI_RxCallback(SPI_HandleTypeDef *hspi);
+	/**
+	 * Handles a failed sensor transfer
+	 *
+	 * @param *hspi: SPI
+	 */
+	void __handleSPI_ErrorCallback(SPI_HandleTypeDef *hspi);
 };
 
 #endif /* SENSOR_H_ */
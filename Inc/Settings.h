@@ -0,0 +1,115 @@
+/*******************************************************************************
+ * Copyright (C) 2019 Julian Hellner - All Rights Reserved
+ *
+ * The file Settings.h is part of Reflow.
+ *
+ * Unauthorized copying of this file, via any medium is strictly prohibited
+ * Proprietary and confidential
+ *
+ * Written by Julian Hellner <hellnerjulian@gmail.com>, Jul 22, 2019
+ *
+ ******************************************************************************/
+
+#ifndef SETTINGS_H_
+#define SETTINGS_H_
+
+#include "stm32f1xx_hal.h"
+#include "FixedPoint.h"
+#include "Autotune.h"
+
+#define SETTINGS_ADDRESS 0x0801FC00 // Last 1 KB page, kept out of the program by the linker script
+#define SETTINGS_MAGIC 0x52464C57 // "RFLW"
+#define SETTINGS_VERSION 1
+#define SETTINGS_SAVE_PERIOD 500 // ms between checks for changed settings
+
+typedef struct {
+	uint32_t magic;
+	uint8_t version;
+	uint8_t tuningRule; // @ref TUNING_RULE_t
+	uint16_t reserved;
+	int32_t kp; // Q16.16 raw
+	int32_t ki;
+	int32_t kd;
+	uint32_t crc; // CRC-32 of everything above
+} SETTINGS_t;
+
+/**
+ * Gains and tuning rule kept in the last flash page
+ *
+ * @note the page is erased on every save, the F103 endures 10k cycles
+ */
+class Settings {
+private:
+	SETTINGS_t data;
+	volatile uint8_t dirty; // Changed since the last save
+
+	uint32_t crc32(const uint8_t *buf, uint32_t len);
+public:
+	/**
+	 * Initializes settings with the firmware defaults
+	 *
+	 * @param kp: Default proportional gain
+	 * @param ki: Default integral gain
+	 * @param kd: Default derivative gain
+	 */
+	Settings(Q16_16 kp, Q16_16 ki, Q16_16 kd);
+	/**
+	 * Reads the settings from flash
+	 *
+	 * @returns 1 if valid settings were found, 0 keeps the defaults
+	 */
+	uint8_t load(void);
+	/**
+	 * Writes the settings to flash
+	 *
+	 * @note blocks for about 20 ms while the page is erased, the heater
+	 * should be off. Main loop only, clears the pending save.
+	 * @returns 1 on success
+	 */
+	uint8_t save(void);
+	/**
+	 * Marks the settings to be saved by the main loop
+	 *
+	 * @note the flash must not be written from an interrupt, the erase
+	 * stalls every handler for about 20 ms
+	 */
+	void markDirty(void);
+	/**
+	 * Returns whether the settings changed since the last save
+	 *
+	 * @returns 1 when a save is pending
+	 */
+	uint8_t isDirty(void);
+	/**
+	 * Sets the PID gains
+	 *
+	 * @param kp: Proportional gain
+	 * @param ki: Integral gain
+	 * @param kd: Derivative gain
+	 */
+	void setGains(Q16_16 kp, Q16_16 ki, Q16_16 kd);
+	/**
+	 * Gets the PID gains
+	 *
+	 * @param *kp: Proportional gain
+	 * @param *ki: Integral gain
+	 * @param *kd: Derivative gain
+	 */
+	void getGains(Q16_16 *kp, Q16_16 *ki, Q16_16 *kd);
+	/**
+	 * Sets the rule the autotuner calculates the gains with
+	 *
+	 * @note an unknown rule is ignored
+	 *
+	 * @param rule: @ref TUNING_RULE_t tuning rule
+	 */
+	void setTuningRule(TUNING_RULE_t rule);
+	/**
+	 * Gets the rule the autotuner calculates the gains with
+	 *
+	 * @returns @ref TUNING_RULE_t tuning rule
+	 */
+	TUNING_RULE_t getTuningRule(void);
+};
+
+#endif /* SETTINGS_H_ */
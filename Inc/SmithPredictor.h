@@ -0,0 +1,93 @@
+/*******************************************************************************
+ * Copyright (C) 2019 Julian Hellner - All Rights Reserved
+ *
+ * The file SmithPredictor.h is part of Reflow.
+ *
+ * Unauthorized copying of this file, via any medium is strictly prohibited
+ * Proprietary and confidential
+ *
+ * Written by Julian Hellner <hellnerjulian@gmail.com>, Jul 23, 2019
+ *
+ ******************************************************************************/
+
+#ifndef SMITHPREDICTOR_H_
+#define SMITHPREDICTOR_H_
+
+#include "stm32f1xx_hal.h"
+#include "FixedPoint.h"
+
+#define SMITH_SLOT_MS 250 // Resolution of the delay line
+#define SMITH_SLOTS 128 // Longest dead time SMITH_SLOTS*SMITH_SLOT_MS
+
+/**
+ * Smith predictor for the dead time between heater and thermocouple
+ *
+ * @note the oven is modeled first order plus dead time. The model runs twice,
+ * with the current power and with the power of one dead time ago out of a
+ * delay line. Their difference added to the measurement is the temprature
+ * the thermocouple will show once the dead time has passed, so the PID does
+ * not need to bridge the dead time with derivative gain.
+ */
+class SmithPredictor {
+private:
+	Q16_16 gain; // °C per % in steady state
+	Q16_16 tau; // s
+	uint16_t delaySlots;
+	uint8_t line[SMITH_SLOTS]; // Past power in %
+	uint16_t head;
+	uint16_t slotTime; // ms since the last slot was written
+	uint32_t lastTick;
+	Q16_16 model; // Rise above ambient from the current power
+	Q16_16 delayed; // Rise above ambient from the delayed power
+	uint8_t power;
+
+	uint8_t getDelayedPower(void);
+public:
+	/**
+	 * Initializes the predictor with the default model
+	 */
+	SmithPredictor(void);
+	/**
+	 * Sets the oven model
+	 *
+	 * @note fitted from logged runs with Tools/ff_fit.py
+	 *
+	 * @param gain: Rise in °C per % power in steady state
+	 * @param tau: Time constant in s
+	 * @param deadTime: Dead time in ms, at most SMITH_SLOTS*SMITH_SLOT_MS
+	 */
+	void setModel(Q16_16 gain, Q16_16 tau, uint32_t deadTime);
+	/**
+	 * Returns the dead time of the model
+	 *
+	 * @returns dead time in ms
+	 */
+	uint32_t getDeadTime(void);
+	/**
+	 * Clears the delay line and the model states
+	 */
+	void reset(void);
+	/**
+	 * Advances the model to now
+	 *
+	 * @note needs to be called in the control loop, also while the oven is off
+	 * @param power: Heater power applied since the last call in %
+	 */
+	void update(uint8_t power);
+	/**
+	 * Predicts the temprature one dead time ahead
+	 *
+	 * @param x: Measured temprature in °C
+	 * @returns predicted temprature in °C
+	 */
+	Q16_16 predict(Q16_16 x);
+	/**
+	 * Predicts the heating rate one dead time ahead
+	 *
+	 * @param slope: Measured heating rate in °C/s
+	 * @returns predicted heating rate in °C/s
+	 */
+	Q16_16 predictSlope(Q16_16 slope);
+};
+
+#endif /* SMITHPREDICTOR_H_ */
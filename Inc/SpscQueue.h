@@ -0,0 +1,164 @@
+/*******************************************************************************
+ * Copyright (C) 2019 Julian Hellner - All Rights Reserved
+ *
+ * The file SpscQueue.h is part of Reflow.
+ *
+ * Unauthorized copying of this file, via any medium is strictly prohibited
+ * Proprietary and confidential
+ *
+ * Written by Julian Hellner <hellnerjulian@gmail.com>, Jul 28, 2019
+ *
+ ******************************************************************************/
+
+#ifndef SPSCQUEUE_H_
+#define SPSCQUEUE_H_
+
+#include "stm32f1xx_hal.h"
+
+/**
+ * Lock-free ring buffer between one producer and one consumer context,
+ * e.g. an interrupt handler and the main loop
+ *
+ * @note head is only written by the producer and tail only by the consumer,
+ * both are free running and wrap at 2^16. A single aligned halfword store
+ * publishes an index, the data barriers order it after the slot accesses,
+ * so neither side needs LDREX/STREX or to disable interrupts. Several
+ * producers (or consumers) must be serialized by the caller.
+ */
+template<typename T, uint16_t SIZE>
+class SpscQueue {
+	static_assert(SIZE > 0 && (SIZE & (SIZE - 1)) == 0, "SpscQueue size must be a power of two");
+	static_assert(SIZE <= 0x8000, "SpscQueue size must fit the 16 bit indices");
+private:
+	static constexpr uint16_t MASK = SIZE - 1;
+
+	T items[SIZE];
+	volatile uint16_t head;
+	volatile uint16_t tail;
+public:
+	SpscQueue() : head(0), tail(0) {}
+
+	/**
+	 * Returns the number of items the queue holds
+	 */
+	static constexpr uint16_t capacity() { return SIZE; }
+
+	/**
+	 * Returns the number of queued items
+	 *
+	 * @note exact from either side, the other side can only make it larger
+	 * (consumer) or smaller (producer) meanwhile
+	 */
+	uint16_t count() const {
+		return (uint16_t)(head - tail);
+	}
+
+	/**
+	 * Returns 1 when no item is queued
+	 */
+	uint8_t isEmpty() const {
+		return head == tail;
+	}
+
+	/**
+	 * Returns the number of free slots
+	 */
+	uint16_t space() const {
+		return SIZE - count();
+	}
+
+	/**
+	 * Queues an item, producer only
+	 *
+	 * @param &item: Item to copy into the queue
+	 * @returns 1 when queued, 0 when the queue is full
+	 */
+	uint8_t push(const T &item) {
+		uint16_t h = head;
+
+		if((uint16_t)(h - tail) == SIZE)
+			return 0;
+
+		items[h & MASK] = item;
+		// Item must be complete before it is published to the consumer
+		__DMB();
+		head = h + 1;
+		return 1;
+	}
+
+	/**
+	 * Queues a block of items, all or none, producer only
+	 *
+	 * @note the consumer sees the whole block at once
+	 *
+	 * @param *block: Items to copy into the queue
+	 * @param n: Number of items
+	 * @returns 1 when queued, 0 when there is not enough space
+	 */
+	uint8_t pushBlock(const T *block, uint16_t n) {
+		uint16_t h = head;
+		uint16_t i;
+
+		if(SIZE - (uint16_t)(h - tail) < n)
+			return 0;
+
+		for(i = 0; i < n; i++)
+			items[(h + i) & MASK] = block[i];
+		__DMB();
+		head = h + n;
+		return 1;
+	}
+
+	/**
+	 * Takes the oldest item out of the queue, consumer only
+	 *
+	 * @param *item: Destination of the item
+	 * @returns 1 when an item was read, 0 when the queue is empty
+	 */
+	uint8_t pop(T *item) {
+		uint16_t t = tail;
+
+		if(t == head)
+			return 0;
+
+		// The slot may only be read after the head that published it
+		__DMB();
+		*item = items[t & MASK];
+		// Slot must be copied before it is handed back to the producer
+		__DMB();
+		tail = t + 1;
+		return 1;
+	}
+
+	/**
+	 * Returns the oldest items that are contiguous in memory without taking
+	 * them out, consumer only
+	 *
+	 * @note meant for a DMA transfer straight out of the queue, release the
+	 * items with consume() once it is done
+	 *
+	 * @param **block: Set to the oldest item
+	 * @returns number of contiguous items, 0 when the queue is empty
+	 */
+	uint16_t peekBlock(const T **block) {
+		uint16_t t = tail;
+		uint16_t pending = head - t;
+		uint16_t start = t & MASK;
+
+		__DMB();
+		*block = &items[start];
+		return pending < SIZE - start ? pending : SIZE - start;
+	}
+
+	/**
+	 * Hands the oldest items back to the producer, consumer only
+	 *
+	 * @param n: Number of items, at most count()
+	 */
+	void consume(uint16_t n) {
+		__DMB();
+		tail = tail + n;
+	}
+};
+
+#endif /* SPSCQUEUE_H_ */
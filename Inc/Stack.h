@@ -0,0 +1,83 @@
+/*******************************************************************************
+ * Copyright (C) 2019 Julian Hellner - All Rights Reserved
+ *
+ * The file Stack.h is part of Reflow.
+ *
+ * Unauthorized copying of this file, via any medium is strictly prohibited
+ * Proprietary and confidential
+ *
+ * Written by Julian Hellner <hellnerjulian@gmail.com>, Jul 31, 2019
+ *
+ ******************************************************************************/
+
+/*
+ * Stack watermark. At boot all RAM the stack may grow into, from the end of
+ * the reserved heap up to the current stack pointer, is painted with
+ * STACK_PAINT. The deepest word that lost the pattern is the high water mark
+ * of the main stack, interrupts included. Each interrupt handler also samples
+ * the depth it was entered at, which shows how deep the nesting gets.
+ *
+ * Tools/stack_report.py gives the static worst case of every entry point from
+ * the -fstack-usage output, the runtime marks tell how close the firmware
+ * gets to it.
+ */
+
+#ifndef STACK_H_
+#define STACK_H_
+
+#include "main.h"
+#include "Trace.h"
+
+#define STACK_PAINT 0xA5A5A5A5UL
+#define STACK_CHECK_PERIOD 1000 // ms between updates of the high water mark
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Paints the free stack and sets the bounds of the watermark
+ *
+ * @note call early at boot, everything below the current
+ * stack pointer is overwritten
+ *
+ * @param *bottom: Lowest word the stack may reach, e.g. the end of the heap
+ * @param *top: Initial stack pointer, _estack
+ */
+void Stack_Init(uint32_t *bottom, uint32_t *top);
+/**
+ * Returns the deepest the stack has been since boot
+ *
+ * @note scans the painted words from the bottom, takes a few thousand cycles
+ *
+ * @returns bytes
+ */
+uint32_t Stack_GetUsed(void);
+/**
+ * Returns the size of the stack
+ *
+ * @returns bytes between bottom and top
+ */
+uint32_t Stack_GetSize(void);
+/**
+ * Records the stack depth an interrupt handler was entered at
+ *
+ * @note called on entry of every traced handler (Trace_IsrEnter), SysTick
+ * calls it directly
+ *
+ * @param id: @ref TRACE_ISR_t handler
+ */
+void Stack_SampleIsr(uint8_t id);
+/**
+ * Returns the deepest stack an interrupt handler was entered at
+ *
+ * @param id: @ref TRACE_ISR_t handler
+ * @returns bytes, including the exception frame
+ */
+uint32_t Stack_GetIsrDepth(uint8_t id);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* STACK_H_ */
@@ -0,0 +1,58 @@
+/*******************************************************************************
+ * Copyright (C) 2019 Julian Hellner - All Rights Reserved
+ *
+ * The file StaticObject.h is part of Reflow.
+ *
+ * Unauthorized copying of this file, via any medium is strictly prohibited
+ * Proprietary and confidential
+ *
+ * Written by Julian Hellner <hellnerjulian@gmail.com>, Jul 30, 2019
+ *
+ ******************************************************************************/
+
+#ifndef STATICOBJECT_H_
+#define STATICOBJECT_H_
+
+#include <new>
+
+#include "main.h"
+
+/**
+ * Storage for an object that lives until reset, reserved in .bss at link time
+ *
+ * @note constructed in place with construct() once the hardware it uses is
+ * initialized, never destroyed. Constructing twice is a bug and stops in
+ * Error_Handler(), so nothing is ever allocated at run time and the map file
+ * shows the RAM of every object.
+ */
+template<typename T>
+class StaticObject {
+private:
+	alignas(T) uint8_t storage[sizeof(T)];
+	uint8_t constructed;
+public:
+	/**
+	 * Constructs the object
+	 *
+	 * @param args: Arguments of the constructor of T
+	 * @returns the object
+	 */
+	template<typename... ARGS>
+	T* construct(ARGS... args) {
+		if(constructed)
+			Error_Handler();
+		constructed = 1;
+		return new(storage) T(args...);
+	}
+
+	/**
+	 * Returns the object
+	 *
+	 * @returns the object, NULL before construct()
+	 */
+	T* get() {
+		return constructed ? reinterpret_cast<T*>(storage) : NULL;
+	}
+};
+
+#endif /* STATICOBJECT_H_ */
@@ -0,0 +1,116 @@
+/*******************************************************************************
+ * Copyright (C) 2019 Julian Hellner - All Rights Reserved
+ *
+ * The file Telemetry.h is part of Reflow.
+ *
+ * Unauthorized copying of this file, via any medium is strictly prohibited
+ * Proprietary and confidential
+ *
+ * Written by Julian Hellner <hellnerjulian@gmail.com>, Jul 26, 2019
+ *
+ ******************************************************************************/
+
+/*
+ * Binary telemetry over the UART. Every sample is a packed TELEMETRY_FRAME_t
+ * followed by its CRC-16/CCITT-FALSE (little endian), COBS encoded and ended
+ * by a 0x00 byte, so a receiver can start in the middle of the stream and
+ * resynchronizes at the next frame. Tools/telemetry_decode.py decodes it.
+ */
+
+#ifndef TELEMETRY_H_
+#define TELEMETRY_H_
+
+#include "main.h"
+#include "SpscQueue.h"
+
+#define TELEMETRY_VERSION 1 // First byte of every frame, changes with the layout
+#define TELEMETRY_BUFFER_SIZE 256 // Bytes, power of two
+#define TELEMETRY_PERIOD 100 // ms between frames by default, every control step
+#define TELEMETRY_NO_PROFILE 0xFF
+#define TELEMETRY_NO_READING 0xFFFF
+
+typedef struct __attribute__((packed)) {
+	uint8_t version; // TELEMETRY_VERSION
+	uint16_t sequence; // Counts the frames, a gap shows dropped ones
+	uint32_t tick; // ms, HAL_GetTick
+	uint16_t temprature1; // 0.01 °C, filtered sensor 1 (air), TELEMETRY_NO_READING without samples
+	uint16_t temprature2; // 0.01 °C, filtered sensor 2 (board), TELEMETRY_NO_READING without samples
+	uint16_t setpoint; // 0.01 °C
+	uint8_t power; // %
+	uint8_t state; // STATE_t
+	uint8_t profile; // Curve id, TELEMETRY_NO_PROFILE while no profile runs
+	uint8_t piece; // Of the profile trajectory
+} TELEMETRY_FRAME_t;
+
+// Frame and CRC, COBS adds one byte per 254 and the delimiter
+#define TELEMETRY_ENCODED_MAX (sizeof(TELEMETRY_FRAME_t) + 2 + 2)
+
+/**
+ * Sends frames through a DMA driven transmit ring, never waits for the UART
+ *
+ * @note the UART and the DMA channel (memory to peripheral, byte wide, memory
+ * increment, normal mode) are set up by InitSystem
+ */
+class Telemetry {
+private:
+	DMA_TypeDef *dma;
+	uint32_t channel;
+	SpscQueue<uint8_t, TELEMETRY_BUFFER_SIZE> buffer; // Filled by send(), drained by the DMA
+	volatile uint16_t length; // Of the transfer in flight, 0 when idle
+	uint16_t divider;
+	uint16_t countdown;
+	uint16_t sequence;
+	volatile uint32_t sent;
+	volatile uint32_t dropped;
+
+	void startTransfer(void);
+public:
+	/**
+	 * Initializes the telemetry, a frame is sent on every sample
+	 *
+	 * @param *dma: DMA controller of the UART transmit channel
+	 * @param channel: Channel, LL_DMA_CHANNEL_x
+	 */
+	Telemetry(DMA_TypeDef *dma, uint32_t channel);
+	/**
+	 * Sets the rate, only every n-th sample is sent
+	 *
+	 * @param divider: Samples per frame, 1 for every sample
+	 */
+	void setDivider(uint16_t divider);
+	/**
+	 * Counts a sample and tells if a frame is due
+	 *
+	 * @note fill the frame and send() it only when this returns 1
+	 *
+	 * @returns 1 when the sample should be sent
+	 */
+	uint8_t isDue(void);
+	/**
+	 * Encodes a frame into the transmit ring and starts the DMA if idle
+	 *
+	 * @note version and sequence are filled in, call from one context only
+	 *
+	 * @param *frame: Sample to send
+	 * @returns 1 when queued, 0 when dropped because the ring is full
+	 */
+	uint8_t send(TELEMETRY_FRAME_t *frame);
+	/**
+	 * Returns the number of frames queued
+	 *
+	 * @returns frames
+	 */
+	uint32_t getSent(void);
+	/**
+	 * Returns the number of frames dropped, the UART could not keep up
+	 *
+	 * @returns frames
+	 */
+	uint32_t getDropped(void);
+	/**
+	 * Handles the transfer complete interrupt of the DMA channel
+	 */
+	void __handleTransferComplete(void);
+};
+
+#endif /* TELEMETRY_H_ */
@@ -0,0 +1,51 @@
+/*******************************************************************************
+ * Copyright (C) 2019 Julian Hellner - All Rights Reserved
+ *
+ * The file Timebase.h is part of Reflow.
+ *
+ * Unauthorized copying of this file, via any medium is strictly prohibited
+ * Proprietary and confidential
+ *
+ * Written by Julian Hellner <hellnerjulian@gmail.com>, Jul 25, 2019
+ *
+ ******************************************************************************/
+
+/*
+ * Monotonic 64 bit µs time. The cycle counter (DWT CYCCNT) gives the
+ * resolution, the SysTick interrupt folds it into a 64 bit base every ms,
+ * long before it wraps (67 s at 64 MHz). Wraps after 584942 years.
+ */
+
+#ifndef TIMEBASE_H_
+#define TIMEBASE_H_
+
+#include "main.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Starts the cycle counter, the time starts in step with the SysTick
+ */
+void Timebase_Init(void);
+/**
+ * Folds the cycle counter into the 64 bit base
+ *
+ * @note called from the SysTick interrupt, which no reader can preempt
+ */
+void Timebase_Update(void);
+/**
+ * Returns the time since boot, the ms match HAL_GetTick
+ *
+ * @note lock-free, safe from any interrupt below the SysTick priority
+ *
+ * @returns time in µs
+ */
+uint64_t Timebase_GetMicros(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TIMEBASE_H_ */
@@ -0,0 +1,121 @@
+/*******************************************************************************
+ * Copyright (C) 2019 Julian Hellner - All Rights Reserved
+ *
+ * The file Trace.h is part of Reflow.
+ *
+ * Unauthorized copying of this file, via any medium is strictly prohibited
+ * Proprietary and confidential
+ *
+ * Written by Julian Hellner <hellnerjulian@gmail.com>, Jul 27, 2019
+ *
+ ******************************************************************************/
+
+/*
+ * Instrumentation over the ITM and SWO (PB3). Every event is a single 32 bit
+ * write to the stimulus port of its kind: the id in the top byte, the cycle
+ * counter >> TRACE_STAMP_SHIFT below. A value follows its stamp as a second
+ * write on TRACE_PORT_VALUE_DATA. Events are dropped, never waited for, when
+ * the ITM FIFO is full or no trace is enabled.
+ *
+ * The SWO runs in NRZ (UART) mode at TRACE_SWO_BAUDRATE, so a debugger or a
+ * plain USB UART on PB3 can capture it. Tools/swo2perfetto.py converts the
+ * capture into a Chrome/Perfetto trace.
+ */
+
+#ifndef TRACE_H_
+#define TRACE_H_
+
+#include "main.h"
+
+#define TRACE_SWO_BAUDRATE 2000000
+#define TRACE_STAMP_SHIFT 4 // 0.25 µs resolution, wraps after 4.2 s at 64 MHz
+
+// Stimulus ports, 0 is left for printf
+#define TRACE_PORT_TASK_BEGIN 1
+#define TRACE_PORT_TASK_END 2
+#define TRACE_PORT_ISR_ENTER 3
+#define TRACE_PORT_ISR_EXIT 4
+#define TRACE_PORT_VALUE 5
+#define TRACE_PORT_VALUE_DATA 6
+
+#define TRACE_TASK_EVENTS 0x7F // Task id of the event handler, scheduler tasks count from 0
+
+typedef enum {
+	TRACE_ISR_ZEROCROSS, // EXTI9_5
+	TRACE_ISR_INPUT, // TIM1, button and encoder sampling
+	TRACE_ISR_GATE, // TIM3
+	TRACE_ISR_SENSOR_TIMER, // TIM4
+	TRACE_ISR_SPI, // SPI2
+	TRACE_ISR_SPI_DMA, // DMA1 channel 4, SPI2 RX
+	TRACE_ISR_CONTROL, // TIM2
+	TRACE_ISR_TELEMETRY, // DMA1 channel 7, USART2 TX
+	TRACE_ISR_I2C, // I2C1 event, display flush
+	TRACE_ISR_I2C_ERROR, // I2C1 error
+	TRACE_ISR_I2C_DMA, // DMA1 channel 6, I2C1 TX
+	TRACE_ISR_SYSTICK, // Stack depth only, traced it would flood the SWO
+	TRACE_ISR_COUNT
+} TRACE_ISR_t;
+
+typedef enum {
+	TRACE_VALUE_TEMPRATURE, // 0.01 °C, filtered sensor 1
+	TRACE_VALUE_SETPOINT, // 0.01 °C
+	TRACE_VALUE_AIR_SETPOINT, // 0.01 °C
+	TRACE_VALUE_POWER, // %
+	TRACE_VALUE_STACK // Bytes, high water mark of the stack
+} TRACE_VALUE_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Sets up the SWO pin, the TPIU and the ITM stimulus ports
+ *
+ * @note a debugger may configure the trace again when it attaches
+ */
+void Trace_Init(void);
+/**
+ * Marks the start of a task
+ *
+ * @param id: Task id, TRACE_TASK_EVENTS for the event handler
+ */
+void Trace_TaskBegin(uint8_t id);
+/**
+ * Marks the end of a task
+ *
+ * @param id: Task id, TRACE_TASK_EVENTS for the event handler
+ */
+void Trace_TaskEnd(uint8_t id);
+/**
+ * Marks the entry of an interrupt handler
+ *
+ * @note samples the stack depth of the handler as well
+ *
+ * @param id: @ref TRACE_ISR_t handler
+ */
+void Trace_IsrEnter(uint8_t id);
+/**
+ * Marks the exit of an interrupt handler
+ *
+ * @param id: @ref TRACE_ISR_t handler
+ */
+void Trace_IsrExit(uint8_t id);
+/**
+ * Records a value of the control loop
+ *
+ * @param id: @ref TRACE_VALUE_t value
+ * @param value: Value in the unit of the id
+ */
+void Trace_Value(uint8_t id, int32_t value);
+/**
+ * Returns the number of events dropped because the ITM was busy
+ *
+ * @returns events
+ */
+uint32_t Trace_GetDropped(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TRACE_H_ */
@@ -20,6 +20,18 @@
 
 
 #include "OvenHelper.h"
+#include "HeaterDriver.h"
+#include "FeedForward.h"
+#include "Settings.h"
+#include "SmithPredictor.h"
+#include "Scheduler.h"
+#include "ControlLoop.h"
+#include "Timebase.h"
+#include "Telemetry.h"
+#include "Input.h"
+#include "Trace.h"
+#include "StaticObject.h"
+#include "Stack.h"
 
 #include "Display/SSD1306v2.h"
 #include "Display/fonts.h"
@@ -29,13 +41,41 @@
 
 #include "Sensors/Sensor.h"
 #include "PIDController.h"
+#include "PIDBenchmark.h"
 
 OvenHelper *oven;
 SSD1306 *display;
 MAX6675 *sensor;
+HeaterDriver *heater;
+Scheduler *scheduler;
+ControlLoop *controlLoop;
+Telemetry *telemetry;
+Input *input;
 AnimationManager *animation;
 MenuHelper *menu;
 
-PIDController *controller;
+FixedPID_t *controller;
+FixedPID_t *airController;
+FeedForward *feedForward;
+Settings *settings;
+SmithPredictor *smith;
+
+// Storage of the objects above, constructed once at boot
+static StaticObject<OvenHelper> ovenObject;
+static StaticObject<SSD1306> displayObject;
+static StaticObject<MAX6675> sensorObject;
+static StaticObject<HeaterDriver> heaterObject;
+static StaticObject<Scheduler> schedulerObject;
+static StaticObject<ControlLoop> controlLoopObject;
+static StaticObject<Telemetry> telemetryObject;
+static StaticObject<Input> inputObject;
+static StaticObject<AnimationManager> animationObject;
+static StaticObject<MenuHelper> menuObject;
+
+static StaticObject<FixedPID_t> controllerObject;
+static StaticObject<FixedPID_t> airControllerObject;
+static StaticObject<FeedForward> feedForwardObject;
+static StaticObject<Settings> settingsObject;
+static StaticObject<SmithPredictor> smithObject;
 
 #endif /* MYMAIN_H_ */
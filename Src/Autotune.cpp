@@ -0,0 +1,216 @@
+/*******************************************************************************
+ * Copyright (C) 2019 Julian Hellner - All Rights Reserved
+ *
+ * The file Autotune.cpp is part of Reflow.
+ *
+ * Unauthorized copying of this file, via any medium is strictly prohibited
+ * Proprietary and confidential
+ *
+ * Written by Julian Hellner <hellnerjulian@gmail.com>, Jul 22, 2019
+ *
+ ******************************************************************************/
+
+#include "Autotune.h"
+#include "math.h"
+
+/*
+ * Kp = kp*Ku, Ti = ti*Pu, Td = td*Pu
+ */
+typedef struct {
+	float kp;
+	float ti;
+	float td;
+} TUNING_FACTORS_t;
+
+static const TUNING_FACTORS_t tuningFactors[] = {
+	{0.6f, 0.5f, 0.125f}, // TUNING_ZIEGLER_NICHOLS
+	{0.4545f, 2.2f, 0.1587f}, // TUNING_TYREUS_LUYBEN
+	{0.33f, 0.5f, 0.33f}, // TUNING_SOME_OVERSHOOT
+	{0.2f, 0.5f, 0.33f} // TUNING_NO_OVERSHOOT
+};
+
+/**
+ * Initializes an idle tuner
+ */
+Autotune::Autotune() {
+	this->state = AUTOTUNE_IDLE;
+	this->setpoint = Q16_16(0);
+	this->high = 0;
+	this->low = 0;
+	this->relayOn = 0;
+	this->cycles = 0;
+	this->ultimateGain = Q16_16(0);
+	this->ultimatePeriod = 0;
+}
+
+/**
+ * Starts the experiment
+ *
+ * @param setpoint: Temprature the oven oscillates around in °C
+ * @param high: Relay power above in %
+ * @param low: Relay power below in %
+ */
+void Autotune::start(uint16_t setpoint, uint8_t high, uint8_t low) {
+	this->state = AUTOTUNE_HEATING;
+	this->setpoint = Q16_16((int)setpoint);
+	this->high = high;
+	this->low = low;
+	this->relayOn = 1;
+	this->startTick = HAL_GetTick();
+	this->lastTick = 0;
+	this->lastSwitch = 0;
+	this->switches = 0;
+	this->cycles = 0;
+	this->periodSum = 0;
+	this->amplitudeSum = Q16_16(0);
+}
+
+/**
+ * Runs the relay with the newest sample
+ *
+ * @note needs to be called in the control loop, every sample is only used once
+ * @param *history: Samples of the controlled thermocouple
+ * @returns heater power in %
+ */
+uint8_t Autotune::update(SampleHistory *history) {
+	uint32_t tick;
+	Q16_16 x;
+
+	if(state != AUTOTUNE_HEATING && state != AUTOTUNE_RELAY) return 0;
+
+	if(HAL_GetTick() - startTick > AUTOTUNE_TIMEOUT) {
+		state = AUTOTUNE_FAILED;
+		return 0;
+	}
+
+	tick = history->getTick();
+	if(history->getCount() == 0 || tick == lastTick) return relayOn ? high : low;
+	lastTick = tick;
+	x = history->getValueQ();
+
+	if(state == AUTOTUNE_HEATING) {
+		if(x < setpoint) return high;
+
+		// First crossing, the relay starts switching
+		state = AUTOTUNE_RELAY;
+		relayOn = 0;
+		maxX = x;
+		minX = x;
+		return low;
+	}
+
+	if(x > maxX) maxX = x;
+	if(x < minX) minX = x;
+
+	if(relayOn && x > setpoint + Q16_16(AUTOTUNE_HYSTERESIS)) {
+		relayOn = 0;
+	} else if(!relayOn && x < setpoint - Q16_16(AUTOTUNE_HYSTERESIS)) {
+		relayOn = 1;
+
+		// A full cycle passed since the relay switched on last time
+		if(switches > AUTOTUNE_SKIP) {
+			periodSum += tick - lastSwitch;
+			amplitudeSum += (maxX - minX) / Q16_16(2);
+			cycles++;
+		}
+		switches++;
+		lastSwitch = tick;
+		maxX = x;
+		minX = x;
+
+		if(cycles >= AUTOTUNE_CYCLES) {
+			finish();
+			return 0;
+		}
+	}
+	return relayOn ? high : low;
+}
+
+/**
+ * Calculates the ultimate gain and period from the measured cycles
+ */
+void Autotune::finish() {
+	float a = (float)amplitudeSum / cycles;
+	float e = AUTOTUNE_HYSTERESIS;
+	float d = (high - low) / 2.0f;
+
+	ultimatePeriod = periodSum / cycles;
+
+	// Oscillation drowned in the hysteresis, the relay is too weak for this oven
+	if(a <= e) {
+		state = AUTOTUNE_FAILED;
+		return;
+	}
+
+	ultimateGain = Q16_16(4*d / ((float)M_PI * sqrtf(a*a - e*e)));
+	state = AUTOTUNE_DONE;
+}
+
+/**
+ * Returns the state of the experiment
+ *
+ * @returns @ref AUTOTUNE_STATE_t state
+ */
+AUTOTUNE_STATE_t Autotune::getState() {
+	return this->state;
+}
+
+/**
+ * Returns the temprature the relay switches around
+ *
+ * @returns setpoint in °C
+ */
+uint16_t Autotune::getSetpoint() {
+	return (int)this->setpoint;
+}
+
+/**
+ * Returns the number of measured cycles
+ *
+ * @returns cycles, AUTOTUNE_CYCLES when done
+ */
+uint8_t Autotune::getCycles() {
+	return this->cycles;
+}
+
+/**
+ * Returns the ultimate gain
+ *
+ * @returns Ku in % per °C
+ */
+Q16_16 Autotune::getUltimateGain() {
+	return this->ultimateGain;
+}
+
+/**
+ * Returns the ultimate period
+ *
+ * @returns Pu in ms
+ */
+uint32_t Autotune::getUltimatePeriod() {
+	return this->ultimatePeriod;
+}
+
+/**
+ * Calculates PID gains from the ultimate gain and period
+ *
+ * @note the integral of the PID is in output units, so Ki = Kp/Ti and Kd = Kp*Td
+ *
+ * @param rule: @ref TUNING_RULE_t tuning rule
+ * @param *kp: Proportional gain in % per °C
+ * @param *ki: Integral gain in % per °C s
+ * @param *kd: Derivative gain in % per °C/s
+ */
+void Autotune::getGains(TUNING_RULE_t rule, Q16_16 *kp, Q16_16 *ki, Q16_16 *kd) {
+	const TUNING_FACTORS_t *factors;
+	float pu = ultimatePeriod / 1000.0f;
+	float p;
+
+	if(rule >= TUNING_RULE_COUNT) rule = TUNING_TYREUS_LUYBEN;
+	factors = &tuningFactors[rule];
+	p = factors->kp * (float)ultimateGain;
+
+	*kp = Q16_16(p);
+	*ki = Q16_16(p / (factors->ti * pu));
+	*kd = Q16_16(p * factors->td * pu);
+}
@@ -0,0 +1,162 @@
+/*******************************************************************************
+ * Copyright (C) 2019 Julian Hellner - All Rights Reserved
+ *
+ * The file ControlLoop.cpp is part of Reflow.
+ *
+ * Unauthorized copying of this file, via any medium is strictly prohibited
+ * Proprietary and confidential
+ *
+ * Written by Julian Hellner <hellnerjulian@gmail.com>, Jul 24, 2019
+ *
+ ******************************************************************************/
+
+#include "ControlLoop.h"
+
+extern ControlLoop *controlLoop;
+
+/**
+ * Initializes the control loop, the timer is not started yet
+ *
+ * @note the timer must be set up as up counter at CONTROL_TIMER_CLOCK
+ * with its update interrupt enabled in the NVIC
+ *
+ * @param *tim: Timer pacing the steps
+ * @param irq: Interrupt of the timer
+ * @param *step: Function run every period, in interrupt context
+ * @param period: Period in ms, CONTROL_PERIOD_MAX at most
+ */
+ControlLoop::ControlLoop(TIM_TypeDef *tim, IRQn_Type irq, void (*step)(void), uint32_t period) {
+	assert_param(tim);
+	assert_param(step);
+
+	if(period == 0) period = 1;
+	if(period > CONTROL_PERIOD_MAX) period = CONTROL_PERIOD_MAX;
+
+	this->tim = tim;
+	this->irq = irq;
+	this->step = step;
+	this->period = period;
+	resetStats();
+
+	// Step runtimes are measured with the cycle counter
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+/**
+ * Starts the timer, the first step runs one period later
+ */
+void ControlLoop::start() {
+	LL_TIM_DisableCounter(tim);
+	LL_TIM_SetAutoReload(tim, period * (CONTROL_TIMER_CLOCK / 1000) - 1);
+	LL_TIM_SetCounter(tim, 0);
+	LL_TIM_ClearFlag_UPDATE(tim);
+	LL_TIM_EnableIT_UPDATE(tim);
+	LL_TIM_EnableCounter(tim);
+}
+
+/**
+ * Stops the timer, a running step finishes
+ */
+void ControlLoop::stop() {
+	LL_TIM_DisableIT_UPDATE(tim);
+	LL_TIM_DisableCounter(tim);
+}
+
+/**
+ * Returns the period
+ *
+ * @returns period in ms
+ */
+uint32_t ControlLoop::getPeriod() {
+	return this->period;
+}
+
+/**
+ * Holds back the step, e.g. while the main loop starts a profile
+ *
+ * @note a step that gets due meanwhile runs late on unlock(), keep it short
+ */
+void ControlLoop::lock() {
+	NVIC_DisableIRQ(irq);
+	// The step must not start after this returns
+	__DSB();
+	__ISB();
+}
+
+/**
+ * Lets the step run again
+ */
+void ControlLoop::unlock() {
+	NVIC_EnableIRQ(irq);
+}
+
+/**
+ * Returns the number of steps run
+ *
+ * @returns steps
+ */
+uint32_t ControlLoop::getRuns() {
+	return this->runs;
+}
+
+/**
+ * Returns the number of steps that did not finish within their period
+ *
+ * @returns overruns
+ */
+uint32_t ControlLoop::getOverruns() {
+	return this->overruns;
+}
+
+/**
+ * Returns the longest runtime of a step
+ *
+ * @returns worst case execution time in µs
+ */
+uint32_t ControlLoop::getWorstRuntime() {
+	return this->worstCycles / (SystemCoreClock / 1000000);
+}
+
+/**
+ * Returns the largest delay of a step after its timer update
+ *
+ * @returns latency in µs
+ */
+uint32_t ControlLoop::getWorstLatency() {
+	return this->worstLatency * (1000000 / CONTROL_TIMER_CLOCK);
+}
+
+/**
+ * Clears the runtime, latency and overrun statistics
+ */
+void ControlLoop::resetStats() {
+	this->runs = 0;
+	this->overruns = 0;
+	this->worstCycles = 0;
+	this->worstLatency = 0;
+}
+
+void ControlTimer_Callback(void) {
+	controlLoop->__handleTimerUpdate();
+}
+
+/**
+ * Handles the update interrupt of the timer, runs the step
+ *
+ * @note the counter restarted at the update, so it tells how late the step starts
+ */
+void ControlLoop::__handleTimerUpdate() {
+	uint32_t latency = LL_TIM_GetCounter(tim);
+	uint32_t start = DWT->CYCCNT;
+	uint32_t cycles;
+
+	step();
+
+	cycles = DWT->CYCCNT - start;
+	runs++;
+	if(cycles > worstCycles) worstCycles = cycles;
+	if(latency > worstLatency) worstLatency = latency;
+	// Next update already happened, the step took longer than a period
+	if(LL_TIM_IsActiveFlag_UPDATE(tim)) overruns++;
+}
@@ -25,8 +25,27 @@ MODE_t Reflow = {
 		"Reflow Mode"
 };
 
-const uint8_t modelen = 2;
-MODE_t modes[modelen] = {Bake, Reflow};
+MODE_t Tune = {
+		2,
+		"Autotune"
+};
+
+// Shows the tuning rule instead of its name, selecting it picks the next one
+MODE_t Rule = {
+		3,
+		"Tuning rule"
+};
+
+const uint8_t modelen = 4;
+MODE_t modes[modelen] = {Bake, Reflow, Tune, Rule};
+
+// Indexed by TUNING_RULE_t
+char* ruleNames[TUNING_RULE_COUNT] = {
+		"Rule Ziegler-N",
+		"Rule Tyreus-L",
+		"Rule Some OS",
+		"Rule No OS"
+};
 
 /**
  * Initialize the MenuHelper
@@ -38,8 +57,19 @@ MenuHelper::MenuHelper(OvenHelper *oven, SSD1306 *display) {
 	this->oven = oven;
 	this->display = display;
 	this->active = 1;
+	this->redraw = 1;
 	this->activePage = MODE_SELECTION;
 	this->activeElement = 0;
+	this->settings = NULL;
+}
+
+/**
+ * Sets where the tuning rule is read from and stored
+ *
+ * @param *settings: Persistent settings, NULL hides the rule
+ */
+void MenuHelper::setSettings(Settings *settings) {
+	this->settings = settings;
 }
 
 /**
@@ -54,10 +84,13 @@ uint8_t MenuHelper::isActive() {
 /**
  * Sets menu active or not
  *
+ * @note activating the menu marks it for redraw
+ *
  * @param active: boolean active or not
  */
 void MenuHelper::setActive(uint8_t active) {
 	this->active = active;
+	if(active) this->redraw = 1;
 }
 
 /** Returns current mode
@@ -69,7 +102,18 @@ MODE_t MenuHelper::getMode() {
 }
 
 /**
- * Function to draw Menu to RAM
+ * Returns wheter the menu changed since it was last shown
+ *
+ * @returns boolean redraw needed
+ */
+uint8_t MenuHelper::needsRedraw() {
+	return this->redraw;
+}
+
+/**
+ * Draws the menu and starts sending it to the display
+ *
+ * @note stays marked for redraw while the previous frame is still in flight
  */
 void MenuHelper::showMenu() {
 	display->fill(BLACK);
@@ -85,22 +129,30 @@ void MenuHelper::showMenu() {
 
 		drawCurves();
 	}
-	display->updateScreen();
+	if(display->updateScreen(FLUSH_DIRTY) == HAL_OK)
+		this->redraw = 0;
 }
 
 /**
  * Internal function to draw the Mode Selection to RAM
  */
 void MenuHelper::drawMode() {
+	char *name;
+
 	for(uint8_t i=0; i<modelen; i++) {
+		name = modes[i].name;
+		if(modes[i].id == Rule.id) {
+			if(settings == NULL) continue;
+			name = ruleNames[settings->getTuningRule()];
+		}
 		display->gotoX(5);
 		if(i==this->activeElement) {
 			display->drawFilledRectangle(0, 12*i+MODE_OFFSET, 127, 10, WHITE);
 			display->gotoY(12*i+MODE_OFFSET+1);
-			display->putS(modes[i].name, &Font_7x10, BLACK);
+			display->putS(name, &Font_7x10, BLACK);
 		} else {
 			display->gotoY(12*i+MODE_OFFSET+1);
-			display->putS(modes[i].name, &Font_7x10, WHITE);
+			display->putS(name, &Font_7x10, WHITE);
 		}
 	}
 }
@@ -142,51 +194,64 @@ void MenuHelper::drawCurves() {
 }
 
 /**
- * Function to handle button pushes on interrupts
+ * Handles a button press, only changes the menu state
+ *
+ * @note the menu is drawn by the next showMenu(), so several presses
+ * cost one redraw
  *
- * @param GPIO_PIN: GPIO pin with interrupt
+ * @param key: @ref INPUT_KEY_t pressed key
  */
-void MenuHelper::buttonHandler(uint16_t GPIO_PIN) {
+void MenuHelper::buttonHandler(INPUT_KEY_t key) {
 	if(this->activePage == MODE_SELECTION) {
-		switch(GPIO_PIN) {
-			case DOWN_Pin:
+		switch(key) {
+			case INPUT_KEY_DOWN:
 				if(this->activeElement<modelen-1) this->activeElement++;
 				break;
-			case UP_Pin:
+			case INPUT_KEY_UP:
 				if(this->activeElement>0) this->activeElement--;
 				break;
-			case SELECT_Pin:
+			case INPUT_KEY_SELECT:
 				if(modes[activeElement].id == Reflow.id) {
 					this->activeElement = 0;
 					this->activePage = CURVE_SELECTION;
-					showMenu();
 				} else if(modes[activeElement].id == Bake.id) {
 					this->active = 0;
 					this->oven->startBaking();
+				} else if(modes[activeElement].id == Tune.id) {
+					// Tunes at the setpoint chosen with the buttons
+					this->active = 0;
+					this->oven->startAutotune(0);
+				} else if(modes[activeElement].id == Rule.id && settings != NULL) {
+					// Used by the next autotune, the settings task writes it to flash
+					settings->setTuningRule((TUNING_RULE_t)((settings->getTuningRule() + 1) % TUNING_RULE_COUNT));
+					settings->markDirty();
 				}
 				break;
+			default:
+				break;
 		}
 	} else if(this->activePage == CURVE_SELECTION) {
-		switch(GPIO_PIN) {
-			case DOWN_Pin:
+		switch(key) {
+			case INPUT_KEY_DOWN:
 				if(this->activeElement<curveslen) this->activeElement++;
 				break;
-			case UP_Pin:
+			case INPUT_KEY_UP:
 				if(this->activeElement>0) this->activeElement--;
 				break;
-			case SELECT_Pin:
+			case INPUT_KEY_SELECT:
 				// Go back
 				if(activeElement==0) {
 					this->activeElement = 0;
 					this->activePage = MODE_SELECTION;
-					showMenu();
 				} else {
 					this->active=0;
 					this->oven->startReflow(&curves[this->activeElement-1]);
 				}
 				break;
+			default:
+				break;
 		}
 	}
-	this->showMenu();
+	this->redraw = 1;
 }
 
@@ -16,21 +16,27 @@
 /* Absolute value */
 #define ABS(x)   ((x) > 0 ? (x) : -(x))
 
+extern SSD1306 *display;
+
 /**
  * Initializes SSD1306 OLED display
  *
  * @param *hi2c: I2C bus used
  * @param address: 7 bit slave address, left aligned, bits 7:1 are used, LSB bit is not used
  */
-SSD1306::SSD1306(I2C_HandleTypeDef *hi2c, uint8_t address) {
-
-	/* Init I2C */
-	i2c = new I2C(hi2c, address);
+SSD1306::SSD1306(I2C_HandleTypeDef *hi2c, uint8_t address) : i2c(hi2c, address) {
 
 	this->width = SSD1306_WIDTH;
 	this->height = SSD1306_HEIGHT;
 	inverted = 0;
-	//this->buffer = new uint8_t[width * height /8];
+	frameValid = 0;
+	flushing = 0;
+	flushCount = 0;
+	flushIndex = 0;
+	flushStage = 0;
+	flushCallback = NULL;
+	flushErrors = 0;
+	markAllDirty();
 
 	if(HAL_I2C_IsDeviceReady(hi2c, address, 5, 20000) != HAL_OK) {
 		return;
@@ -45,12 +51,11 @@ SSD1306::SSD1306(I2C_HandleTypeDef *hi2c, uint8_t address) {
 	writeCommand(SSD1306_DISPLAYOFF); //display off
 
 	writeCommand(SSD1306_MEMORYMODE); //Set Memory Addressing Mode
-	writeCommand(0x10); //00,Horizontal Addressing Mode;01,Vertical Addressing Mode;10,Page Addressing Mode (RESET);11,Invalid
-	writeCommand(0xB0); //Set Page Start Address for Page Addressing Mode,0-7
+	writeCommand(0x00); //00,Horizontal Addressing Mode;01,Vertical Addressing Mode;10,Page Addressing Mode (RESET);11,Invalid
 
 	writeCommand(SSD1306_PAGEADDR);	// Set Page start address
 	writeCommand(0);				// Start page address
-	writeCommand((this->width/8)-1);// End page address
+	writeCommand((this->height/8)-1);// End page address
 
 	writeCommand(SSD1306_COLUMNADDR);
 	writeCommand(0);
@@ -112,7 +117,7 @@ SSD1306::SSD1306(I2C_HandleTypeDef *hi2c, uint8_t address) {
  * @param  command: Command to be send
  */
 void SSD1306::writeCommand(uint8_t command) {
-	(*i2c).write(0x00, command);
+	i2c.write(0x00, command);
 }
 
 /**
@@ -121,7 +126,41 @@ void SSD1306::writeCommand(uint8_t command) {
  * @param  data: Data to be send
  */
 void SSD1306::writeData(uint8_t data) {
-	(*i2c).write(0x40, data);
+	i2c.write(0x40, data);
+}
+
+/**
+ * Sets column and page window for horizontal addressing mode
+ *
+ * @param  x0: Start column
+ * @param  x1: End column
+ * @param  p0: Start page
+ * @param  p1: End page
+ */
+void SSD1306::setWindow(uint8_t x0, uint8_t x1, uint8_t p0, uint8_t p1) {
+	uint8_t cmd[6] = {SSD1306_COLUMNADDR, x0, x1, SSD1306_PAGEADDR, p0, p1};
+
+	i2c.writeMulti(0x00, cmd, sizeof(cmd));
+}
+
+/**
+ * Marks columns of a page as changed since the last flush
+ *
+ * @param  x0: First changed column
+ * @param  x1: Last changed column
+ * @param  page: Page of the columns
+ */
+void SSD1306::markDirty(uint8_t x0, uint8_t x1, uint8_t page) {
+	if(x0 < dirtyStart[page]) dirtyStart[page] = x0;
+	if(x1 > dirtyEnd[page]) dirtyEnd[page] = x1;
+}
+
+/**
+ * Marks the entire display as changed since the last flush
+ */
+void SSD1306::markAllDirty(void) {
+	memset(dirtyStart, 0, sizeof(dirtyStart));
+	memset(dirtyEnd, this->width-1, sizeof(dirtyEnd));
 }
 
 /**
@@ -132,17 +171,224 @@ void SSD1306::writeData(uint8_t data) {
 void SSD1306::updateScreen(void) {
 	uint8_t m;
 
-	for(m = 0; m < 8; m++) {
-		writeCommand(0xB0 + m);
-		writeCommand(0x00);
-		writeCommand(0x10);
+	/* Wait for a DMA frame still in flight */
+	while(isFlushing());
+
+	/* Horizontal addressing mode: column/page pointer wraps through the whole window */
+	setWindow(0, this->width-1, 0, SSD1306_PAGES-1);
+	for(m = 0; m < SSD1306_PAGES; m++) {
+		i2c.writeMulti(0x40, &this->buffer[this->width * m], this->width);
+	}
+
+	/* Display RAM now matches buffer */
+	memcpy(frame, buffer, SSD1306_BUFFERSIZE);
+	frameValid = 1;
+	memset(dirtyStart, 0xFF, sizeof(dirtyStart));
+	memset(dirtyEnd, 0, sizeof(dirtyEnd));
+}
+
+/**
+ * Updates buffer from internal RAM to display with the selected transfer mode
+ *
+ * @note   With @ref FLUSH_DMA and @ref FLUSH_DIRTY the current frame is sent from a second buffer, drawing can continue immediately
+ * @param  mode: @ref FLUSH_MODE_t transfer mode
+ * @returns HAL_OK when the frame was sent/started, HAL_BUSY when the previous frame is still in flight
+ */
+HAL_StatusTypeDef SSD1306::updateScreen(FLUSH_MODE_t mode) {
+	uint8_t p, x0, x1;
+	SSD1306_WINDOW_t *span;
+
+	if(mode == FLUSH_BLOCKING) {
+		updateScreen();
+		return HAL_OK;
+	}
+
+	// Previous frame not sent yet, keep drawing and collecting changes
+	if(isFlushing()) {
+		return HAL_BUSY;
+	}
+
+	if(mode == FLUSH_DMA || !frameValid) {
+		markAllDirty();
+	}
+
+	// Collect changed spans per page, frame holds what the display currently shows
+	flushCount = 0;
+	for(p = 0; p < SSD1306_PAGES; p++) {
+		if(dirtyStart[p] > dirtyEnd[p]) continue;
+
+		x0 = dirtyStart[p];
+		x1 = dirtyEnd[p];
+		if(mode == FLUSH_DIRTY && frameValid) {
+			// Columns drawn with the same content do not need to be sent
+			while(x0 <= x1 && buffer[p*this->width + x0] == frame[p*this->width + x0]) x0++;
+			if(x0 > x1) continue;
+			while(x1 > x0 && buffer[p*this->width + x1] == frame[p*this->width + x1]) x1--;
+		}
+		memcpy(&frame[p*this->width + x0], &buffer[p*this->width + x0], x1-x0+1);
+
+		// Full width pages are contiguous in frame and can share one window
+		if(flushCount > 0 && x0 == 0 && x1 == this->width-1) {
+			span = &flushSpans[flushCount-1];
+			if(span->x0 == 0 && span->x1 == this->width-1 && span->page1 == p-1) {
+				span->page1 = p;
+				continue;
+			}
+		}
+		span = &flushSpans[flushCount++];
+		span->x0 = x0;
+		span->x1 = x1;
+		span->page0 = p;
+		span->page1 = p;
+	}
+
+	memset(dirtyStart, 0xFF, sizeof(dirtyStart));
+	memset(dirtyEnd, 0, sizeof(dirtyEnd));
+	frameValid = 1;
+
+	if(flushCount == 0) {
+		return HAL_OK;
+	}
+
+	flushIndex = 0;
+	flushStage = 0;
+	flushing = 1;
+	if(!flushNext()) {
+		return HAL_ERROR;
+	}
+	return HAL_OK;
+}
+
+/**
+ * Starts the next transfer of the pending flush spans
+ *
+ * @note a transfer that fails to start ends the flush and counts as error
+ * @returns 1 when a transfer was started, 0 when all spans were sent or on error
+ */
+uint8_t SSD1306::flushNext(void) {
+	SSD1306_WINDOW_t *span;
+	HAL_StatusTypeDef status;
+
+	if(flushIndex >= flushCount) {
+		flushing = 0;
+		return 0;
+	}
+
+	span = &flushSpans[flushIndex];
+	if(flushStage == 0) {
+		// Set window, display pointer then runs through it in horizontal addressing mode
+		windowCmd[0] = SSD1306_COLUMNADDR;
+		windowCmd[1] = span->x0;
+		windowCmd[2] = span->x1;
+		windowCmd[3] = SSD1306_PAGEADDR;
+		windowCmd[4] = span->page0;
+		windowCmd[5] = span->page1;
+		flushStage = 1;
+		status = i2c.writeMultiDMA(0x00, windowCmd, sizeof(windowCmd));
+	} else {
+		flushStage = 0;
+		flushIndex++;
+		status = i2c.writeMultiDMA(0x40, &frame[span->page0*this->width + span->x0], (span->x1-span->x0+1)*(span->page1-span->page0+1));
+	}
+
+	if(status != HAL_OK) {
+		// Display content unknown, resend everything next time
+		frameValid = 0;
+		flushing = 0;
+		flushErrors++;
+		return 0;
+	}
+	return 1;
+}
+
+/**
+ * Returns whether a frame is currently being transferred
+ *
+ * @returns boolean: transfer in progress
+ */
+uint8_t SSD1306::isFlushing(void) {
+	return flushing || i2c.isBusy();
+}
+
+/**
+ * Sets function called when a DMA frame transfer finished
+ *
+ * @note   callback is called from interrupt context, not for a failed frame
+ * @param  *callback: function to be called, NULL to disable
+ */
+void SSD1306::setFlushCallback(void (*callback)(void)) {
+	this->flushCallback = callback;
+}
+
+/**
+ * Returns the number of DMA frame transfers that failed
+ *
+ * @note   the display is sent completely with the next frame after an error
+ * @returns failed frames since boot
+ */
+uint32_t SSD1306::getFlushErrors(void) {
+	return flushErrors;
+}
+
+/**
+ * Returns the amount of bytes sent to the display
+ *
+ * @note   Used to measure the savings of @ref FLUSH_DIRTY
+ * @returns bytes sent since last reset
+ */
+uint32_t SSD1306::getBytesSent(void) {
+	return i2c.getBytesSent();
+}
 
-		/* Write multi data */
-		//i2c->writeMulti(0x40, &buffer[this->width * m], this->width);
-		(*i2c).writeMulti(0x40, &this->buffer[this->width * m], this->width);
+/**
+ * Resets the sent bytes counter
+ */
+void SSD1306::resetBytesSent(void) {
+	i2c.resetBytesSent();
+}
+
+void HAL_I2C_MemTxCpltCallback(I2C_HandleTypeDef *hi2c) {
+	display->__handleI2C_TxCallback(hi2c);
+}
+
+void HAL_I2C_ErrorCallback(I2C_HandleTypeDef *hi2c) {
+	display->__handleI2C_ErrorCallback(hi2c);
+}
+
+/**
+ * Handles the callback when a DMA frame transfer finished
+ *
+ * @param *hi2c: I2C
+ */
+void SSD1306::__handleI2C_TxCallback(I2C_HandleTypeDef *hi2c) {
+	uint32_t errors = flushErrors;
+
+	(void)hi2c;
+	if(!flushing) return;
+
+	// Chain the remaining spans
+	if(flushNext()) return;
+	// The next span did not start, the frame is incomplete
+	if(flushErrors != errors) return;
+
+	if(flushCallback != NULL) {
+		flushCallback();
 	}
 }
 
+/**
+ * Handles the callback when a DMA transfer failed
+ *
+ * @param *hi2c: I2C
+ */
+void SSD1306::__handleI2C_ErrorCallback(I2C_HandleTypeDef *hi2c) {
+	(void)hi2c;
+	// Display content unknown, resend everything next time
+	frameValid = 0;
+	if(flushing) flushErrors++;
+	flushing = 0;
+}
+
 /**
  * Toggles pixels inversion inside internal RAM
  *
@@ -155,9 +401,10 @@ void SSD1306::toggleInvert(void) {
 	inverted = !inverted;
 
 	/* Do memory toggle */
-	for(i = 0; i < sizeof(buffer); i++) {
+	for(i = 0; i < SSD1306_BUFFERSIZE; i++) {
 		buffer[i] = ~buffer[i];
 	}
+	markAllDirty();
 }
 
 /**
@@ -167,7 +414,8 @@ void SSD1306::toggleInvert(void) {
  * @param  Color: Color to be used for screen fill. This parameter can be a value of @ref SSD1306_COLOR_t enumeration
  */
 void SSD1306::fill(SSD1306_COLOR_t color) {
-	memset(buffer, (color == BLACK) ? 0x00 : 0xFF, sizeof(buffer));
+	memset(buffer, (color == BLACK) ? 0x00 : 0xFF, SSD1306_BUFFERSIZE);
+	markAllDirty();
 }
 
 /**
@@ -197,6 +445,7 @@ void SSD1306::drawPixel(uint16_t x, uint16_t y, SSD1306_COLOR_t color) {
 	} else {
 		buffer[x + (y / 8) * this->width] &= ~(1 << (y % 8));
 	}
+	markDirty(x, x, y / 8);
 }
 
 /**
@@ -229,7 +478,6 @@ void SSD1306::gotoXY(uint16_t x, uint16_t y) {
 	currentY = y;
 }
 
-// *ToDo* NEEDS OPTIMAZATION
 /**
  * Draws Image to internal RAM
  *
@@ -240,10 +488,6 @@ void SSD1306::gotoXY(uint16_t x, uint16_t y) {
  * @param  color: Color used for drawing. This parameter can be a value of @ref SSD1306_COLOR_t enumeration
  */
 void SSD1306::drawImage(uint16_t* image, uint16_t width, uint16_t height, SSD1306_COLOR_t color) {
-	uint32_t x, y, i, byte_number;
-	uint16_t b;
-	uint8_t bit_number;
-
 	// Check for border collisions
 	if(
 		this->width <= (currentX + width) ||
@@ -252,21 +496,7 @@ void SSD1306::drawImage(uint16_t* image, uint16_t width, uint16_t height, SSD130
 		return;
 	}
 
-	i=0;
-	for(y=0; y < height; y++) {
-		for(x=0; x < width; x++) {
-			byte_number = floor(i/(double)16);	// Calc in which byte pixel is located
-			bit_number = (i%16);				// Calc which bit of that byte is our pixle
-			b = image[byte_number];				// Retrieve byte
-			//p = (b << bit_number) & 0x8000;		// Move byte so our bit is the left most bit
-			i++;
-			if((b << bit_number) & 0x8000) {
-				drawPixel(currentX + x, currentY + y, (SSD1306_COLOR_t) color);
-			} else {
-				drawPixel(currentX + x, currentY + y, (SSD1306_COLOR_t) !color);
-			}
-		}
-	}
+	blitStream(image, width, height, currentX, currentY, color);
 }
 
 /**
@@ -290,10 +520,88 @@ void SSD1306::drawSprite(const SpriteDef_t *image, SSD1306_COLOR_t color) {
  * @param  yloc: Y location. This parameter can be a value between 0 and this height - 1
  */
 void SSD1306::drawSprite(const SpriteDef_t *image, SSD1306_COLOR_t color, uint16_t xloc, uint16_t yloc) {
-	uint32_t x, y, i, byte_number;
-	uint16_t b;
-	uint8_t bit_number;
+	// Check for border collisions
+	if(
+		this->width <= (xloc + image->spriteWidth) ||
+		this->height <= (yloc + image->spriteHeight)
+	) {
+		return;
+	}
+
+	blitStream(image->data, image->spriteWidth, image->spriteHeight, xloc, yloc, color);
+}
 
+/**
+ * Draws page ordered bitmap to specific location internal RAM
+ *
+ * @note   @ref updateScreen() must be called after that in order to see updated display screen
+ * @param  *pages: Bitmap in display layout, (height+7)/8 rows of stride bytes, bit 0 is the top pixel
+ * @param  w: Width of bitmap, columns drawn from each row
+ * @param  stride: Bytes per row of the bitmap, at least w
+ * @param  h: Height of bitmap
+ * @param  color: Color used for drawing. This parameter can be a value of @ref SSD1306_COLOR_t enumeration
+ * @param  xloc: X location. This parameter can be a value between 0 and this width - 1
+ * @param  yloc: Y location. This parameter can be a value between 0 and this height - 1
+ */
+void SSD1306::drawBitmap(const uint8_t *pages, uint8_t w, uint8_t stride, uint8_t h, SSD1306_COLOR_t color, uint16_t xloc, uint16_t yloc) {
+	uint8_t shift, page, rows, r, i, valid, b;
+	uint16_t mask, bits;
+	uint8_t *dst;
+
+	// Clip once for the whole bitmap
+	if(xloc >= width || yloc >= height || w == 0 || h == 0) return;
+	if(xloc + w > width) w = width - xloc;
+
+	if(inverted) {
+		color = (SSD1306_COLOR_t)!color;
+	}
+
+	shift = yloc & 7;
+	page = yloc >> 3;
+	rows = (h + 7) >> 3;
+
+	for(r = 0; r < rows && page + r < SSD1306_PAGES; r++, pages += stride) {
+		valid = (h - 8*r >= 8) ? 0xFF : (1 << (h - 8*r)) - 1;
+		dst = &buffer[(page + r)*width + xloc];
+
+		// Aligned full page, straight copy
+		if(shift == 0 && valid == 0xFF && color == WHITE) {
+			memcpy(dst, pages, w);
+			markDirty(xloc, xloc + w - 1, page + r);
+			continue;
+		}
+
+		mask = valid << shift;
+		for(i = 0; i < w; i++) {
+			b = (color == WHITE) ? pages[i] : ~pages[i];
+			bits = (uint16_t)(b & valid) << shift;
+			dst[i] = (dst[i] & ~(uint8_t)mask) | (uint8_t)bits;
+		}
+		markDirty(xloc, xloc + w - 1, page + r);
+
+		// Unaligned rows spill into the next page
+		if((mask >> 8) && page + r + 1 < SSD1306_PAGES) {
+			dst += width;
+			for(i = 0; i < w; i++) {
+				b = (color == WHITE) ? pages[i] : ~pages[i];
+				bits = (uint16_t)(b & valid) << shift;
+				dst[i] = (dst[i] & ~(uint8_t)(mask >> 8)) | (uint8_t)(bits >> 8);
+			}
+			markDirty(xloc, xloc + w - 1, page + r + 1);
+		}
+	}
+}
+
+/**
+ * Draws page layout Sprite to specific location internal RAM
+ *
+ * @note   @ref updateScreen() must be called after that in order to see updated display screen
+ * @param  *image: @ref PageSpriteDef_t Pointer to Sprite
+ * @param  color: Color used for drawing. This parameter can be a value of @ref SSD1306_COLOR_t enumeration
+ * @param  xloc: X location. This parameter can be a value between 0 and this width - 1
+ * @param  yloc: Y location. This parameter can be a value between 0 and this height - 1
+ */
+void SSD1306::drawSprite(const PageSpriteDef_t *image, SSD1306_COLOR_t color, uint16_t xloc, uint16_t yloc) {
 	// Check for border collisions
 	if(
 		this->width <= (xloc + image->spriteWidth) ||
@@ -302,19 +610,90 @@ void SSD1306::drawSprite(const SpriteDef_t *image, SSD1306_COLOR_t color, uint16
 		return;
 	}
 
-	i=0;
-	for(y=0; y < image->spriteHeight; y++) {
-		for(x=0; x < image->spriteWidth; x++) {
-			byte_number = floor(i/(double)16);	// Calc in which byte pixel is located
-			bit_number = (i%16);				// Calc which bit of that byte is our pixle
-			b = image->data[byte_number];				// Retrieve byte
-			//p = (b << bit_number) & 0x8000;		// Move byte so our bit is the left most bit
-			i++;
-			if((b << bit_number) & 0x8000) {
-				drawPixel(xloc + x, yloc + y, (SSD1306_COLOR_t) color);
-			} else {
-				drawPixel(xloc + x, yloc + y, (SSD1306_COLOR_t) !color);
+	drawBitmap(image->data, image->spriteWidth, image->spriteWidth, image->spriteHeight, color, xloc, yloc);
+}
+
+/**
+ * Writes vertical pixel columns into the page buffer
+ *
+ * @note   Clipping is done once for the whole block, cleared bits are drawn with the opposite color
+ * @param  x: X location of the first column
+ * @param  y: Y location of the top row
+ * @param  *columns: Pixel columns, bit n is row n
+ * @param  w: Number of columns
+ * @param  h: Number of rows, max 32
+ * @param  color: Color used for set bits. This parameter can be a value of @ref SSD1306_COLOR_t enumeration
+ */
+void SSD1306::blitColumns(uint16_t x, uint16_t y, const uint32_t *columns, uint8_t w, uint8_t h, SSD1306_COLOR_t color) {
+	uint8_t shift, page, lastPage, p, i, m, b;
+	uint32_t rowMask;
+	int8_t offset;
+	uint8_t *dst;
+
+	// Clip once for the whole block
+	if(x >= width || y >= height || w == 0 || h == 0) return;
+	if(x + w > width) w = width - x;
+	if(y + h > height) h = height - y;
+	if(h > 32) h = 32;
+
+	if(inverted) {
+		color = (SSD1306_COLOR_t)!color;
+	}
+
+	shift = y & 7;
+	page = y >> 3;
+	lastPage = (y + h - 1) >> 3;
+	rowMask = (h == 32) ? 0xFFFFFFFF : ((uint32_t)1 << h) - 1;
+
+	for(p = page; p <= lastPage; p++) {
+		// Bit offset of this page within the columns
+		offset = 8*(p - page) - shift;
+		m = (offset < 0) ? (uint8_t)(rowMask << -offset) : (uint8_t)(rowMask >> offset);
+		dst = &buffer[p*width + x];
+
+		for(i = 0; i < w; i++) {
+			b = (offset < 0) ? (uint8_t)(columns[i] << -offset) : (uint8_t)(columns[i] >> offset);
+			if(color == BLACK) b = ~b;
+			dst[i] = (dst[i] & ~m) | (b & m);
+		}
+		markDirty(x, x + w - 1, p);
+	}
+}
+
+/**
+ * Draws a row major bit stream (sprites, images) with the column blitter
+ *
+ * @param  *data: Bit stream, MSB first, rows are not padded
+ * @param  w: Width of the image
+ * @param  h: Height of the image
+ * @param  xloc: X location
+ * @param  yloc: Y location
+ * @param  color: Color used for drawing. This parameter can be a value of @ref SSD1306_COLOR_t enumeration
+ */
+void SSD1306::blitStream(const uint16_t *data, uint16_t w, uint16_t h, uint16_t xloc, uint16_t yloc, SSD1306_COLOR_t color) {
+	uint32_t columns[16];
+	uint32_t bit, b;
+	uint16_t x0, y0, y;
+	uint8_t n, hb, off, x;
+
+	// Transpose in blocks of 16 columns x 32 rows
+	for(y0 = 0; y0 < h; y0 += 32) {
+		hb = (h - y0 > 32) ? 32 : h - y0;
+		for(x0 = 0; x0 < w; x0 += 16) {
+			n = (w - x0 > 16) ? 16 : w - x0;
+			memset(columns, 0, sizeof(columns));
+
+			bit = (uint32_t)y0*w + x0;
+			for(y = 0; y < hb; y++, bit += w) {
+				off = bit & 15;
+				b = (uint32_t)data[bit >> 4] << 16;
+				if(off + n > 16) b |= data[(bit >> 4) + 1];
+				b <<= off;
+				for(x = 0; b && x < n; x++, b <<= 1) {
+					if(b & 0x80000000) columns[x] |= (uint32_t)1 << y;
+				}
 			}
+			blitColumns(xloc + x0, yloc + y0, columns, n, hb, color);
 		}
 	}
 }
@@ -329,6 +708,8 @@ void SSD1306::drawSprite(const SpriteDef_t *image, SSD1306_COLOR_t color, uint16
  * @returns Character written
  */
 char SSD1306::putC(char ch, FontDef_t* font, SSD1306_COLOR_t color) {
+	uint32_t columns[16];
+	const uint16_t *glyph;
 	uint32_t y, b, x;
 
 	/* Check available space in display */
@@ -339,21 +720,23 @@ char SSD1306::putC(char ch, FontDef_t* font, SSD1306_COLOR_t color) {
 		return 0;
 	}
 
-	/* Go through font */
+	if(ch==176)
+		glyph = &font->data[95*font->FontHeight];
+	else if(ch==194)
+		return ch;
+	else
+		glyph = &font->data[(ch - 32) * font->FontHeight];
+
+	/* Transpose glyph rows into display columns */
+	memset(columns, 0, sizeof(columns));
 	for(y = 0; y < font->FontHeight; y++) {
-		if(ch==176)
-			b = font->data[95*font->FontHeight + y];
-		else if(ch==194)
-			return ch;
-		else
-			b = font->data[(ch - 32) * font->FontHeight + y];
-		for(x = 0; x < font->FontWidth; x++) {
-			if((b << x) & 0x8000)
-				drawPixel(currentX + x, currentY + y, (SSD1306_COLOR_t) color);
-			else
-				drawPixel(currentX + x, currentY + y, (SSD1306_COLOR_t) !color);
+		b = glyph[y];
+		for(x = 0; b && x < font->FontWidth; x++, b <<= 1) {
+			if(b & 0x8000)
+				columns[x] |= (uint32_t)1 << y;
 		}
 	}
+	blitColumns(currentX, currentY, columns, font->FontWidth, font->FontHeight, color);
 
 	/* Increase position pointer */
 	currentX += font->FontWidth;
@@ -415,6 +798,107 @@ char SSD1306::putS(char* str, FontDef_t* font, SSD1306_COLOR_t color, ALIGMENT_t
 	return putS(str, font, color);
 }
 
+/**
+ * Puts character from a page layout font to internal RAM
+ *
+ * @note   @ref updateScreen() must be called after that in order to see updated display screen
+ * @param  ch: Character to be written
+ * @param  *Font: Pointer to @ref PageFontDef_t structure with used font
+ * @param  color: Color used for drawing. This parameter can be a value of @ref SSD1306_COLOR_t enumeration
+ * @returns Character written
+ */
+char SSD1306::putC(char ch, const PageFontDef_t* font, SSD1306_COLOR_t color) {
+	uint8_t index;
+
+	/* Check available space in display */
+	if(
+		width <= (currentX + font->FontWidth) ||
+		height <= (currentY + font->FontHeight)
+	) {
+		return 0;
+	}
+
+	if((uint8_t)ch==176)
+		index = font->degree;
+	else if((uint8_t)ch==194)
+		return ch;
+	else
+		index = (uint8_t)ch - font->first;
+	if(index >= font->count) {
+		return 0;
+	}
+
+	/* Glyphs are stored in display layout padded to the cell, no transposition needed */
+	drawBitmap(&font->data[index * font->FontWidth * ((font->FontHeight + 7) / 8)],
+			font->widths[index] < font->FontWidth ? font->widths[index] : font->FontWidth,
+			font->FontWidth, font->FontHeight, color, currentX, currentY);
+
+	/* Increase position pointer */
+	currentX += font->widths[index];
+
+	return ch;
+}
+
+/**
+ * Puts string from a page layout font to internal RAM
+ *
+ * @note   @ref updateScreen() must be called after that in order to see updated display screen
+ * @param  *str: String to be written
+ * @param  *Font: Pointer to @ref PageFontDef_t structure with used font
+ * @param  color: Color used for drawing. This parameter can be a value of @ref SSD1306_COLOR_t enumeration
+ * @returns Zero on success or character value when function failed
+ */
+char SSD1306::putS(const char* str, const PageFontDef_t* font, SSD1306_COLOR_t color) {
+	/*Write characters */
+	while(*str) {
+		/* Write character by character */
+		if(putC(*str, font, color) != *str) {
+			// Return error
+			return *str;
+		}
+
+		// Increase string pointer
+		str++;
+	}
+
+	// Everything OK, zero should be returned
+	return *str;
+}
+
+/**
+ * Puts string from a page layout font with alignment to internal RAM
+ *
+ * @note   currentPosition will be (partly) ignored
+ * @note   @ref updateScreen() must be called after that in order to see updated display screen
+ * @param  *str: String to be written
+ * @param  *Font: Pointer to @ref PageFontDef_t structure with used font
+ * @param  color: Color used for drawing. This parameter can be a value of @ref SSD1306_COLOR_t enumeration
+ * @param  aligment: @ref ALIGMENT_t aligment on i.e. horizontal/vertical center
+ * @returns Zero on success or character value when function failed
+ */
+char SSD1306::putS(const char* str, const PageFontDef_t* font, SSD1306_COLOR_t color, ALIGMENT_t aligment) {
+	uint16_t length = 0;
+	uint8_t index;
+	const char *c;
+
+	// Sum up glyph advances
+	for(c = str; *c; c++) {
+		if((uint8_t)*c == 194) continue;
+		index = ((uint8_t)*c == 176) ? font->degree : (uint8_t)*c - font->first;
+		if(index < font->count) length += font->widths[index];
+	}
+	if(length > width) length = width;
+
+	if(aligment == VERTICAL_CENTER)
+		gotoXY(currentX, (height-font->FontHeight)/2);
+	if(aligment == HORIZONTAL_CENTER)
+		gotoXY((width-length)/2, currentY);
+	if(aligment == CENTER)
+		gotoXY((width-length)/2, (height-font->FontHeight)/2);
+
+	return putS(str, font, color);
+}
+
 /**
  * Draws line on display
  *
@@ -619,6 +1103,7 @@ void SSD1306::drawFilledCircle(uint16_t x0, uint16_t y0, uint16_t r, SSD1306_COL
 I2C::I2C(I2C_HandleTypeDef *hi2c, uint8_t address) {
 	this->hi2c = hi2c;
 	this->address = address;
+	this->bytesSent = 0;
 	uint32_t p = 250000;
 	while(p>0)
 		p--;
@@ -635,6 +1120,7 @@ void I2C::write(uint8_t reg, uint8_t data) {
 	dt[0] = reg;
 	dt[1] = data;
 	HAL_I2C_Master_Transmit(hi2c, address, dt, 2, 10);
+	bytesSent += 2;
 }
 
 /**
@@ -645,11 +1131,50 @@ void I2C::write(uint8_t reg, uint8_t data) {
  * @param  count: how many bytes will be written
  */
 void I2C::writeMulti(uint8_t reg, uint8_t *data, uint16_t count) {
-	uint8_t dt[count + 1];
-	dt[0] = reg;
-	uint8_t i;
-	for(i = 1; i <= count; i++) {
-		dt[i] = data[i-1];
+	// Control byte is sent as 8 bit memory address, no copy of data needed
+	HAL_I2C_Mem_Write(hi2c, address, reg, I2C_MEMADD_SIZE_8BIT, data, count, 10);
+	bytesSent += count + 1;
+}
+
+/**
+ * Writes multi bytes to slave using DMA
+ *
+ * @note   data must stay valid until the transfer completed
+ * @param  reg: register to write to
+ * @param  *data: pointer to data array to write it to slave
+ * @param  count: how many bytes will be written
+ * @returns HAL_OK when transfer was started
+ */
+HAL_StatusTypeDef I2C::writeMultiDMA(uint8_t reg, uint8_t *data, uint16_t count) {
+	HAL_StatusTypeDef status = HAL_I2C_Mem_Write_DMA(hi2c, address, reg, I2C_MEMADD_SIZE_8BIT, data, count);
+
+	if(status == HAL_OK) {
+		bytesSent += count + 1;
 	}
-	HAL_I2C_Master_Transmit(hi2c, address, dt, count, 10);
+	return status;
+}
+
+/**
+ * Returns whether a transfer is in progress
+ *
+ * @returns boolean: bus busy
+ */
+uint8_t I2C::isBusy(void) {
+	return HAL_I2C_GetState(hi2c) != HAL_I2C_STATE_READY;
+}
+
+/**
+ * Returns the amount of bytes sent to the slave, control bytes included
+ *
+ * @returns bytes sent since last reset
+ */
+uint32_t I2C::getBytesSent(void) {
+	return bytesSent;
+}
+
+/**
+ * Resets the sent bytes counter
+ */
+void I2C::resetBytesSent(void) {
+	bytesSent = 0;
 }
@@ -0,0 +1,112 @@
+/*******************************************************************************
+ * Copyright (C) 2019 Julian Hellner - All Rights Reserved
+ *
+ * The file FeedForward.cpp is part of Reflow.
+ *
+ * Unauthorized copying of this file, via any medium is strictly prohibited
+ * Proprietary and confidential
+ *
+ * Written by Julian Hellner <hellnerjulian@gmail.com>, Jul 21, 2019
+ *
+ ******************************************************************************/
+
+#include "FeedForward.h"
+#include "string.h"
+
+#define OUTPUT_MAX 100
+
+/*
+ * Default fit (Tools/ff_fit.py) of both profiles on the reference oven of the
+ * simulation, refit with logs of the real oven. 0.1 % every 25 °C.
+ */
+static const uint16_t defaultTable[FEEDFORWARD_POINTS] = {
+	0, 11, 91, 212, 285, 421, 491, 591, 692, 800, 901, 1000, 1000
+};
+#define DEFAULT_GAIN 48.5f // % per °C/s
+#define DEFAULT_LEAD 9000 // ms
+
+/**
+ * Initializes the model with the default fit
+ */
+FeedForward::FeedForward() {
+	setTable(defaultTable);
+	this->gain = Q16_16(DEFAULT_GAIN);
+	this->lead = DEFAULT_LEAD;
+}
+
+/**
+ * Sets the steady state heat loss
+ *
+ * @param *table: FEEDFORWARD_POINTS powers in 0.1 %, every FEEDFORWARD_STEP °C from 0 °C
+ */
+void FeedForward::setTable(const uint16_t *table) {
+	memcpy(this->table, table, sizeof(this->table));
+}
+
+/**
+ * Sets the thermal gain
+ *
+ * @param gain: Power in % needed per °C/s of heating rate
+ */
+void FeedForward::setGain(Q16_16 gain) {
+	this->gain = gain;
+}
+
+/**
+ * Sets how far the planned setpoint is looked ahead
+ *
+ * @note should match the dead time of the oven
+ *
+ * @param lead: Time in ms
+ */
+void FeedForward::setLead(uint32_t lead) {
+	this->lead = lead;
+}
+
+/**
+ * Returns how far the planned setpoint is looked ahead
+ *
+ * @returns time in ms
+ */
+uint32_t FeedForward::getLead() {
+	return this->lead;
+}
+
+/**
+ * Returns the power holding a temprature
+ *
+ * @param w: Temprature in °C
+ * @returns power in %
+ */
+Q16_16 FeedForward::getLoss(Q16_16 w) {
+	int32_t position, index, fraction, loss;
+
+	// Table position in 1/256 steps, clamped to the table
+	position = (int32_t)(((int64_t)w.raw() << 8) / (FEEDFORWARD_STEP << 16));
+	if(position < 0) position = 0;
+	if(position > (FEEDFORWARD_POINTS-1) << 8) position = (FEEDFORWARD_POINTS-1) << 8;
+	index = position >> 8;
+	fraction = position & 0xFF;
+
+	loss = table[index] << 8;
+	if(index < FEEDFORWARD_POINTS-1)
+		loss += ((int32_t)table[index+1] - table[index]) * fraction;
+
+	// 0.1 % in 1/256 to %
+	return Q16_16::fromRatio(loss, 10 << 8);
+}
+
+/**
+ * Calculates the feed-forward power
+ *
+ * @param w: Planned setpoint in °C
+ * @param slope: Planned rate of the setpoint in °C/s
+ * @returns power in % (0-100)
+ */
+Q16_16 FeedForward::compute(Q16_16 w, Q16_16 slope) {
+	Q16_16 u = getLoss(w) + gain * slope;
+
+	if(u < Q16_16(0)) return Q16_16(0);
+	if(u > Q16_16(OUTPUT_MAX)) return Q16_16(OUTPUT_MAX);
+	return u;
+}
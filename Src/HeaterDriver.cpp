@@ -0,0 +1,299 @@
+/*******************************************************************************
+ * Copyright (C) 2019 Julian Hellner - All Rights Reserved
+ *
+ * The file HeaterDriver.cpp is part of Reflow.
+ *
+ * Unauthorized copying of this file, via any medium is strictly prohibited
+ * Proprietary and confidential
+ *
+ * Written by Julian Hellner <hellnerjulian@gmail.com>, Jul 13, 2019
+ *
+ ******************************************************************************/
+
+#include "HeaterDriver.h"
+
+extern HeaterDriver *heater;
+
+/*
+ * Firing delay as fraction of the half cycle (1/65536) for power k/64 of a
+ * resistive load. Inverse of P(a) = 1 - a/pi + sin(2a)/(2pi).
+ */
+static const uint16_t phaseTable[HEATER_LUT_SIZE] = {
+	65535, 56687, 54305, 52598, 51212, 50022, 48963, 48001,
+	47112, 46282, 45499, 44755, 44044, 43361, 42701, 42063,
+	41443, 40839, 40248, 39670, 39103, 38545, 37996, 37454,
+	36918, 36388, 35863, 35341, 34823, 34307, 33793, 33280,
+	32768, 32256, 31743, 31229, 30713, 30195, 29673, 29148,
+	28618, 28082, 27540, 26991, 26433, 25866, 25288, 24697,
+	24093, 23473, 22835, 22175, 21492, 20781, 20037, 19254,
+	18424, 17535, 16573, 15514, 14324, 12938, 11231, 8849,
+	0
+};
+
+/**
+ * Initializes the heater drive
+ *
+ * @note the timer must be set up in one pulse PWM2 mode on channel 1
+ *
+ * @param *tim: Timer driving the triac gate
+ */
+HeaterDriver::HeaterDriver(TIM_TypeDef *tim) {
+	assert_param(tim);
+
+	this->tim = tim;
+	this->mode = HEATER_PHASE;
+	this->power = 0;
+	this->phaseDelay = phaseTable[0];
+	this->lastCrossing = 0;
+	this->halfPeriod = 0;
+	this->halfCycle = 0;
+	this->burstOn = 0;
+	this->accumulator = 0;
+	this->crossings = 0;
+	this->fired = 0;
+	this->missed = 0;
+	this->glitches = 0;
+	this->gateDelay = 0;
+	unlock();
+
+	// Zero cross periods are measured with the cycle counter
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+	// Compare and reload are written while the timer stands, no preload needed
+	LL_TIM_DisableARRPreload(tim);
+	LL_TIM_OC_DisablePreload(tim, LL_TIM_CHANNEL_CH1);
+	// Gate stays off while the counter is below compare
+	LL_TIM_OC_SetCompareCH1(tim, 0xFFFF);
+	LL_TIM_CC_EnableChannel(tim, LL_TIM_CHANNEL_CH1);
+	LL_TIM_EnableAllOutputs(tim);
+	LL_TIM_GenerateEvent_UPDATE(tim);
+}
+
+/**
+ * Sets the modulation mode
+ *
+ * @param mode: @ref HEATER_MODE_t phase angle or burst fire
+ */
+void HeaterDriver::setMode(HEATER_MODE_t mode) {
+	this->mode = mode;
+}
+
+/**
+ * Returns the modulation mode
+ *
+ * @returns @ref HEATER_MODE_t mode
+ */
+HEATER_MODE_t HeaterDriver::getMode() {
+	return this->mode;
+}
+
+/**
+ * Sets the heating power
+ *
+ * @note the firing angle is linearized, so the delivered power follows the setting
+ *
+ * @param power: 0 - HEATER_POWER_MAX
+ */
+void HeaterDriver::setPower(uint16_t power) {
+	uint32_t position;
+	uint16_t index, fraction;
+
+	if(power > HEATER_POWER_MAX) power = HEATER_POWER_MAX;
+
+	// Interpolate the table in 1/256 steps
+	position = (uint32_t)power * (HEATER_LUT_SIZE-1) * 256 / HEATER_POWER_MAX;
+	index = position >> 8;
+	fraction = position & 0xFF;
+	if(index >= HEATER_LUT_SIZE-1) {
+		this->phaseDelay = phaseTable[HEATER_LUT_SIZE-1];
+	} else {
+		this->phaseDelay = phaseTable[index] - (((int32_t)(phaseTable[index] - phaseTable[index+1]) * fraction) >> 8);
+	}
+	this->power = power;
+}
+
+/**
+ * Returns the heating power
+ *
+ * @returns power 0 - HEATER_POWER_MAX
+ */
+uint16_t HeaterDriver::getPower() {
+	return this->power;
+}
+
+/**
+ * Returns the detected mains frequency
+ *
+ * @returns @ref MAINS_t frequency, MAINS_UNKNOWN while the heater is locked out
+ */
+MAINS_t HeaterDriver::getMains() {
+	return this->mains;
+}
+
+/**
+ * Returns the number of zero crosses seen
+ *
+ * @returns zero crosses
+ */
+uint32_t HeaterDriver::getCrossings() {
+	return this->crossings;
+}
+
+/**
+ * Returns the number of half cycles the triac was fired in
+ *
+ * @returns fired half cycles
+ */
+uint32_t HeaterDriver::getFired() {
+	return this->fired;
+}
+
+/**
+ * Returns the number of zero crosses that did not arrive in time
+ *
+ * @returns missed zero crosses
+ */
+uint32_t HeaterDriver::getMissed() {
+	return this->missed;
+}
+
+/**
+ * Returns the number of zero cross edges ignored as noise
+ *
+ * @returns ignored edges
+ */
+uint32_t HeaterDriver::getGlitches() {
+	return this->glitches;
+}
+
+/**
+ * Returns the delay from the zero cross to the last gate pulse
+ *
+ * @note the gate interrupt overwrites it on every pulse, a halfword store is atomic
+ *
+ * @returns delay in µs, the last one when no gate fired since
+ */
+uint16_t HeaterDriver::getGateDelay() {
+	return gateDelay;
+}
+
+/**
+ * Locks the heater out when the zero cross signal stopped
+ *
+ * @note needs to be called in the control loop, at least every 60 s
+ */
+void HeaterDriver::check() {
+	__disable_irq();
+	if(mains != MAINS_UNKNOWN && DWT->CYCCNT - lastCrossing > 3*halfPeriod) {
+		missed++;
+		unlock();
+	}
+	__enable_irq();
+}
+
+/**
+ * Stops firing until the mains frequency is detected again
+ */
+void HeaterDriver::unlock() {
+	this->mains = MAINS_UNKNOWN;
+	this->lockCount = 0;
+}
+
+/**
+ * Classifies a half cycle period
+ *
+ * @param period: Time between two zero crosses in cycles
+ * @returns @ref MAINS_t matching frequency, MAINS_UNKNOWN if it is off by more than 5 %
+ */
+MAINS_t HeaterDriver::classify(uint32_t period) {
+	uint32_t half50 = SystemCoreClock / 100;
+	uint32_t half60 = SystemCoreClock / 120;
+
+	if(period > half50 - half50/20 && period < half50 + half50/20)
+		return MAINS_50HZ;
+	if(period > half60 - half60/20 && period < half60 + half60/20)
+		return MAINS_60HZ;
+	return MAINS_UNKNOWN;
+}
+
+void HeaterFire_Callback(void) {
+	if(heater != NULL)
+		heater->__handleFire();
+}
+
+/**
+ * Handles the zero cross interrupt, arms the gate timer for this half cycle
+ *
+ * @note runs in constant time, the firing angle is prepared by setPower
+ */
+void HeaterDriver::__handleZeroCross() {
+	uint32_t now = DWT->CYCCNT;
+	uint32_t period = now - lastCrossing;
+	uint32_t reload, compare;
+	MAINS_t detected;
+
+	crossings++;
+
+	// An edge within the first half of a half cycle is noise
+	if(mains != MAINS_UNKNOWN && period < halfPeriod/2) {
+		glitches++;
+		return;
+	}
+	lastCrossing = now;
+
+	detected = classify(period);
+	if(detected == MAINS_UNKNOWN || (mains != MAINS_UNKNOWN && detected != mains)) {
+		if(mains != MAINS_UNKNOWN && period > halfPeriod + halfPeriod/2)
+			missed++;
+		unlock();
+		return;
+	}
+
+	if(mains == MAINS_UNKNOWN) {
+		// Lock on after enough valid half cycles in a row
+		halfPeriod = lockCount ? (halfPeriod + period) / 2 : period;
+		if(++lockCount < HEATER_LOCK_COUNT) return;
+		mains = detected;
+		halfCycle = 0;
+	} else {
+		halfPeriod = (halfPeriod*7 + period) / 8;
+		halfCycle ^= 1;
+	}
+
+	reload = halfPeriod / HEATER_TIMER_DIV - HEATER_GATE_GUARD;
+
+	if(mode == HEATER_BURST) {
+		// Sigma-delta over full cycles, both halves fire so no DC flows
+		if(halfCycle == 0) {
+			accumulator += power;
+			burstOn = accumulator >= HEATER_POWER_MAX;
+			if(burstOn) accumulator -= HEATER_POWER_MAX;
+		}
+		if(!burstOn) return;
+		compare = HEATER_BURST_DELAY;
+	} else {
+		if(power == 0) return;
+		compare = (halfPeriod / HEATER_TIMER_DIV * phaseDelay) >> 16;
+		if(compare < HEATER_BURST_DELAY) compare = HEATER_BURST_DELAY;
+	}
+
+	// Too late in the half cycle to latch the triac
+	if(compare + HEATER_MIN_GATE > reload) return;
+
+	LL_TIM_SetAutoReload(tim, reload);
+	LL_TIM_OC_SetCompareCH1(tim, compare);
+	LL_TIM_SetCounter(tim, 0);
+	LL_TIM_EnableCounter(tim);
+}
+
+/**
+ * Handles the gate timer compare interrupt when the triac is fired
+ *
+ * @note only the latest delay is kept, the main loop shows it far less
+ * often than the gate fires
+ */
+void HeaterDriver::__handleFire() {
+	fired++;
+	gateDelay = (DWT->CYCCNT - lastCrossing) / (SystemCoreClock / 1000000);
+}
@@ -0,0 +1,187 @@
+/*******************************************************************************
+ * Copyright (C) 2019 Julian Hellner - All Rights Reserved
+ *
+ * The file Input.cpp is part of Reflow.
+ *
+ * Unauthorized copying of this file, via any medium is strictly prohibited
+ * Proprietary and confidential
+ *
+ * Written by Julian Hellner <hellnerjulian@gmail.com>, Jul 29, 2019
+ *
+ ******************************************************************************/
+
+#include "Input.h"
+
+#define SAMPLE_MS (INPUT_TICK * INPUT_DEBOUNCE_DIV)
+
+extern Input *input;
+
+/*
+ * Quadrature steps by previous and current state (A << 1 | B), invalid
+ * transitions with both lines changed count nothing
+ */
+static const int8_t quadrature[16] = {
+	0, -1, 1, 0,
+	1, 0, 0, -1,
+	-1, 0, 0, 1,
+	0, 1, -1, 0
+};
+
+/**
+ * Initializes the input sampling
+ *
+ * @param *tim: Timer with an update every INPUT_TICK ms
+ * @param *scheduler: Receives the events
+ */
+Input::Input(TIM_TypeDef *tim, Scheduler *scheduler) {
+	assert_param(tim);
+	assert_param(scheduler);
+
+	this->tim = tim;
+	this->scheduler = scheduler;
+	this->divider = 0;
+	this->state = 0;
+	// Counters idle at 3, a key changes after 4 differing samples
+	this->count0 = 0xFF;
+	this->count1 = 0xFF;
+	for(uint8_t i = 0; i < INPUT_KEY_COUNT; i++) {
+		this->held[i] = 0;
+		this->nextRepeat[i] = 0;
+		this->interval[i] = 0;
+	}
+	this->encoder = 0x0F;
+	this->encoderCount = 0;
+	this->dropped = 0;
+}
+
+/**
+ * Starts sampling
+ */
+void Input::start() {
+	LL_TIM_SetCounter(tim, 0);
+	LL_TIM_ClearFlag_UPDATE(tim);
+	LL_TIM_EnableIT_UPDATE(tim);
+	LL_TIM_EnableCounter(tim);
+}
+
+/**
+ * Returns the debounced state of a key
+ *
+ * @param key: @ref INPUT_KEY_t key
+ * @returns 1 while the key is held
+ */
+uint8_t Input::isHeld(INPUT_KEY_t key) {
+	return (state >> key) & 1;
+}
+
+/**
+ * Returns the number of events lost because the scheduler queue was full
+ *
+ * @returns events
+ */
+uint32_t Input::getDropped() {
+	return this->dropped;
+}
+
+/**
+ * Posts an event to the scheduler
+ *
+ * @param type: @ref INPUT_EVENT_t event
+ * @param key: @ref INPUT_KEY_t key
+ */
+void Input::post(INPUT_EVENT_t type, uint8_t key) {
+	if(!scheduler->postEvent(INPUT_EVENT(type, key)))
+		dropped++;
+}
+
+/**
+ * Debounces all keys at once with a 2 bit vertical counter per key and
+ * emits press, release, long press and repeat events
+ *
+ * @param sample: Raw key state, a bit per key
+ */
+void Input::debounce(uint8_t sample) {
+	uint8_t changed = sample ^ state;
+	uint8_t key, bit;
+
+	// Counts down while the sample differs, reset to 3 when it matches again
+	count0 = ~(count0 & changed);
+	count1 = count0 ^ (count1 & changed);
+	// Rolled over from 0 to 3: differed 4 times in a row
+	changed &= count0 & count1;
+	state ^= changed;
+
+	for(key = 0; key < INPUT_KEY_COUNT; key++) {
+		bit = 1 << key;
+		if(changed & bit) {
+			if(state & bit) {
+				held[key] = 0;
+				interval[key] = INPUT_REPEAT_START / SAMPLE_MS;
+				nextRepeat[key] = (INPUT_LONG_PRESS + INPUT_REPEAT_START) / SAMPLE_MS;
+				post(INPUT_PRESS, key);
+			} else {
+				post(INPUT_RELEASE, key);
+			}
+			continue;
+		}
+		if(!(state & bit) || held[key] == 0xFFFF) continue;
+
+		held[key]++;
+		if(held[key] == INPUT_LONG_PRESS / SAMPLE_MS) {
+			post(INPUT_LONG, key);
+		} else if(held[key] == nextRepeat[key]) {
+			post(INPUT_REPEAT, key);
+			// Accelerate, the interval shrinks by a quarter per repeat
+			interval[key] -= interval[key] / 4;
+			if(interval[key] < INPUT_REPEAT_MIN / SAMPLE_MS)
+				interval[key] = INPUT_REPEAT_MIN / SAMPLE_MS;
+			nextRepeat[key] += interval[key];
+		}
+	}
+}
+
+/**
+ * Decodes the encoder, a turn counts at the detent when most of the
+ * steps since the last one went the same way
+ *
+ * @note needs every state of the turn, hence sampled on every tick
+ *
+ * @param ab: Line A << 1 | line B
+ */
+void Input::decodeEncoder(uint8_t ab) {
+	encoder = ((encoder << 2) | ab) & 0x0F;
+	encoderCount += quadrature[encoder];
+
+	// Detent, both lines high
+	if(ab != 0x03) return;
+	if(encoderCount > INPUT_ENCODER_STEPS/2)
+		post(INPUT_TURN, INPUT_KEY_UP);
+	else if(encoderCount < -INPUT_ENCODER_STEPS/2)
+		post(INPUT_TURN, INPUT_KEY_DOWN);
+	encoderCount = 0;
+}
+
+void InputTimer_Callback(void) {
+	if(input != NULL)
+		input->__handleTick();
+}
+
+/**
+ * Handles the timer update, samples keys and encoder
+ *
+ * @note keys and encoder are all on port B, one read samples them at once
+ */
+void Input::__handleTick() {
+	uint32_t port = GPIOB->IDR;
+	uint8_t sample;
+
+	decodeEncoder((port & LEFT_Pin ? 0x02 : 0) | (port & RIGHT_Pin ? 0x01 : 0));
+
+	if(++divider < INPUT_DEBOUNCE_DIV) return;
+	divider = 0;
+
+	sample = (port & UP_Pin ? 1 << INPUT_KEY_UP : 0) |
+			(port & DOWN_Pin ? 1 << INPUT_KEY_DOWN : 0) |
+			(port & SELECT_Pin ? 1 << INPUT_KEY_SELECT : 0);
+	debounce(sample);
+}
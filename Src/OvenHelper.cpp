@@ -15,14 +15,26 @@
 /**
  * Initialize OvenHelper
  *
- * @param *pid: PID Controller for the Oven
+ * @param *pid: PID Controller for the Oven, holds the setpoint
  * @param *sensor: MAX6675 sensor for controll
+ * @param *heater: Triac drive of the heating element
  */
-OvenHelper::OvenHelper(PIDController *pid, MAX6675 *sensor) {
+OvenHelper::OvenHelper(FixedPID_t *pid, MAX6675 *sensor, HeaterDriver *heater) : profileController(pid) {
 	this->pid = pid;
 	this->sensor = sensor;
+	this->heater = heater;
 	this->state = STATE_OFF;
 	this->power = 0;
+	this->profcon = NULL;
+	this->feedForward = NULL;
+	this->settings = NULL;
+	this->smith = NULL;
+	this->inner = NULL;
+	this->airSetpoint = Q16_16(0);
+	this->boardLag = CASCADE_BOARD_LAG;
+	this->outerSteps = 0;
+	this->activeGains = NULL;
+	setPeriod(OVEN_PERIOD);
 }
 
 /** Gets the current ProfileController
@@ -33,6 +45,97 @@ ProfileController* OvenHelper::getProfCon() {
 	return profcon;
 }
 
+/**
+ * Sets the model the planned power is calculated with
+ *
+ * @param *feedForward: Heat loss and thermal gain of the oven, NULL for PID only
+ */
+void OvenHelper::setFeedForward(FeedForward *feedForward) {
+	this->feedForward = feedForward;
+	if(feedForward == NULL)
+		getHeaterPID()->setFeedForward(Q16_16(0));
+}
+
+/**
+ * Sets cascade control, the PID passed to the constructor then
+ * controls the board thermocouple and sets the air temprature for
+ * the inner PID
+ *
+ * @param *inner: PID of the air thermocouple, NULL for single loop control on the air
+ */
+void OvenHelper::setCascade(FixedPID_t *inner) {
+	this->inner = inner;
+	pid->setFeedForward(Q16_16(0));
+	if(inner == NULL) pid->setLimits(Q16_16(0), Q16_16(100));
+	pid->reset();
+	setPeriod(this->period);
+}
+
+/**
+ * Sets the time constant the board follows the air with
+ *
+ * @note heavy loads lag more, the board loop corrects the rest
+ *
+ * @param lag: Time constant in ms
+ */
+void OvenHelper::setBoardLag(uint32_t lag) {
+	this->boardLag = lag;
+}
+
+/**
+ * Sets the rate loop() is called at, the PIDs use it as fixed time step
+ *
+ * @param period: Time between calls in ms, CASCADE_OUTER_PERIOD at most
+ */
+void OvenHelper::setPeriod(uint32_t period) {
+	this->period = period;
+	getHeaterPID()->setPeriod(period);
+	// The board loop runs every few calls
+	if(inner != NULL) pid->setPeriod(CASCADE_OUTER_PERIOD / period * period);
+}
+
+/** Gets the PID driving the heater
+ *
+ * @returns the inner PID in cascade mode, else the PID of the setpoint
+ */
+FixedPID_t* OvenHelper::getHeaterPID() {
+	return inner != NULL ? inner : pid;
+}
+
+/** Gets the air temprature the cascade asks for
+ *
+ * @returns air setpoint in °C
+ */
+Q16_16 OvenHelper::getAirSetpoint() {
+	return inner != NULL ? airSetpoint : pid->getPrecise();
+}
+
+/**
+ * Sets the dead time compensation
+ *
+ * @param *smith: Predictor the PID controls the undelayed temprature with, NULL for the measured one
+ */
+void OvenHelper::setSmithPredictor(SmithPredictor *smith) {
+	this->smith = smith;
+}
+
+/**
+ * Sets where tuned gains are stored and which tuning rule is used
+ *
+ * @param *settings: Persistent settings, NULL does not store the gains
+ */
+void OvenHelper::setSettings(Settings *settings) {
+	this->settings = settings;
+}
+
+/** Gets the relay experiment
+ *
+ * @returns the autotuner, for progress and results
+ */
+Autotune* OvenHelper::getAutotune() {
+	return &this->autotune;
+}
+
 /**
  * Returns the current state of the Oven i.e. Off, Bake or Reflow
  *
@@ -55,13 +158,12 @@ uint8_t OvenHelper::getPower() {
  * @param new power setting in percent
  */
 void OvenHelper::setPower(uint8_t power) {
-	if(STATE_OFF) {
+	if(this->state == STATE_OFF) {
 		this->power = 0;
-		LL_TIM_OC_SetCompareCH1(TIM3, 60000);
 	} else {
 		this->power = power;
-		LL_TIM_OC_SetCompareCH1(TIM3, 60000 - 60000* this->power/100);
 	}
+	heater->setPower((uint16_t)this->power * HEATER_POWER_MAX / 100);
 }
 
 /**
@@ -70,40 +172,233 @@ void OvenHelper::setPower(uint8_t power) {
  * @param *profile: Temprature profile to be reflowed with
  */
 void OvenHelper::startReflow(CURVE_t *profile) {
+	SampleHistory *history = sensor->getHistory1();
+	Q16_16 start = history->getCount() ? history->getValueQ() : Q16_16(PROFILE_START_DEFAULT);
+
+	// The trajectory starts at the current oven temprature
+	profileController.load(profile, start);
+	profcon = &profileController;
+	startCascade();
 	this->state = STATE_REFLOW;
-	profcon = new ProfileController(this->pid, profile);
 }
 
 /**
  * Start the Oven in Baking mode
  */
 void OvenHelper::startBaking() {
+	startCascade();
 	this->state = STATE_BAKE;
 }
 
+/**
+ * Start the relay autotune, the gains are set and stored when done
+ *
+ * @param temprature: Temprature to tune at in °C, 0 for the current setpoint
+ */
+void OvenHelper::startAutotune(uint16_t temprature) {
+	if(temprature == 0) temprature = pid->get();
+	if(temprature == 0) temprature = AUTOTUNE_TEMPRATURE;
+
+	// The relay alone drives the heater
+	getHeaterPID()->setFeedForward(Q16_16(0));
+	autotune.start(temprature, AUTOTUNE_POWER_HIGH, AUTOTUNE_POWER_LOW);
+	this->state = STATE_AUTOTUNE;
+}
+
 /**
  * Power off the oven
  */
 void OvenHelper::switchOff() {
 	this->state = STATE_OFF;
+	scheduleGains(NULL);
+	getHeaterPID()->setFeedForward(Q16_16(0));
+	this->setPower(0);
+}
+
+/**
+ * Passes the power the planned setpoint needs to the PID
+ *
+ * @note the profile is looked ahead by the dead time of the oven, so the
+ * heater changes before the thermocouple would show the error
+ */
+void OvenHelper::updateFeedForward() {
+	Q16_16 w, slope;
+	uint32_t t;
+
+	if(feedForward == NULL) return;
+
+	if(this->state == STATE_REFLOW) {
+		t = profcon->getTimePassed() + feedForward->getLead();
+		w = profcon->getSetpointAt(t);
+		slope = profcon->getSlopeAt(t);
+	} else {
+		w = pid->getPrecise();
+		slope = Q16_16(0);
+	}
+	// The air is held off the board setpoint by what the board loop asks for
+	if(inner != NULL) w += airSetpoint - pid->getPrecise();
+
+	getHeaterPID()->setFeedForward(feedForward->compute(w, slope));
 }
 
 /**
- * Main loop needed to be called to regulate the oven
+ * Switches the heater PID to the gains of a profile segment
+ *
+ * @note bumpless, the integral takes the step of the proportional and
+ * derivative terms. The default gains are restored after the segment.
+ *
+ * @param *gains: Factors of the segment, NULL for the default gains
+ */
+void OvenHelper::scheduleGains(const GAINSET_t *gains) {
+	FixedPID_t *loop = getHeaterPID();
+
+	if(gains == activeGains) return;
+
+	// Leaving the defaults, e.g. set by the autotune, they are needed again later
+	if(activeGains == NULL)
+		loop->getGains(&defaultGains.kp, &defaultGains.ki, &defaultGains.kd);
+
+	activeGains = gains;
+	if(gains == NULL) {
+		loop->setGainsBumpless(defaultGains.kp, defaultGains.ki, defaultGains.kd);
+		return;
+	}
+	loop->setGainsBumpless(defaultGains.kp * gains->kp, defaultGains.ki * gains->ki, defaultGains.kd * gains->kd);
+}
+
+/**
+ * Lets the board loop start from the setpoint
+ */
+void OvenHelper::startCascade() {
+	if(inner == NULL) return;
+	pid->reset();
+	airSetpoint = pid->getPrecise();
+	outerSteps = 0;
+}
+
+/**
+ * Runs the board loop at its own rate and passes the air setpoint to the inner loop
+ *
+ * @note the air follows the setpoint planned one board lag ahead, the board
+ * loop adds a correction within CASCADE_AIR_OFFSET. The air setpoint is kept
+ * within CASCADE_AIR_BAND of the air, so the board loop does not wind up
+ * while the heater can not follow. Without a board reading the air is
+ * controlled to the setpoint directly.
+ *
+ * @param planned: Setpoint one board lag ahead in °C
+ */
+void OvenHelper::updateCascade(Q16_16 planned) {
+	SampleHistory *board = sensor->getHistory2();
+	Q16_16 air = sensor->getHistory1()->getValueQ();
+	Q16_16 low = planned - Q16_16(CASCADE_AIR_OFFSET);
+	Q16_16 high = planned + Q16_16(CASCADE_AIR_OFFSET);
+
+	if(board->getCount() == 0 || HAL_GetTick() - board->getTick() > CASCADE_STALE) {
+		airSetpoint = pid->getPrecise();
+		pid->reset();
+		outerSteps = 0;
+	} else if(outerSteps == 0) {
+		outerSteps = CASCADE_OUTER_PERIOD / period;
+		if(low < air - Q16_16(CASCADE_AIR_BAND)) low = air - Q16_16(CASCADE_AIR_BAND);
+		if(high > air + Q16_16(CASCADE_AIR_BAND)) high = air + Q16_16(CASCADE_AIR_BAND);
+		if(high > Q16_16(CASCADE_AIR_MAX)) high = Q16_16(CASCADE_AIR_MAX);
+		if(low > high) low = high;
+
+		pid->setFeedForward(planned);
+		pid->setLimits(low, high);
+		airSetpoint = pid->controlPrecise(board->getValueQ(), board->getSlopeQ());
+	}
+	if(outerSteps > 0) outerSteps--;
+	inner->setPrecise(airSetpoint);
+}
+
+/**
+ * Runs the PID on the measured or, with a Smith predictor, the predicted temprature
+ *
+ * @param *history: Samples of the controlled thermocouple
+ * @returns heater power in %
+ */
+uint8_t OvenHelper::regulate(SampleHistory *history) {
+	Q16_16 x = history->getValueQ();
+	Q16_16 slope = history->getSlopeQ();
+
+	if(smith != NULL) {
+		x = smith->predict(x);
+		slope = smith->predictSlope(slope);
+	}
+	return getHeaterPID()->control(x, slope);
+}
+
+/**
+ * Applies the measured gains and stores them
+ */
+void OvenHelper::finishAutotune() {
+	TUNING_RULE_t rule = settings != NULL ? settings->getTuningRule() : TUNING_TYREUS_LUYBEN;
+	Q16_16 kp, ki, kd;
+
+	this->switchOff();
+	if(autotune.getState() != AUTOTUNE_DONE) return;
+
+	autotune.getGains(rule, &kp, &ki, &kd);
+	getHeaterPID()->setGains(kp, ki, kd);
+	getHeaterPID()->reset();
+
+	// Runs in the control interrupt, the main loop writes the flash
+	if(settings != NULL) {
+		settings->setGains(kp, ki, kd);
+		settings->markDirty();
+	}
+}
+
+/**
+ * Main loop needed to be called every period to regulate the oven
  */
 void OvenHelper::loop() {
+	SampleHistory *history = sensor->getHistory1();
+	uint32_t t;
+
+	heater->check();
+
+	// The model follows the heater in every state, also while off
+	if(smith != NULL) smith->update(this->power);
+
+	if(this->state != STATE_OFF && history->getCount() == 0) {
+		// No valid reading yet, keep the heater off
+		this->setPower(0);
+		return;
+	}
+
 	if(this->state == STATE_BAKE) {
-		this->setPower(pid->control(sensor->getTemprature1()/4));
+		if(inner != NULL) updateCascade(pid->getPrecise());
+		updateFeedForward();
+		this->setPower(regulate(history));
 	} else if(this->state == STATE_REFLOW) {
 		if(profcon == NULL) {
 			this->state = STATE_OFF;
 			return;
 		}
 
-		if(profcon->control(sensor->getTemprature1()/4) == 1) {
+		if(profcon->control() == 1) {
 			// Finished
 			this->switchOff();
+			return;
+		}
+		scheduleGains(profcon->getGains());
+		if(inner != NULL) {
+			// Past the end the last setpoint is held, the board is still on its way
+			t = profcon->getTimePassed() + boardLag;
+			if(t >= profcon->getDuration()) t = profcon->getDuration() - 1;
+			updateCascade(profcon->getSetpointAt(t));
+		} else if(smith != NULL) {
+			// The predicted temprature is one dead time ahead, so is its setpoint
+			pid->setPrecise(profcon->getSetpointAt(profcon->getTimePassed() + smith->getDeadTime()));
 		}
-		this->setPower(pid->control(sensor->getTemprature1()/4));
+		updateFeedForward();
+		this->setPower(regulate(history));
+	} else if(this->state == STATE_AUTOTUNE) {
+		this->setPower(autotune.update(history));
+
+		if(autotune.getState() == AUTOTUNE_DONE || autotune.getState() == AUTOTUNE_FAILED)
+			finishAutotune();
 	}
 }
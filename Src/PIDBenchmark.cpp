@@ -0,0 +1,58 @@
+/*******************************************************************************
+ * Copyright (C) 2019 Julian Hellner - All Rights Reserved
+ *
+ * The file PIDBenchmark.cpp is part of Reflow.
+ *
+ * Unauthorized copying of this file, via any medium is strictly prohibited
+ * Proprietary and confidential
+ *
+ * Written by Julian Hellner <hellnerjulian@gmail.com>, 10.07.2019
+ *
+ ******************************************************************************/
+
+#include "PIDBenchmark.h"
+
+/**
+ * Runs the float and the Q16_16 controller over the same heating ramp and
+ * counts the cycles of each step with the DWT cycle counter
+ *
+ * @param *result: Cycle counts and output difference
+ */
+void PID_Benchmark(PID_BENCHMARK_t *result) {
+	FloatPID_t floatPID(150, 1.8f, 0.25f, 25.0f);
+	FixedPID_t fixedPID(150, Q16_16(1.8f), Q16_16(0.25f), Q16_16(25.0f));
+	float floatX[PID_BENCHMARK_STEPS];
+	Q16_16 fixedX[PID_BENCHMARK_STEPS];
+	float floatSlope = 1.75f/0.22f;
+	Q16_16 fixedSlope = Q16_16(floatSlope);
+	uint32_t floatCycles = 0, fixedCycles = 0, start;
+	int floatOut, fixedOut, diff;
+	uint8_t i;
+
+	// Inputs are converted up front, only the controller step is measured
+	for(i = 0; i < PID_BENCHMARK_STEPS; i++) {
+		floatX[i] = 25.0f + i*1.75f;
+		fixedX[i] = Q16_16(floatX[i]);
+	}
+
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CYCCNT = 0;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+	result->maxDifference = 0;
+	for(i = 0; i < PID_BENCHMARK_STEPS; i++) {
+		start = DWT->CYCCNT;
+		floatOut = (int)floatPID.compute(floatX[i], floatSlope, 220);
+		floatCycles += DWT->CYCCNT - start;
+
+		start = DWT->CYCCNT;
+		fixedOut = (int)fixedPID.compute(fixedX[i], fixedSlope, 220);
+		fixedCycles += DWT->CYCCNT - start;
+
+		diff = floatOut > fixedOut ? floatOut - fixedOut : fixedOut - floatOut;
+		if(diff > result->maxDifference) result->maxDifference = diff;
+	}
+
+	result->floatCycles = floatCycles / PID_BENCHMARK_STEPS;
+	result->fixedCycles = fixedCycles / PID_BENCHMARK_STEPS;
+}
@@ -11,8 +11,12 @@
  ******************************************************************************/
 
 #include <PIDController.h>
+#include "Timebase.h"
 
 #define TOLERANCE 5
+#define OUTPUT_MIN 0
+#define OUTPUT_MAX 100
+#define MAX_DT 2000 // ms, longer pauses are not integrated
 
 /**
  * Initialize PID controller
@@ -22,14 +26,18 @@
  * @param Ki: Integral gain
  * @param Kd: Derivative gain
  */
-PIDController::PIDController(uint16_t w, float Kp, float Ki, float Kd) {
-	this->w = w;
+template<typename T>
+PIDController<T>::PIDController(uint16_t w, T Kp, T Ki, T Kd) {
+	this->w = T((int)w);
 	this->Kp = Kp;
 	this->Ki = Ki;
 	this->Kd = Kd;
-	this->previousError = 0;
-	this->integral = 0;
-	this->lastControlTime = HAL_GetTick();
+	this->feedForward = T(0);
+	this->outputMin = T(OUTPUT_MIN);
+	this->outputMax = T(OUTPUT_MAX);
+	this->lastControlTime = Timebase_GetMicros();
+	setPeriod(0);
+	reset();
 }
 
 /**
@@ -37,24 +45,148 @@ PIDController::PIDController(uint16_t w, float Kp, float Ki, float Kd) {
  *
  * @param w: Setpoint
  */
-void PIDController::set(uint16_t w) {
+template<typename T>
+void PIDController<T>::set(uint16_t w) {
+	this->w = T((int)w);
+}
+
+/**
+ * Set the setpoint with fraction, e.g. from a ramp
+ *
+ * @param w: Setpoint
+ */
+template<typename T>
+void PIDController<T>::setPrecise(T w) {
 	this->w = w;
 }
+
 /** Gets the setpoint
  *
  * @returns the setpoint w
  */
-uint16_t PIDController::get() {
+template<typename T>
+uint16_t PIDController<T>::get() {
+	return (int)this->w;
+}
+
+/** Gets the setpoint with fraction
+ *
+ * @returns the setpoint w
+ */
+template<typename T>
+T PIDController<T>::getPrecise() {
 	return this->w;
 }
 
+/**
+ * Set the gains
+ *
+ * @param Kp: Proportional gain
+ * @param Ki: Integral gain
+ * @param Kd: Derivative gain
+ */
+template<typename T>
+void PIDController<T>::setGains(T Kp, T Ki, T Kd) {
+	this->Kp = Kp;
+	this->Ki = Ki;
+	this->Kd = Kd;
+	this->KiDt = Ki * T((int)period) / T(1000);
+}
+
+/**
+ * Set the gains without a step in the output
+ *
+ * @note the integral is re-initialized, so the last output stays the same
+ * with the new proportional and derivative gains
+ *
+ * @param Kp: Proportional gain
+ * @param Ki: Integral gain
+ * @param Kd: Derivative gain
+ */
+template<typename T>
+void PIDController<T>::setGainsBumpless(T Kp, T Ki, T Kd) {
+	// Ki is already in the integral, only the P and D terms change
+	if(hasPrevious) {
+		this->integral += (this->Kp - Kp)*previousError - (this->Kd - Kd)*previousSlope;
+		if(this->integral > outputMax - feedForward) this->integral = outputMax - feedForward;
+		if(this->integral < outputMin - feedForward) this->integral = outputMin - feedForward;
+	}
+	setGains(Kp, Ki, Kd);
+}
+
+/**
+ * Get the gains
+ *
+ * @param *Kp: Proportional gain
+ * @param *Ki: Integral gain
+ * @param *Kd: Derivative gain
+ */
+template<typename T>
+void PIDController<T>::getGains(T *Kp, T *Ki, T *Kd) {
+	*Kp = this->Kp;
+	*Ki = this->Ki;
+	*Kd = this->Kd;
+}
+
+/**
+ * Set the feed-forward output the PID terms are added to
+ *
+ * @param u: Feed-forward in percent, 0 disables it
+ */
+template<typename T>
+void PIDController<T>::setFeedForward(T u) {
+	this->feedForward = u;
+}
+
+/**
+ * Set the range of the output
+ *
+ * @note 0-100 % by default, an outer cascade loop outputs a setpoint instead
+ *
+ * @param min: Lowest output
+ * @param max: Highest output
+ */
+template<typename T>
+void PIDController<T>::setLimits(T min, T max) {
+	this->outputMin = min;
+	this->outputMax = max;
+}
+
+/**
+ * Set a fixed time step, e.g. when called from a timer interrupt
+ *
+ * @note the gains are scaled once here instead of every step
+ *
+ * @param period: Time between calls in ms, 0 measures it with the SysTick
+ */
+template<typename T>
+void PIDController<T>::setPeriod(uint32_t period) {
+	this->period = period;
+	this->KiDt = Ki * T((int)period) / T(1000);
+	this->rate = period ? T(1000) / T((int)period) : T(0);
+}
+/**
+ * Clears integral and derivative history
+ */
+template<typename T>
+void PIDController<T>::reset() {
+	this->integral = T(0);
+	this->previousX = T(0);
+	this->previousError = T(0);
+	this->previousSlope = T(0);
+	this->hasPrevious = 0;
+}
+
 /**
  * Calculate whether temprature has reached setpoint wihtin a margin
  *
  * @param x: process variable: measured output
  * @returns  boolean: temprature reached
  */
-uint8_t PIDController::reachedTemprature(uint16_t x) {
+template<typename T>
+uint8_t PIDController<T>::reachedTemprature(uint16_t x) {
+	int w = (int)this->w;
+
 	if(x < w+TOLERANCE && x > w-TOLERANCE) {
 		return 1;
 	} else {
@@ -65,46 +197,132 @@ uint8_t PIDController::reachedTemprature(uint16_t x) {
 /**
  * Calculates time difference from last control loop. Also sets new last control time.
  *
- * *ToDo* handle SysTick overflows
- * @note does not respect SysTick overflow
- * @returns dt: time difference to last control loop pass
+ * @note the fraction of a ms is kept for the next pass, so dt does not drift
+ * @returns dt: time difference to last control loop pass in ms
  */
-uint32_t PIDController::calculate_dt() {
-	uint32_t dt = HAL_GetTick()-lastControlTime;
-	lastControlTime=HAL_GetTick();
+template<typename T>
+uint32_t PIDController<T>::calculate_dt() {
+	uint64_t now = Timebase_GetMicros();
+	uint32_t dt;
+
+	// compute() clamps it anyway, the division stays 32 bit
+	if(now - lastControlTime > (uint64_t)MAX_DT*1000) {
+		lastControlTime = now;
+		return MAX_DT + 1;
+	}
+	dt = (uint32_t)(now - lastControlTime) / 1000;
+	lastControlTime += (uint64_t)dt*1000;
 	return dt;
 }
 
 /**
  * Calculate control variable based on the process variable (output of the system)
  *
+ * @note the derivative is taken from the change of x since the last call
+ *
  * @param x: process variable: measured output to be compared with w
  * @returns control variable: Can be between 0-100 so percentage
  */
-uint8_t PIDController::control(uint16_t x) {
-	int output;
-	int e = this->w-x;
-	dt= this->calculate_dt();
-	uint16_t maxI=100;
+template<typename T>
+uint8_t PIDController<T>::control(T x) {
+	uint32_t dt;
+	T slope = T(0);
 
-	// Calculate the integral part of the PID controller
-	this->integral += e*dt/1000;
+	if(period != 0) {
+		if(hasPrevious) slope = (x - previousX) * rate;
+		return (int)this->step(x, slope, KiDt);
+	}
 
-	if(integral>maxI)integral=maxI;
-	if(integral<-maxI) integral=-maxI;
+	dt = this->calculate_dt();
+	if(hasPrevious && dt > 0 && dt <= MAX_DT)
+		slope = (x - previousX) / (T((int)dt) / T(1000));
 
-	// Calculate the derivative part of the PID controller
-	derivative = (e - this->previousError)*1000 / dt;
+	return (int)this->compute(x, slope, dt);
+}
 
-	// Set previous error to this error
-	previousError = e;
+/**
+ * Calculate control variable with a measured slope as derivative input
+ *
+ * @param x: process variable: measured output to be compared with w
+ * @param slope: rate of change of x in °C/s
+ * @returns control variable: Can be between 0-100 so percentage
+ */
+template<typename T>
+uint8_t PIDController<T>::control(T x, T slope) {
+	return (int)this->controlPrecise(x, slope);
+}
 
-	// Calculate proportional & add all parts together with their respective gain
-	output = Kp*e + Ki*integral + Kd*derivative;
-	if(output>100) {
-		output=100;
-	} else if(output<0) {
-		output=0;
+/**
+ * Calculate control variable with fraction, e.g. for a setpoint of an inner loop
+ *
+ * @param x: process variable: measured output to be compared with w
+ * @param slope: rate of change of x in °C/s
+ * @returns control variable within the limits
+ */
+template<typename T>
+T PIDController<T>::controlPrecise(T x, T slope) {
+	if(period != 0) return this->step(x, slope, KiDt);
+	return this->compute(x, slope, this->calculate_dt());
+}
+
+/**
+ * Runs one controller step with a given time step
+ *
+ * @note derivative on measurement, setpoint steps do not kick the output.
+ * Anti-windup by back-calculation: the integral is trimmed so the output
+ * including the feed-forward never exceeds the limits.
+ *
+ * @param x: process variable in °C
+ * @param slope: rate of change of x in °C/s
+ * @param dt: time step in ms
+ * @returns control variable within the limits
+ */
+template<typename T>
+T PIDController<T>::compute(T x, T slope, uint32_t dt) {
+	// First step after a pause would wind up the integral and overflow fixed point
+	if(dt > MAX_DT) dt = MAX_DT;
+
+	return this->step(x, slope, Ki * (T((int)dt) / T(1000)));
+}
+
+/**
+ * Runs one controller step with the integral gain already scaled by the time step
+ *
+ * @param x: process variable in °C
+ * @param slope: rate of change of x in °C/s
+ * @param kiDt: Ki times the time step in s
+ * @returns control variable within the limits
+ */
+template<typename T>
+T PIDController<T>::step(T x, T slope, T kiDt) {
+	T e = this->w - x;
+	T output;
+
+	// Integrate in output units, so changing Ki later does not bump the output
+	this->integral += kiDt * e;
+
+	// For a constant setpoint the error changes opposite to the measurement
+	output = feedForward + Kp*e + this->integral - Kd*slope;
+
+	if(output > outputMax) {
+		this->integral -= output - outputMax;
+		output = outputMax;
+	} else if(output < outputMin) {
+		this->integral -= output - outputMin;
+		output = outputMin;
 	}
+
+	// Integral alone may not hold the output beyond its limits either,
+	// with feed-forward it only corrects the model error
+	if(this->integral > outputMax - feedForward) this->integral = outputMax - feedForward;
+	if(this->integral < outputMin - feedForward) this->integral = outputMin - feedForward;
+
+	previousX = x;
+	previousError = e;
+	previousSlope = slope;
+	hasPrevious = 1;
 	return output;
 }
+
+template class PIDController<float>;
+template class PIDController<Q16_16>;
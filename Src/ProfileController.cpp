@@ -11,20 +11,35 @@
  ******************************************************************************/
 
 #include "ProfileController.h"
+#include "Timebase.h"
 
-const DATAPOINT_t basicPoints[2] =  {DATAPOINT_t{60, 80},  DATAPOINT_t{30, 190}};
+// Heating from cold the error is large for a while, less integral avoids the overshoot at the first soak
+const GAINSET_t preheatGains = {Q16_16(1), Q16_16::fromRatio(2, 5), Q16_16(1)};
+
+const DATAPOINT_t basicPoints[4] = {
+		DATAPOINT_t{SEGMENT_RAMP, 80, 100, 0, &preheatGains},
+		DATAPOINT_t{SEGMENT_SOAK, 80, 0, 60, NULL},
+		DATAPOINT_t{SEGMENT_RAMP, 190, 75, 0, NULL},
+		DATAPOINT_t{SEGMENT_SOAK, 190, 0, 30, NULL}
+};
 CURVE_t basic = {
 		0,
 		"Basic",
-		2,
+		4,
 		basicPoints
 };
 
-const DATAPOINT_t advancedPoints[3] =  {DATAPOINT_t{210, 140},  DATAPOINT_t{60, 160}, DATAPOINT_t{90, 200}};
+const DATAPOINT_t advancedPoints[5] = {
+		DATAPOINT_t{SEGMENT_RAMP, 140, 100, 0, &preheatGains},
+		DATAPOINT_t{SEGMENT_SOAK, 140, 0, 210, NULL},
+		DATAPOINT_t{SEGMENT_RAMP, 160, 50, 0, NULL},
+		DATAPOINT_t{SEGMENT_SOAK, 160, 0, 60, NULL},
+		DATAPOINT_t{SEGMENT_PEAK, 200, 75, 90, NULL}
+};
 CURVE_t advanced = {
 		1,
 		"Advanced",
-		3,
+		5,
 		advancedPoints
 };
 
@@ -33,16 +48,105 @@ CURVE_t curves[curveslen] = {basic, advanced };
 /**
  * Initializes the Profile Controller when using Temprature Curves as operting mode
  *
+ * @note no profile is loaded, the controller is finished until load()
+ *
  * @param *pid: @ref PIDController controller for setting temprature
- * @param *profile: The profile that should be followed
  */
-ProfileController::ProfileController(PIDController *pid, CURVE_t *profile) {
+ProfileController::ProfileController(FixedPID_t *pid) {
 	this->pid = pid;
+	this->profile = NULL;
+	this->starttime = 0;
+	this->pieceCount = 0;
+	this->index = 0;
+	this->duration = 0;
+	this->setpoint = Q16_16(0);
+	this->finished = 1;
+}
+
+/**
+ * Loads a profile and starts following it
+ *
+ * @note the trajectory is calculated here once, the first ramp starts at the current temprature.
+ * Replaces the previous profile, so one controller serves every run.
+ *
+ * @param *profile: The profile that should be followed
+ * @param start: Temprature of the oven when the profile starts
+ */
+void ProfileController::load(CURVE_t *profile, Q16_16 start) {
+	const DATAPOINT_t *point;
+	Q16_16 w = start;
+	uint8_t i;
+
 	this->profile = profile;
-	this->starttime = HAL_GetTick();
-	this->indexstarttime =0;
-	this->index=0;
+	this->pieceCount = 0;
+	this->index = 0;
+	this->duration = 0;
 	this->finished = 0;
+
+	for(i = 0; i < profile->pointslen && i < PROFILE_MAX_POINTS; i++) {
+		point = &profile->points[i];
+		switch(point->type) {
+		case SEGMENT_RAMP:
+			w = addRamp(w, Q16_16((int)point->temprature), point->rate, point->gains);
+			break;
+		case SEGMENT_SOAK:
+			w = addPiece(Q16_16((int)point->temprature), Q16_16((int)point->temprature), (uint32_t)point->time*1000, point->gains);
+			break;
+		case SEGMENT_PEAK: {
+			Q16_16 base = w;
+			w = addRamp(w, Q16_16((int)point->temprature), point->rate, point->gains);
+			w = addPiece(w, w, (uint32_t)point->time*1000, point->gains);
+			w = addRamp(w, base, point->rate, point->gains);
+			break;
+		}
+		}
+	}
+
+	this->setpoint = pieceCount ? Q16_16::fromRaw(pieces[0].base) : start;
+	this->starttime = Timebase_GetMicros();
+}
+
+/**
+ * Appends a linear piece to the trajectory
+ *
+ * @param from: Setpoint at the start of the piece
+ * @param to: Setpoint at the end of the piece
+ * @param time: Length of the piece in ms, empty pieces are skipped
+ * @param *gains: Gains of the segment, NULL for the default gains
+ * @returns setpoint at the end of the piece
+ */
+Q16_16 ProfileController::addPiece(Q16_16 from, Q16_16 to, uint32_t time, const GAINSET_t *gains) {
+	PROFILE_PIECE_t *piece;
+
+	if(time == 0 || pieceCount >= PROFILE_MAX_PIECES) return to;
+
+	piece = &pieces[pieceCount++];
+	piece->start = duration;
+	piece->end = duration + time;
+	piece->base = from.raw();
+	piece->slope = (int32_t)(((int64_t)(to - from).raw() << PROFILE_SLOPE_SHIFT) / (int32_t)time);
+	piece->gains = gains;
+	duration = piece->end;
+	return to;
+}
+
+/**
+ * Appends a ramp with a given rate to the trajectory
+ *
+ * @param from: Setpoint at the start of the ramp
+ * @param to: Setpoint at the end of the ramp
+ * @param rate: Rate in 0.01 °C/s, 0 jumps to the setpoint
+ * @param *gains: Gains of the segment, NULL for the default gains
+ * @returns setpoint at the end of the ramp
+ */
+Q16_16 ProfileController::addRamp(Q16_16 from, Q16_16 to, uint16_t rate, const GAINSET_t *gains) {
+	int64_t delta = (to - from).raw();
+
+	if(rate == 0) return to;
+	if(delta < 0) delta = -delta;
+
+	// |delta| / (rate/100 °C/s) in ms
+	return addPiece(from, to, (uint32_t)((delta * 100000) / ((int64_t)rate << 16)), gains);
 }
 
 /**
@@ -51,30 +155,127 @@ ProfileController::ProfileController(PIDController *pid, CURVE_t *profile) {
  * @returns time since start of profile (init)
  */
 uint32_t ProfileController::getTimePassed() {
-	return HAL_GetTick()-this->starttime;
+	return (Timebase_GetMicros() - this->starttime) / 1000;
 }
 
 /**
- * Function that sets temprature at certain time
+ * Returns the time until the profile is finished
  *
- * @note needs to be called in main loop to operate
- * @param x: current temprature
+ * @returns remaining time in ms
+ */
+uint32_t ProfileController::getTimeRemaining() {
+	uint32_t passed = getTimePassed();
+
+	if(finished || passed >= duration) return 0;
+	return duration - passed;
+}
+
+/**
+ * Returns the total time of the profile
+ *
+ * @returns duration in ms
+ */
+uint32_t ProfileController::getDuration() {
+	return this->duration;
+}
+
+/**
+ * Returns the setpoint of the last control call
+ *
+ * @returns setpoint in °C
+ */
+Q16_16 ProfileController::getSetpoint() {
+	return this->setpoint;
+}
+
+/**
+ * Finds the piece of the trajectory at a time
+ *
+ * @param t: Time since start of the profile in ms, not before the current piece
+ * @returns piece, NULL after the end of the profile
+ */
+const PROFILE_PIECE_t* ProfileController::findPiece(uint32_t t) {
+	uint8_t i = index;
+
+	while(i < pieceCount && t >= pieces[i].end)
+		i++;
+	return i < pieceCount ? &pieces[i] : NULL;
+}
+
+/**
+ * Returns the planned setpoint
+ *
+ * @param t: Time since start of the profile in ms, not before the last control call
+ * @returns setpoint in °C, 0 after the end of the profile
+ */
+Q16_16 ProfileController::getSetpointAt(uint32_t t) {
+	const PROFILE_PIECE_t *piece = findPiece(t);
+
+	if(piece == NULL) return Q16_16(0);
+	return Q16_16::fromRaw(piece->base + (int32_t)(((int64_t)piece->slope * (int32_t)(t - piece->start)) >> PROFILE_SLOPE_SHIFT));
+}
+
+/**
+ * Returns the planned rate of the setpoint
+ *
+ * @param t: Time since start of the profile in ms, not before the last control call
+ * @returns rate in °C/s
+ */
+Q16_16 ProfileController::getSlopeAt(uint32_t t) {
+	const PROFILE_PIECE_t *piece = findPiece(t);
+
+	if(piece == NULL) return Q16_16(0);
+	return Q16_16::fromRaw((int32_t)(((int64_t)piece->slope * 1000) >> PROFILE_SLOPE_SHIFT));
+}
+
+/**
+ * Returns the gains of the current segment
+ *
+ * @returns gain set, NULL for the default gains
+ */
+const GAINSET_t* ProfileController::getGains() {
+	if(finished || index >= pieceCount) return NULL;
+	return pieces[index].gains;
+}
+
+/**
+ * Returns the profile followed
+ *
+ * @returns profile
+ */
+CURVE_t* ProfileController::getProfile() {
+	return this->profile;
+}
+
+/**
+ * Returns the piece of the trajectory the profile is in
+ *
+ * @returns index of the piece, the number of pieces once finished
+ */
+uint8_t ProfileController::getPiece() {
+	return this->index;
+}
+
+/**
+ * Sets the setpoint for the current time of the profile
+ *
+ * @note needs to be called in the control loop to operate
  * @returns 0 or 1 - 1 for finished 0 for ongoing
  */
-uint8_t ProfileController::control(uint16_t x) {
-	pid->set((profile->points)[0][index].temprature);
+uint8_t ProfileController::control() {
+	uint32_t t = getTimePassed();
 
-	if(pid->reachedTemprature(x) && this->indexstarttime==0) {
-		indexstarttime=HAL_GetTick();
-	}
-	if(HAL_GetTick() > indexstarttime + (profile->points)[0][index].time*1000 && indexstarttime!=0) {
-		indexstarttime=0;
+	// Time only moves forward, the current piece is found by stepping on
+	while(index < pieceCount && t >= pieces[index].end)
 		index++;
-	}
-	if(index >= profile->pointslen) {
+
+	if(index >= pieceCount) {
 		this->finished = 1;
 		pid->set(0);
 		return 1;
 	}
+
+	setpoint = getSetpointAt(t);
+	pid->setPrecise(setpoint);
 	return 0;
 }
@@ -0,0 +1,213 @@
+/*******************************************************************************
+ * Copyright (C) 2019 Julian Hellner - All Rights Reserved
+ *
+ * The file Scheduler.cpp is part of Reflow.
+ *
+ * Unauthorized copying of this file, via any medium is strictly prohibited
+ * Proprietary and confidential
+ *
+ * Written by Julian Hellner <hellnerjulian@gmail.com>, Jul 13, 2019
+ *
+ ******************************************************************************/
+
+#include "Scheduler.h"
+
+/**
+ * Initializes an empty scheduler
+ */
+Scheduler::Scheduler() {
+	this->taskCount = 0;
+	this->droppedEvents = 0;
+	this->eventHandler = NULL;
+
+	// Task runtimes are measured with the cycle counter
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+/**
+ * Adds a periodic task
+ *
+ * @param *name: Name of the task for reports
+ * @param *run: Function run every period, must return without blocking
+ * @param period: Period in ms
+ * @returns task id, -1 when all slots are used
+ */
+int8_t Scheduler::addTask(const char *name, void (*run)(void), uint32_t period) {
+	TASK_t *task;
+
+	if(taskCount >= SCHEDULER_MAX_TASKS || run == NULL)
+		return -1;
+
+	task = &tasks[taskCount];
+	task->name = name;
+	task->run = run;
+	task->period = period;
+	// On the ms, the loop is woken by the SysTick
+	task->nextRun = (uint64_t)HAL_GetTick()*1000;
+	task->runs = 0;
+	task->worstCycles = 0;
+	task->worstJitter = 0;
+	return taskCount++;
+}
+
+/**
+ * Sets the function events are passed to
+ *
+ * @param *handler: Called from the scheduler loop for every event
+ */
+void Scheduler::setEventHandler(void (*handler)(uint16_t event)) {
+	this->eventHandler = handler;
+}
+
+/**
+ * Queues an event, safe to call from interrupts
+ *
+ * @note interrupts of different priority post, the queue takes a single
+ * producer, so they are serialized by disabling interrupts
+ *
+ * @param event: Event to queue, e.g. an INPUT_EVENT
+ * @returns 1 when queued, 0 when the queue is full
+ */
+uint8_t Scheduler::postEvent(uint16_t event) {
+	uint32_t primask = __get_PRIMASK();
+	uint8_t queued;
+
+	__disable_irq();
+	queued = events.push(event);
+	if(!queued) droppedEvents++;
+	__set_PRIMASK(primask);
+	return queued;
+}
+
+/**
+ * Makes a task due now, it runs on the next pass of the loop
+ *
+ * @note call from the scheduler loop only, not from interrupts. The
+ * task keeps its period from then on.
+ *
+ * @param id: Task id
+ */
+void Scheduler::trigger(int8_t id) {
+	if(id < 0 || id >= taskCount) return;
+	tasks[id].nextRun = Timebase_GetMicros();
+}
+
+/**
+ * Runs due tasks and queued events, sleeps with WFI when idle
+ *
+ * @note never returns
+ */
+void Scheduler::run() {
+	TASK_t *task;
+	uint64_t now;
+	uint32_t start, jitter, cycles;
+	uint16_t event;
+	uint8_t i, busy;
+
+	while(1) {
+		busy = 0;
+
+		// Events first, buttons should not wait for a task period
+		while(events.pop(&event)) {
+			if(eventHandler != NULL) {
+				Trace_TaskBegin(TRACE_TASK_EVENTS);
+				eventHandler(event);
+				Trace_TaskEnd(TRACE_TASK_EVENTS);
+			}
+			busy = 1;
+		}
+
+		for(i = 0; i < taskCount; i++) {
+			task = &tasks[i];
+			now = Timebase_GetMicros();
+			if(now < task->nextRun)
+				continue;
+
+			jitter = now - task->nextRun;
+			Trace_TaskBegin(i);
+			start = DWT->CYCCNT;
+			task->run();
+			cycles = DWT->CYCCNT - start;
+			Trace_TaskEnd(i);
+
+			task->runs++;
+			if(cycles > task->worstCycles) task->worstCycles = cycles;
+			if(jitter > task->worstJitter) task->worstJitter = jitter;
+
+			// Keep the grid, skip periods that were missed completely
+			task->nextRun += task->period*1000;
+			now = Timebase_GetMicros();
+			if(now >= task->nextRun)
+				task->nextRun = now + task->period*1000;
+			busy = 1;
+		}
+
+		// Sleep until the next interrupt, at least SysTick wakes up every ms
+		if(!busy)
+			__WFI();
+	}
+}
+
+/**
+ * Returns the number of registered tasks
+ *
+ * @returns tasks
+ */
+uint8_t Scheduler::getTaskCount() {
+	return this->taskCount;
+}
+
+/**
+ * Returns a task with its statistics
+ *
+ * @param id: Task id
+ * @returns task, NULL for an invalid id
+ */
+const TASK_t* Scheduler::getTask(uint8_t id) {
+	if(id >= taskCount) return NULL;
+	return &tasks[id];
+}
+
+/**
+ * Returns the longest runtime of a task
+ *
+ * @param id: Task id
+ * @returns runtime in µs
+ */
+uint32_t Scheduler::getWorstRuntime(uint8_t id) {
+	if(id >= taskCount) return 0;
+	return tasks[id].worstCycles / (SystemCoreClock / 1000000);
+}
+
+/**
+ * Returns the largest start delay of a task
+ *
+ * @param id: Task id
+ * @returns jitter in µs
+ */
+uint32_t Scheduler::getWorstJitter(uint8_t id) {
+	if(id >= taskCount) return 0;
+	return tasks[id].worstJitter;
+}
+
+/**
+ * Returns the number of events lost because the queue was full
+ *
+ * @returns dropped events
+ */
+uint32_t Scheduler::getDroppedEvents() {
+	return this->droppedEvents;
+}
+
+/**
+ * Clears the runtime and jitter statistics of all tasks
+ */
+void Scheduler::resetStats() {
+	uint8_t i;
+
+	for(i = 0; i < taskCount; i++) {
+		tasks[i].worstCycles = 0;
+		tasks[i].worstJitter = 0;
+	}
+}
@@ -0,0 +1,216 @@
+/*******************************************************************************
+ * Copyright (C) 2019 Julian Hellner - All Rights Reserved
+ *
+ * The file SampleHistory.cpp is part of Reflow.
+ *
+ * Unauthorized copying of this file, via any medium is strictly prohibited
+ * Proprietary and confidential
+ *
+ * Written by Julian Hellner <hellnerjulian@gmail.com>, Jun 11, 2019
+ *
+ ******************************************************************************/
+
+#include "Sensors/SampleHistory.h"
+
+/**
+ * Initializes an empty history
+ *
+ * @note defaults to median of 3, IIR shift of 2 and a window of 8 samples
+ */
+SampleHistory::SampleHistory() {
+	this->medianSize = 3;
+	this->iirShift = 2;
+	this->window = 8;
+	reset();
+}
+
+/**
+ * Configures the filter pipeline
+ *
+ * @param median: Number of samples for the median filter (1 disables it)
+ * @param iirShift: IIR weight of a new sample is 1/2^iirShift (0 disables it)
+ * @param window: Number of samples used for slope and variance
+ */
+void SampleHistory::configure(uint8_t median, uint8_t iirShift, uint8_t window) {
+	if(median < 1) median = 1;
+	if(median > SAMPLEHISTORY_MEDIAN_MAX) median = SAMPLEHISTORY_MEDIAN_MAX;
+	if(iirShift > SAMPLEHISTORY_IIR_MAX) iirShift = SAMPLEHISTORY_IIR_MAX;
+	if(window < 2) window = 2;
+	if(window > SAMPLEHISTORY_SIZE) window = SAMPLEHISTORY_SIZE;
+
+	this->medianSize = median;
+	this->iirShift = iirShift;
+	this->window = window;
+	reset();
+}
+
+/**
+ * Drops all samples and filter state
+ */
+void SampleHistory::reset() {
+	this->head = 0;
+	this->count = 0;
+	this->medianIndex = 0;
+	this->medianCount = 0;
+	this->iirAccumulator = 0;
+}
+
+/**
+ * Runs the median filter over the last samples
+ *
+ * @param raw: New sample
+ * @returns median of the last medianSize samples
+ */
+int16_t SampleHistory::median(int16_t raw) {
+	int16_t sorted[SAMPLEHISTORY_MEDIAN_MAX];
+	int16_t v;
+	uint8_t i, j;
+
+	medianWindow[medianIndex] = raw;
+	medianIndex = (medianIndex + 1) % medianSize;
+	if(medianCount < medianSize) medianCount++;
+
+	// Insertion sort, the window holds at most 7 samples
+	for(i = 0; i < medianCount; i++) {
+		v = medianWindow[i];
+		for(j = i; j > 0 && sorted[j-1] > v; j--)
+			sorted[j] = sorted[j-1];
+		sorted[j] = v;
+	}
+	return sorted[medianCount/2];
+}
+
+/**
+ * Filters a sample and adds it to the history
+ *
+ * @param tick: Time of the sample in ms
+ * @param raw: Measured value in 0.25 °C
+ */
+void SampleHistory::push(uint32_t tick, int16_t raw) {
+	// Input in 1/256 °C
+	int32_t x = (int32_t)median(raw) << (SAMPLEHISTORY_FRAC - 2);
+
+	// Accumulator holds the output scaled by 2^iirShift, so no fraction is lost
+	if(count == 0)
+		iirAccumulator = x << iirShift;
+	else
+		iirAccumulator += x - (iirAccumulator >> iirShift);
+
+	entries[head].tick = tick;
+	entries[head].raw = raw;
+	entries[head].value = iirAccumulator >> iirShift;
+	head = (head + 1) & SAMPLEHISTORY_MASK;
+	if(count < SAMPLEHISTORY_SIZE) count++;
+}
+
+/**
+ * Returns the number of samples in the history
+ *
+ * @returns samples stored
+ */
+uint8_t SampleHistory::getCount() {
+	return this->count;
+}
+
+/**
+ * Returns the time of the latest sample
+ *
+ * @returns tick in ms
+ */
+uint32_t SampleHistory::getTick() {
+	if(count == 0) return 0;
+	return entries[(head - 1) & SAMPLEHISTORY_MASK].tick;
+}
+
+/**
+ * Returns the latest filtered value
+ *
+ * @returns temperature in °C, -1 when empty
+ */
+float SampleHistory::getValue() {
+	if(count == 0) return -1;
+	return entries[(head - 1) & SAMPLEHISTORY_MASK].value / (float)(1 << SAMPLEHISTORY_FRAC);
+}
+
+/**
+ * Returns the latest filtered value in fixed point
+ *
+ * @returns temperature in °C, -1 when empty
+ */
+Q16_16 SampleHistory::getValueQ() {
+	if(count == 0) return Q16_16(-1);
+	return Q16_16::fromRaw(entries[(head - 1) & SAMPLEHISTORY_MASK].value << (16 - SAMPLEHISTORY_FRAC));
+}
+
+/**
+ * Returns the number of samples slope and variance are calculated over
+ */
+uint8_t SampleHistory::windowSize() {
+	return count < window ? count : window;
+}
+
+/**
+ * Returns the slope of the filtered values over the window (least squares)
+ *
+ * @returns slope in °C/s, 0 with less than two samples
+ */
+float SampleHistory::getSlope() {
+	return (float)getSlopeQ();
+}
+
+/**
+ * Returns the slope of the filtered values over the window in fixed point
+ *
+ * @returns slope in °C/s, 0 with less than two samples
+ */
+Q16_16 SampleHistory::getSlopeQ() {
+	uint8_t n = windowSize();
+	uint8_t i, index;
+	uint32_t newest;
+	int64_t t, v;
+	int64_t st = 0, sv = 0, stt = 0, stv = 0;
+	int64_t denominator;
+
+	if(n < 2) return Q16_16(0);
+
+	newest = entries[(head - 1) & SAMPLEHISTORY_MASK].tick;
+	for(i = 1; i <= n; i++) {
+		index = (head - i) & SAMPLEHISTORY_MASK;
+		// Time relative to the newest sample keeps the sums small and survives tick overflow
+		t = -(int32_t)(newest - entries[index].tick);
+		v = entries[index].value;
+		st += t;
+		sv += v;
+		stt += t*t;
+		stv += t*v;
+	}
+
+	denominator = n*stt - st*st;
+	if(denominator == 0) return Q16_16(0);
+
+	// 1/256 °C per ms to 1/65536 °C per s
+	return Q16_16::fromRaw((int32_t)((n*stv - st*sv) * 1000 * (1 << (16 - SAMPLEHISTORY_FRAC)) / denominator));
+}
+
+/**
+ * Returns the variance of the unfiltered input over the window
+ *
+ * @returns variance in °C²
+ */
+float SampleHistory::getVariance() {
+	uint8_t n = windowSize();
+	uint8_t i;
+	int32_t x;
+	int64_t sx = 0, sxx = 0;
+
+	if(n < 2) return 0;
+
+	for(i = 1; i <= n; i++) {
+		x = entries[(head - i) & SAMPLEHISTORY_MASK].raw;
+		sx += x;
+		sxx += x*x;
+	}
+
+	// Raw values are in 0.25 °C
+	return (float)(n*sxx - sx*sx) / (n*n) / 16.0f;
+}
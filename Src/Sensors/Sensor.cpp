@@ -36,6 +36,19 @@ MAX6675::MAX6675(SPI_HandleTypeDef *hspi, GPIO_TypeDef *CS1_PORT, uint16_t CS1_P
 	this->currentSensor = 0;
 	this->temprature1 = -1;
 	this->temprature2 = -1;
+	this->dropped = 0;
+	this->overruns = 0;
+}
+
+/**
+ * Starts the free running acquisition
+ *
+ * @note TIM4 paces one read of both sensors every conversion period (220 ms)
+ */
+void MAX6675::start() {
+	releaseCS();
+	LL_TIM_SetCounter(TIM4, 0);
+	LL_TIM_EnableCounter(TIM4);
 }
 
 /**
@@ -56,100 +69,179 @@ float MAX6675::getTemprature2() {
 	return this->temprature2;
 }
 
-void HAL_SPI_RxCpltCallback(SPI_HandleTypeDef *hspi) {
-	sensor->__handleSPI_RxCallback(hspi);
-	HAL_SPI_IRQHandler(hspi);
+/**
+ * Returns the filtered sample history of Sensor 1
+ *
+ * @returns history 1
+ */
+SampleHistory* MAX6675::getHistory1() {
+	return &this->history1;
 }
 
 /**
- * Handles the callback when reading the first sensor finished
+ * Returns the filtered sample history of Sensor 2
  *
- * @param *hspi: SPI
+ * @returns history 2
  */
-void MAX6675::__handleSPI_RxCallback(SPI_HandleTypeDef *hspi) {
-	if(currentSensor<1 || currentSensor > 2) {
-		Error_Handler();
-		return;
-	}
+SampleHistory* MAX6675::getHistory2() {
+	return &this->history2;
+}
 
-	if(currentSensor==1) {
-		HAL_GPIO_WritePin(CS1_PORT, CS1Pin, GPIO_PIN_SET);
-		// Check if third last bit is not zero
-		if((((*rxBuffer) >> 2) & 0b0000000000000001) == 1) {
+/**
+ * Returns the number of conversions that were skipped or failed
+ *
+ * @returns dropped conversions
+ */
+uint32_t MAX6675::getDropped() {
+	return this->dropped;
+}
+
+/**
+ * Returns the number of samples lost because the ring buffer was full
+ *
+ * @returns overrun samples
+ */
+uint32_t MAX6675::getOverruns() {
+	return this->overruns;
+}
+
+/**
+ * Takes the oldest acquired sample out of the ring buffer
+ *
+ * @note only the control step may consume, the other ISRs only produce
+ *
+ * @param *sample: Destination of the sample
+ * @returns 1 when a sample was read, 0 when the buffer is empty
+ */
+uint8_t MAX6675::getSample(MAX6675_SAMPLE_t *sample) {
+	return ring.pop(sample);
+}
+
+/**
+ * Consumes all acquired samples and updates the temperatures
+ *
+ * @note never blocks, the temperatures keep their value when no new sample arrived.
+ * Valid samples are added to the sample histories.
+ */
+void MAX6675::readTemprature() {
+	MAX6675_SAMPLE_t sample;
+
+	while(getSample(&sample)) {
+		/* First bit always 0 last 2 too
+		 * Third last bit is 1 when no sensor is connected
+		 * Shift 3 right and mask first 4 bits to read value
+		 */
+		if(((sample.raw[0] >> 2) & 0b0000000000000001) == 1) {
 			temprature1 = -1;
 		} else {
-
-			/*Read data out of first sensor
-			* First bit always 0 last 2 too
-			* Third last bit is 1 when no sensor is connected
-			* Shift 3 right and mask first 4 bits to read value
-			*/
-			temprature1 = ((((*rxBuffer) >> 3) & 0b0000111111111111));
-			*rxBuffer = 0x0;
+			temprature1 = ((sample.raw[0] >> 3) & 0b0000111111111111);
+			history1.push(sample.tick, (sample.raw[0] >> 3) & 0b0000111111111111);
 		}
-	} else if(currentSensor==2) {
-		currentSensor = 0;
-		// Check if third last bit is not zero
-		if((((*rxBuffer) >> 2) & 0b0000000000000001) == 1) {
-			temprature1 = -1;
-			return;
+
+		if(((sample.raw[1] >> 2) & 0b0000000000000001) == 1) {
+			temprature2 = -1;
+		} else {
+			temprature2 = ((sample.raw[1] >> 3) & 0b0000111111111111) / 4.0;
+			history2.push(sample.tick, (sample.raw[1] >> 3) & 0b0000111111111111);
 		}
-		temprature2 = (((*rxBuffer) >> 3) & 0b0000111111111111) /4.0;
-		*rxBuffer = 0x0;
+	}
+}
+
+void TimerUpdate_Callback(void) {
+	sensor->__handleTIM_UpdateCallback();
+}
+
+void HAL_SPI_RxCpltCallback(SPI_HandleTypeDef *hspi) {
+	sensor->__handleSPI_RxCallback(hspi);
+}
+
+void HAL_SPI_ErrorCallback(SPI_HandleTypeDef *hspi) {
+	sensor->__handleSPI_ErrorCallback(hspi);
+}
+
+/**
+ * Handles the conversion timer, starts reading the first sensor
+ */
+void MAX6675::__handleTIM_UpdateCallback() {
+	// Last read has not finished yet, skip this conversion
+	if(currentSensor != 0) {
+		dropped++;
 		return;
 	}
-//
-//	HAL_Delay(1);
-//	currentSensor = 2; // Set sensor to read to second
-//	// SET CS low to start data transmission from MAX6675 Sensor
-//	HAL_GPIO_WritePin(this->CS2_PORT, this->CS2Pin, GPIO_PIN_RESET);
-//
-//	if(HAL_SPI_Receive_IT(hspi, (uint8_t*)this->rxBuffer, 2) != HAL_OK) {
-//		Error_Handler();
-//		return;
-//	}
-//
-//	// Not working due to interrupt stopping SysTick from incrementing
-//	// TODO Increase SysTick Priority
-//	HAL_Delay(1);
-//	HAL_GPIO_WritePin(this->CS2_PORT, this->CS2Pin, GPIO_PIN_SET);
-	return;
+
+	startRead(1);
 }
 
 /**
- * Initializes the MAX6675 sensor
+ * Handles the callback when reading a sensor finished
  *
- * @param *hspi: SPI used for the Sensor
- * @param *CS1_PORT: Chip Select 1 Port
- * @param *CS1_PORT: Chip Select 1 Pin
- * @param *CS1_PORT: Chip Select 2 Port
- * @param *CS1_PORT: Chip Select 2 Pin
+ * @note the first sensor directly chains the read of the second one
+ *
+ * @param *hspi: SPI
  */
-void MAX6675::readTemprature() {
-	// Check if sensor reading is in progress
-	if(currentSensor==0) {
-		currentSensor = 1; // Set sensor to read to first one
-		// SET CS low to start data transmission from MAX6675 Sensor
-		HAL_GPIO_WritePin(this->CS1_PORT, this->CS1Pin, GPIO_PIN_RESET);
-
-		if(HAL_SPI_Receive_IT(hspi, (uint8_t*)this->rxBuffer, 2) != HAL_OK) {
-			Error_Handler();
-		}
+void MAX6675::__handleSPI_RxCallback(SPI_HandleTypeDef *hspi) {
+	MAX6675_SAMPLE_t sample;
+
+	if(hspi != this->hspi) return;
 
-		HAL_Delay(1);
+	if(currentSensor == 1) {
 		HAL_GPIO_WritePin(CS1_PORT, CS1Pin, GPIO_PIN_SET);
+		startRead(2);
 		return;
-	} else if(currentSensor==1) {
-			currentSensor = 2; // Set sensor to read to first one
-			// SET CS low to start data transmission from MAX6675 Sensor
-			HAL_GPIO_WritePin(this->CS2_PORT, this->CS2Pin, GPIO_PIN_RESET);
-
-			if(HAL_SPI_Receive_IT(hspi, (uint8_t*)this->rxBuffer, 2) != HAL_OK) {
-				Error_Handler();
-			}
-
-			HAL_Delay(1);
-			HAL_GPIO_WritePin(CS2_PORT, CS2Pin, GPIO_PIN_SET);
-			return;
-		}
+	}
+	if(currentSensor != 2) return;
+
+	HAL_GPIO_WritePin(CS2_PORT, CS2Pin, GPIO_PIN_SET);
+	currentSensor = 0;
+
+	sample.tick = HAL_GetTick();
+	sample.raw[0] = rxBuffer[0];
+	sample.raw[1] = rxBuffer[1];
+	// Drop the new sample if the consumer fell behind
+	if(!ring.push(sample))
+		overruns++;
+}
+
+/**
+ * Handles a failed sensor transfer
+ *
+ * @param *hspi: SPI
+ */
+void MAX6675::__handleSPI_ErrorCallback(SPI_HandleTypeDef *hspi) {
+	if(hspi != this->hspi) return;
+
+	releaseCS();
+	currentSensor = 0;
+	dropped++;
+}
+
+/**
+ * Pulls the chip select of a sensor low and starts the DMA read
+ *
+ * @note pulling CS low stops the running conversion of that sensor,
+ * releasing it starts the next one
+ *
+ * @param sensor: Sensor to read (1 or 2)
+ */
+void MAX6675::startRead(uint8_t sensor) {
+	currentSensor = sensor;
+
+	if(sensor == 1)
+		HAL_GPIO_WritePin(CS1_PORT, CS1Pin, GPIO_PIN_RESET);
+	else
+		HAL_GPIO_WritePin(CS2_PORT, CS2Pin, GPIO_PIN_RESET);
+
+	if(HAL_SPI_Receive_DMA(hspi, (uint8_t*)&rxBuffer[sensor-1], 1) != HAL_OK) {
+		releaseCS();
+		currentSensor = 0;
+		dropped++;
+	}
+}
+
+/**
+ * Releases the chip select of both sensors
+ */
+void MAX6675::releaseCS() {
+	HAL_GPIO_WritePin(CS1_PORT, CS1Pin, GPIO_PIN_SET);
+	HAL_GPIO_WritePin(CS2_PORT, CS2Pin, GPIO_PIN_SET);
 }
@@ -0,0 +1,166 @@
+/*******************************************************************************
+ * Copyright (C) 2019 Julian Hellner - All Rights Reserved
+ *
+ * The file Settings.cpp is part of Reflow.
+ *
+ * Unauthorized copying of this file, via any medium is strictly prohibited
+ * Proprietary and confidential
+ *
+ * Written by Julian Hellner <hellnerjulian@gmail.com>, Jul 22, 2019
+ *
+ ******************************************************************************/
+
+#include "Settings.h"
+#include "string.h"
+#include "stddef.h"
+
+/**
+ * Initializes settings with the firmware defaults
+ *
+ * @param kp: Default proportional gain
+ * @param ki: Default integral gain
+ * @param kd: Default derivative gain
+ */
+Settings::Settings(Q16_16 kp, Q16_16 ki, Q16_16 kd) {
+	memset(&this->data, 0, sizeof(this->data));
+	this->data.magic = SETTINGS_MAGIC;
+	this->data.version = SETTINGS_VERSION;
+	this->data.tuningRule = TUNING_TYREUS_LUYBEN;
+	this->setGains(kp, ki, kd);
+	this->dirty = 0;
+}
+
+/**
+ * Bitwise CRC-32 (IEEE), small and only used on load and save
+ */
+uint32_t Settings::crc32(const uint8_t *buf, uint32_t len) {
+	uint32_t crc = 0xFFFFFFFF;
+	uint8_t i;
+
+	while(len--) {
+		crc ^= *buf++;
+		for(i = 0; i < 8; i++)
+			crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+	}
+	return ~crc;
+}
+
+/**
+ * Reads the settings from flash
+ *
+ * @returns 1 if valid settings were found, 0 keeps the defaults
+ */
+uint8_t Settings::load() {
+	const SETTINGS_t *stored = (const SETTINGS_t*)SETTINGS_ADDRESS;
+
+	// Erased page reads 0xFF
+	if(stored->magic != SETTINGS_MAGIC || stored->version != SETTINGS_VERSION) return 0;
+	if(stored->crc != crc32((const uint8_t*)stored, offsetof(SETTINGS_t, crc))) return 0;
+
+	memcpy(&this->data, stored, sizeof(this->data));
+	// Written by a firmware with more rules
+	if(this->data.tuningRule >= TUNING_RULE_COUNT)
+		this->data.tuningRule = TUNING_TYREUS_LUYBEN;
+	return 1;
+}
+
+/**
+ * Writes the settings to flash
+ *
+ * @note blocks for about 20 ms while the page is erased, the heater
+ * should be off. Main loop only, clears the pending save.
+ * @returns 1 on success
+ */
+uint8_t Settings::save() {
+	FLASH_EraseInitTypeDef erase;
+	uint32_t pageError;
+	const uint16_t *src = (const uint16_t*)&this->data;
+	uint32_t i;
+	uint8_t ok = 1;
+
+	// A failed save is not retried, that would wear out the page
+	this->dirty = 0;
+	this->data.crc = crc32((const uint8_t*)&this->data, offsetof(SETTINGS_t, crc));
+
+	erase.TypeErase = FLASH_TYPEERASE_PAGES;
+	erase.Banks = FLASH_BANK_1;
+	erase.PageAddress = SETTINGS_ADDRESS;
+	erase.NbPages = 1;
+
+	HAL_FLASH_Unlock();
+	if(HAL_FLASHEx_Erase(&erase, &pageError) != HAL_OK) ok = 0;
+	// The F1 programs flash a halfword at a time
+	for(i = 0; ok && i < sizeof(this->data) / 2; i++) {
+		if(HAL_FLASH_Program(FLASH_TYPEPROGRAM_HALFWORD, SETTINGS_ADDRESS + i*2, src[i]) != HAL_OK) ok = 0;
+	}
+	HAL_FLASH_Lock();
+
+	if(ok && memcmp((const void*)SETTINGS_ADDRESS, &this->data, sizeof(this->data)) != 0) ok = 0;
+	return ok;
+}
+
+/**
+ * Marks the settings to be saved by the main loop
+ *
+ * @note the flash must not be written from an interrupt, the erase
+ * stalls every handler for about 20 ms
+ */
+void Settings::markDirty() {
+	this->dirty = 1;
+}
+
+/**
+ * Returns whether the settings changed since the last save
+ *
+ * @returns 1 when a save is pending
+ */
+uint8_t Settings::isDirty() {
+	return this->dirty;
+}
+
+/**
+ * Sets the PID gains
+ *
+ * @param kp: Proportional gain
+ * @param ki: Integral gain
+ * @param kd: Derivative gain
+ */
+void Settings::setGains(Q16_16 kp, Q16_16 ki, Q16_16 kd) {
+	this->data.kp = kp.raw();
+	this->data.ki = ki.raw();
+	this->data.kd = kd.raw();
+}
+
+/**
+ * Gets the PID gains
+ *
+ * @param *kp: Proportional gain
+ * @param *ki: Integral gain
+ * @param *kd: Derivative gain
+ */
+void Settings::getGains(Q16_16 *kp, Q16_16 *ki, Q16_16 *kd) {
+	*kp = Q16_16::fromRaw(this->data.kp);
+	*ki = Q16_16::fromRaw(this->data.ki);
+	*kd = Q16_16::fromRaw(this->data.kd);
+}
+
+/**
+ * Sets the rule the autotuner calculates the gains with
+ *
+ * @note an unknown rule is ignored
+ *
+ * @param rule: @ref TUNING_RULE_t tuning rule
+ */
+void Settings::setTuningRule(TUNING_RULE_t rule) {
+	if(rule >= TUNING_RULE_COUNT) return;
+	this->data.tuningRule = rule;
+}
+
+/**
+ * Gets the rule the autotuner calculates the gains with
+ *
+ * @returns @ref TUNING_RULE_t tuning rule
+ */
+TUNING_RULE_t Settings::getTuningRule() {
+	return (TUNING_RULE_t)this->data.tuningRule;
+}
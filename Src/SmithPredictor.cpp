@@ -0,0 +1,139 @@
+/*******************************************************************************
+ * Copyright (C) 2019 Julian Hellner - All Rights Reserved
+ *
+ * The file SmithPredictor.cpp is part of Reflow.
+ *
+ * Unauthorized copying of this file, via any medium is strictly prohibited
+ * Proprietary and confidential
+ *
+ * Written by Julian Hellner <hellnerjulian@gmail.com>, Jul 23, 2019
+ *
+ ******************************************************************************/
+
+#include "SmithPredictor.h"
+#include "string.h"
+
+/*
+ * Default fit (Tools/ff_fit.py) of the reference oven of the simulation,
+ * refit with logs of the real oven
+ */
+#define DEFAULT_GAIN 2.5f // °C per %
+#define DEFAULT_TAU 120 // s
+#define DEFAULT_DEAD_TIME 9000 // ms
+
+/**
+ * Initializes the predictor with the default model
+ */
+SmithPredictor::SmithPredictor() {
+	setModel(Q16_16(DEFAULT_GAIN), Q16_16(DEFAULT_TAU), DEFAULT_DEAD_TIME);
+	this->lastTick = HAL_GetTick();
+	reset();
+}
+
+/**
+ * Sets the oven model
+ *
+ * @note fitted from logged runs with Tools/ff_fit.py
+ *
+ * @param gain: Rise in °C per % power in steady state
+ * @param tau: Time constant in s
+ * @param deadTime: Dead time in ms, at most SMITH_SLOTS*SMITH_SLOT_MS
+ */
+void SmithPredictor::setModel(Q16_16 gain, Q16_16 tau, uint32_t deadTime) {
+	this->gain = gain;
+	this->tau = tau;
+	this->delaySlots = (deadTime + SMITH_SLOT_MS/2) / SMITH_SLOT_MS;
+	if(this->delaySlots > SMITH_SLOTS) this->delaySlots = SMITH_SLOTS;
+}
+
+/**
+ * Returns the dead time of the model
+ *
+ * @returns dead time in ms
+ */
+uint32_t SmithPredictor::getDeadTime() {
+	return (uint32_t)this->delaySlots * SMITH_SLOT_MS;
+}
+
+/**
+ * Clears the delay line and the model states
+ */
+void SmithPredictor::reset() {
+	memset(this->line, 0, sizeof(this->line));
+	this->head = 0;
+	this->slotTime = 0;
+	this->model = Q16_16(0);
+	this->delayed = Q16_16(0);
+	this->power = 0;
+}
+
+/**
+ * Returns the power one dead time ago
+ *
+ * @returns power in %
+ */
+uint8_t SmithPredictor::getDelayedPower() {
+	if(delaySlots == 0) return power;
+	// head is the oldest slot, SMITH_SLOTS ago
+	return line[(head + SMITH_SLOTS - delaySlots) % SMITH_SLOTS];
+}
+
+/**
+ * Advances the model to now
+ *
+ * @note needs to be called in the control loop, also while the oven is off
+ * @param power: Heater power applied since the last call in %
+ */
+void SmithPredictor::update(uint8_t power) {
+	uint32_t now = HAL_GetTick();
+	uint32_t elapsed = now - lastTick;
+	uint16_t step;
+	Q16_16 dt;
+
+	lastTick = now;
+	this->power = power;
+
+	// After a long pause the whole line holds this power anyway
+	if(elapsed > SMITH_SLOTS * SMITH_SLOT_MS) elapsed = SMITH_SLOTS * SMITH_SLOT_MS;
+
+	// Integrate slot by slot, the delayed power changes only on slot borders
+	while(elapsed > 0) {
+		step = SMITH_SLOT_MS - slotTime;
+		if(step > elapsed) step = elapsed;
+		dt = Q16_16::fromRatio(step, 1000);
+
+		model += (gain * Q16_16((int)power) - model) * dt / tau;
+		delayed += (gain * Q16_16((int)getDelayedPower()) - delayed) * dt / tau;
+
+		slotTime += step;
+		elapsed -= step;
+		if(slotTime >= SMITH_SLOT_MS) {
+			line[head] = power;
+			head = (head + 1) % SMITH_SLOTS;
+			slotTime = 0;
+		}
+	}
+}
+
+/**
+ * Predicts the temprature one dead time ahead
+ *
+ * @param x: Measured temprature in °C
+ * @returns predicted temprature in °C
+ */
+Q16_16 SmithPredictor::predict(Q16_16 x) {
+	return x + model - delayed;
+}
+
+/**
+ * Predicts the heating rate one dead time ahead
+ *
+ * @param slope: Measured heating rate in °C/s
+ * @returns predicted heating rate in °C/s
+ */
+Q16_16 SmithPredictor::predictSlope(Q16_16 slope) {
+	Q16_16 modelSlope = (gain * Q16_16((int)power) - model) / tau;
+	Q16_16 delayedSlope = (gain * Q16_16((int)getDelayedPower()) - delayed) / tau;
+
+	return slope + modelSlope - delayedSlope;
+}
@@ -0,0 +1,94 @@
+/*******************************************************************************
+ * Copyright (C) 2019 Julian Hellner - All Rights Reserved
+ *
+ * The file Stack.cpp is part of Reflow.
+ *
+ * Unauthorized copying of this file, via any medium is strictly prohibited
+ * Proprietary and confidential
+ *
+ * Written by Julian Hellner <hellnerjulian@gmail.com>, Jul 31, 2019
+ *
+ ******************************************************************************/
+
+#include "Stack.h"
+
+static uint32_t *stackBottom;
+static uint32_t *stackTop;
+static uint32_t *mark; // Deepest painted word known to be used
+static volatile uint32_t isrDepth[TRACE_ISR_COUNT];
+
+/**
+ * Paints the free stack and sets the bounds of the watermark
+ *
+ * @note call early at boot, everything below the current
+ * stack pointer is overwritten
+ *
+ * @param *bottom: Lowest word the stack may reach, e.g. the end of the heap
+ * @param *top: Initial stack pointer, _estack
+ */
+void Stack_Init(uint32_t *bottom, uint32_t *top) {
+	uint32_t *sp = (uint32_t *)__get_MSP();
+	uint32_t *p;
+
+	stackBottom = bottom;
+	stackTop = top;
+	mark = sp;
+	// Words at and above the stack pointer belong to the frames of the callers
+	for(p = bottom; p < sp; p++)
+		*p = STACK_PAINT;
+}
+
+/**
+ * Returns the deepest the stack has been since boot
+ *
+ * @note scans the painted words from the bottom, takes a few thousand cycles
+ *
+ * @returns bytes
+ */
+uint32_t Stack_GetUsed(void) {
+	uint32_t *p = stackBottom;
+
+	// The mark only moves down, nothing above it needs to be looked at again
+	while(p < mark && *p == STACK_PAINT)
+		p++;
+	mark = p;
+	return (stackTop - mark) * sizeof(uint32_t);
+}
+
+/**
+ * Returns the size of the stack
+ *
+ * @returns bytes between bottom and top
+ */
+uint32_t Stack_GetSize(void) {
+	return (stackTop - stackBottom) * sizeof(uint32_t);
+}
+
+/**
+ * Records the stack depth an interrupt handler was entered at
+ *
+ * @note called on entry of every traced handler (Trace_IsrEnter), SysTick
+ * calls it directly
+ *
+ * @param id: @ref TRACE_ISR_t handler
+ */
+void Stack_SampleIsr(uint8_t id) {
+	uint32_t depth;
+
+	if(stackTop == NULL || id >= TRACE_ISR_COUNT)
+		return;
+	depth = (uint32_t)((uint8_t *)stackTop - (uint8_t *)__get_MSP());
+	// Only this handler writes its entry, it cannot preempt itself
+	if(depth > isrDepth[id])
+		isrDepth[id] = depth;
+}
+
+/**
+ * Returns the deepest stack an interrupt handler was entered at
+ *
+ * @param id: @ref TRACE_ISR_t handler
+ * @returns bytes, including the exception frame
+ */
+uint32_t Stack_GetIsrDepth(uint8_t id) {
+	return id < TRACE_ISR_COUNT ? isrDepth[id] : 0;
+}
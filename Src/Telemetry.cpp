@@ -0,0 +1,200 @@
+/*******************************************************************************
+ * Copyright (C) 2019 Julian Hellner - All Rights Reserved
+ *
+ * The file Telemetry.cpp is part of Reflow.
+ *
+ * Unauthorized copying of this file, via any medium is strictly prohibited
+ * Proprietary and confidential
+ *
+ * Written by Julian Hellner <hellnerjulian@gmail.com>, Jul 26, 2019
+ *
+ ******************************************************************************/
+
+#include "Telemetry.h"
+#include "string.h"
+
+extern Telemetry *telemetry;
+
+/**
+ * Returns the CRC-16/CCITT-FALSE of data
+ *
+ * @param *data: Bytes to check
+ * @param size: Number of bytes
+ * @returns crc
+ */
+static uint16_t crc16(const uint8_t *data, uint16_t size) {
+	uint16_t crc = 0xFFFF;
+	uint8_t i;
+
+	while(size--) {
+		crc ^= (uint16_t)*data++ << 8;
+		for(i = 0; i < 8; i++)
+			crc = crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1;
+	}
+	return crc;
+}
+
+/**
+ * COBS encodes data, the output has no 0x00 byte
+ *
+ * @param *data: Bytes to encode
+ * @param size: Number of bytes, 254 at most
+ * @param *out: Destination, size + 1 bytes
+ * @returns number of bytes written
+ */
+static uint16_t cobsEncode(const uint8_t *data, uint16_t size, uint8_t *out) {
+	uint16_t code = 0; // Position of the current code byte
+	uint16_t n = 1;
+	uint16_t i;
+
+	for(i = 0; i < size; i++) {
+		if(data[i] == 0) {
+			out[code] = n - code;
+			code = n++;
+		} else {
+			out[n++] = data[i];
+		}
+	}
+	out[code] = n - code;
+	return n;
+}
+
+/**
+ * Initializes the telemetry, a frame is sent on every sample
+ *
+ * @param *dma: DMA controller of the UART transmit channel
+ * @param channel: Channel, LL_DMA_CHANNEL_x
+ */
+Telemetry::Telemetry(DMA_TypeDef *dma, uint32_t channel) {
+	assert_param(dma);
+
+	this->dma = dma;
+	this->channel = channel;
+	this->length = 0;
+	this->divider = 1;
+	this->countdown = 0;
+	this->sequence = 0;
+	this->sent = 0;
+	this->dropped = 0;
+
+	LL_DMA_EnableIT_TC(dma, channel);
+}
+
+/**
+ * Sets the rate, only every n-th sample is sent
+ *
+ * @param divider: Samples per frame, 1 for every sample
+ */
+void Telemetry::setDivider(uint16_t divider) {
+	if(divider == 0) divider = 1;
+	this->divider = divider;
+	this->countdown = 0;
+}
+
+/**
+ * Counts a sample and tells if a frame is due
+ *
+ * @note fill the frame and send() it only when this returns 1
+ *
+ * @returns 1 when the sample should be sent
+ */
+uint8_t Telemetry::isDue() {
+	if(countdown > 0) {
+		countdown--;
+		return 0;
+	}
+	countdown = divider - 1;
+	return 1;
+}
+
+/**
+ * Encodes a frame into the transmit ring and starts the DMA if idle
+ *
+ * @note version and sequence are filled in, call from one context only
+ *
+ * @param *frame: Sample to send
+ * @returns 1 when queued, 0 when dropped because the ring is full
+ */
+uint8_t Telemetry::send(TELEMETRY_FRAME_t *frame) {
+	uint8_t raw[sizeof(TELEMETRY_FRAME_t) + 2];
+	uint8_t encoded[TELEMETRY_ENCODED_MAX];
+	uint16_t crc, size;
+	uint32_t primask;
+
+	frame->version = TELEMETRY_VERSION;
+	frame->sequence = sequence++;
+	memcpy(raw, frame, sizeof(TELEMETRY_FRAME_t));
+	crc = crc16(raw, sizeof(TELEMETRY_FRAME_t));
+	raw[sizeof(TELEMETRY_FRAME_t)] = crc & 0xFF;
+	raw[sizeof(TELEMETRY_FRAME_t) + 1] = crc >> 8;
+	size = cobsEncode(raw, sizeof(raw), encoded);
+	encoded[size++] = 0x00;
+
+	// Whole frames only, the receiver could not resync on a partial one
+	if(!buffer.pushBlock(encoded, size)) {
+		dropped++;
+		return 0;
+	}
+
+	// The completion interrupt must not start the same bytes in between
+	primask = __get_PRIMASK();
+	__disable_irq();
+	if(length == 0) startTransfer();
+	__set_PRIMASK(primask);
+
+	sent++;
+	return 1;
+}
+
+/**
+ * Returns the number of frames queued
+ *
+ * @returns frames
+ */
+uint32_t Telemetry::getSent() {
+	return this->sent;
+}
+
+/**
+ * Returns the number of frames dropped, the UART could not keep up
+ *
+ * @returns frames
+ */
+uint32_t Telemetry::getDropped() {
+	return this->dropped;
+}
+
+/**
+ * Transfers the queued bytes up to the end of the ring
+ *
+ * @note interrupts must be disabled
+ */
+void Telemetry::startTransfer() {
+	const uint8_t *data;
+
+	length = buffer.peekBlock(&data);
+	if(length == 0) return;
+
+	LL_DMA_DisableChannel(dma, channel);
+	LL_DMA_SetMemoryAddress(dma, channel, (uintptr_t)data);
+	LL_DMA_SetDataLength(dma, channel, length);
+	LL_DMA_EnableChannel(dma, channel);
+}
+
+void TelemetryTx_Callback(void) {
+	telemetry->__handleTransferComplete();
+}
+
+/**
+ * Handles the transfer complete interrupt of the DMA channel
+ */
+void Telemetry::__handleTransferComplete() {
+	uint32_t primask = __get_PRIMASK();
+
+	__disable_irq();
+	buffer.consume(length);
+	length = 0;
+	// Frames queued meanwhile, or the part that wrapped around
+	startTransfer();
+	__set_PRIMASK(primask);
+}
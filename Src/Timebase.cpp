@@ -0,0 +1,81 @@
+/*******************************************************************************
+ * Copyright (C) 2019 Julian Hellner - All Rights Reserved
+ *
+ * The file Timebase.cpp is part of Reflow.
+ *
+ * Unauthorized copying of this file, via any medium is strictly prohibited
+ * Proprietary and confidential
+ *
+ * Written by Julian Hellner <hellnerjulian@gmail.com>, Jul 25, 2019
+ *
+ ******************************************************************************/
+
+#include "Timebase.h"
+
+// Written by the SysTick only, odd while it writes
+static volatile uint32_t sequence;
+static volatile uint64_t baseMicros;
+static volatile uint32_t baseCycles; // Cycle count baseMicros belongs to
+
+/**
+ * Starts the cycle counter, the time starts in step with the SysTick
+ */
+void Timebase_Init(void) {
+	uint32_t tick, value, cycles;
+
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+	// Read again if the tick incremented in between
+	do {
+		tick = HAL_GetTick();
+		value = SysTick->VAL;
+		cycles = DWT->CYCCNT;
+	} while(tick != HAL_GetTick());
+
+	// The base is at the last tick, so whole ms fall on the SysTick
+	sequence += 2;
+	baseMicros = (uint64_t)tick*1000;
+	baseCycles = cycles - (SysTick->LOAD - value);
+}
+
+/**
+ * Folds the cycle counter into the 64 bit base
+ *
+ * @note called from the SysTick interrupt, which no reader can preempt
+ */
+void Timebase_Update(void) {
+	uint32_t cyclesPerMicro = SystemCoreClock / 1000000;
+	uint32_t micros = (DWT->CYCCNT - baseCycles) / cyclesPerMicro;
+
+	sequence++;
+	__DMB();
+	baseMicros += micros;
+	// The remainder stays in the cycles, so the time does not drift
+	baseCycles += micros * cyclesPerMicro;
+	__DMB();
+	sequence++;
+}
+
+/**
+ * Returns the time since boot, the ms match HAL_GetTick
+ *
+ * @note lock-free, safe from any interrupt below the SysTick priority
+ *
+ * @returns time in µs
+ */
+uint64_t Timebase_GetMicros(void) {
+	uint32_t start, cycles;
+	uint64_t micros;
+
+	// Read again if the SysTick updated the base in between
+	do {
+		start = sequence;
+		__DMB();
+		micros = baseMicros;
+		cycles = DWT->CYCCNT - baseCycles;
+		__DMB();
+	} while((start & 1) || start != sequence);
+
+	return micros + cycles / (SystemCoreClock / 1000000);
+}
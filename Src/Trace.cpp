@@ -0,0 +1,135 @@
+/*******************************************************************************
+ * Copyright (C) 2019 Julian Hellner - All Rights Reserved
+ *
+ * The file Trace.cpp is part of Reflow.
+ *
+ * Unauthorized copying of this file, via any medium is strictly prohibited
+ * Proprietary and confidential
+ *
+ * Written by Julian Hellner <hellnerjulian@gmail.com>, Jul 27, 2019
+ *
+ ******************************************************************************/
+
+#include "Trace.h"
+#include "Stack.h"
+
+#define TRACE_PORTS ((1UL << TRACE_PORT_TASK_BEGIN) | (1UL << TRACE_PORT_TASK_END) | (1UL << TRACE_PORT_ISR_ENTER) | \
+		(1UL << TRACE_PORT_ISR_EXIT) | (1UL << TRACE_PORT_VALUE) | (1UL << TRACE_PORT_VALUE_DATA))
+
+static volatile uint32_t dropped;
+
+/**
+ * Writes an event stamped with the cycle counter, a value follows on
+ * TRACE_PORT_VALUE_DATA when given
+ *
+ * @note dropped when the ITM is busy, the event and its value are written
+ * with interrupts disabled so no other event gets in between
+ *
+ * @param port: Stimulus port of the event kind
+ * @param id: Task, interrupt or value id
+ * @param *value: Value, NULL for none
+ */
+static void event(uint8_t port, uint8_t id, const int32_t *value) {
+	uint32_t primask;
+
+	// Nobody is listening, e.g. no debugger attached
+	if(!(ITM->TCR & ITM_TCR_ITMENA_Msk) || !(ITM->TER & (1UL << port)))
+		return;
+
+	primask = __get_PRIMASK();
+	__disable_irq();
+	// A stimulus port reads 1 while its FIFO has room
+	if(ITM->PORT[port].u32 == 0 || (value != NULL && ITM->PORT[TRACE_PORT_VALUE_DATA].u32 == 0)) {
+		dropped++;
+		__set_PRIMASK(primask);
+		return;
+	}
+	ITM->PORT[port].u32 = ((uint32_t)id << 24) | ((DWT->CYCCNT >> TRACE_STAMP_SHIFT) & 0x00FFFFFF);
+	if(value != NULL)
+		ITM->PORT[TRACE_PORT_VALUE_DATA].u32 = *value;
+	__set_PRIMASK(primask);
+}
+
+/**
+ * Sets up the SWO pin, the TPIU and the ITM stimulus ports
+ *
+ * @note a debugger may configure the trace again when it attaches
+ */
+void Trace_Init(void) {
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+	// Asynchronous trace on PB3
+	DBGMCU->CR = (DBGMCU->CR & ~DBGMCU_CR_TRACE_MODE) | DBGMCU_CR_TRACE_IOEN;
+
+	// NRZ at TRACE_SWO_BAUDRATE from the core clock, formatter bypassed
+	TPI->SPPR = 2;
+	TPI->ACPR = SystemCoreClock / TRACE_SWO_BAUDRATE - 1;
+	TPI->FFCR = 0x100;
+
+	ITM->LAR = 0xC5ACCE55;
+	ITM->TCR = (1UL << ITM_TCR_TraceBusID_Pos) | ITM_TCR_SYNCENA_Msk | ITM_TCR_ITMENA_Msk;
+	ITM->TPR = 0;
+	ITM->TER |= TRACE_PORTS;
+
+	dropped = 0;
+}
+
+/**
+ * Marks the start of a task
+ *
+ * @param id: Task id, TRACE_TASK_EVENTS for the event handler
+ */
+void Trace_TaskBegin(uint8_t id) {
+	event(TRACE_PORT_TASK_BEGIN, id, NULL);
+}
+
+/**
+ * Marks the end of a task
+ *
+ * @param id: Task id, TRACE_TASK_EVENTS for the event handler
+ */
+void Trace_TaskEnd(uint8_t id) {
+	event(TRACE_PORT_TASK_END, id, NULL);
+}
+
+/**
+ * Marks the entry of an interrupt handler
+ *
+ * @note samples the stack depth of the handler as well
+ *
+ * @param id: @ref TRACE_ISR_t handler
+ */
+void Trace_IsrEnter(uint8_t id) {
+	// Sampled even when nobody listens to the trace
+	Stack_SampleIsr(id);
+	event(TRACE_PORT_ISR_ENTER, id, NULL);
+}
+
+/**
+ * Marks the exit of an interrupt handler
+ *
+ * @param id: @ref TRACE_ISR_t handler
+ */
+void Trace_IsrExit(uint8_t id) {
+	event(TRACE_PORT_ISR_EXIT, id, NULL);
+}
+
+/**
+ * Records a value of the control loop
+ *
+ * @param id: @ref TRACE_VALUE_t value
+ * @param value: Value in the unit of the id
+ */
+void Trace_Value(uint8_t id, int32_t value) {
+	event(TRACE_PORT_VALUE, id, &value);
+}
+
+/**
+ * Returns the number of events dropped because the ITM was busy
+ *
+ * @returns events
+ */
+uint32_t Trace_GetDropped(void) {
+	return dropped;
+}
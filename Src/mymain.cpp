@@ -16,17 +16,29 @@ extern I2C_HandleTypeDef hi2c1;
 extern SPI_HandleTypeDef hspi2;
 
 uint16_t w = 0;
-float kp = 1.8;
+float kp = 3;
 float ki = 0.25;
-float kd = 25;
+float kd = 5;
+// Board loop of the cascade, sets the air temprature
+float boardKp = 2;
+float boardKi = 0.01;
+float boardKd = 10;
 uint8_t power =0;
 int trig=0;
-char buf[16];
+int8_t uiTask = -1;
+uint8_t selectInMenu = 0; // The last SELECT press went to the menu
+char buf[32];
 
 // Private function prototypes
 void control(void);
-void updateTemprature(void);
+void sendTelemetry(void);
+uint16_t telemetryTemprature(SampleHistory *history);
+void updateUI(void);
+void checkStack(void);
+void saveSettings(void);
 void updateDisplay(void);
+void handleEvent(uint16_t event);
+void handleInput(INPUT_EVENT_t type, INPUT_KEY_t key);
 void boot(void);
 
 
@@ -37,55 +49,187 @@ int main(void) {
 	HAL_Init(); // Reset of all peripherals, Initializes the Flash interface and the Systick.
 	InitSystem(); // Configures the system clock and initialzes all configured peripherals.
 
+	scheduler = schedulerObject.construct();
+
 	boot();
 
-	// CONTROL LOOP
-	while(1) {
-		updateTemprature();
-		printf(buf);
-		setTemp(sensor->getTemprature1());
-		oven->loop();
-		power = oven->getPower();
-		if(!menu->isActive())
-			updateDisplay();
-		HAL_Delay(500);
-	}
+	// Sensing and control run from TIM2 at a fixed rate, the UI in the main loop
+	controlLoop = controlLoopObject.construct(TIM2, TIM2_IRQn, control, OVEN_PERIOD);
+	oven->setPeriod(controlLoop->getPeriod());
+	// Samples of the control step over USART2, DMA1 channel 7. Replaces the
+	// printf of the last display line the old super loop sent every 500 ms
+	telemetry = telemetryObject.construct(DMA1, LL_DMA_CHANNEL_7);
+	telemetry->setDivider(TELEMETRY_PERIOD / controlLoop->getPeriod());
+	controlLoop->start();
+
+	// Buttons and encoder sampled by TIM1, events go to the scheduler
+	input = inputObject.construct(TIM1, scheduler);
+	input->start();
+
+	uiTask = scheduler->addTask("ui", updateUI, 200);
+	scheduler->addTask("stack", checkStack, STACK_CHECK_PERIOD);
+	scheduler->addTask("settings", saveSettings, SETTINGS_SAVE_PERIOD);
+	scheduler->setEventHandler(handleEvent);
+	scheduler->run();
 }
 
 void HAL_GPIO_EXTI_Callback(uint16_t GPIO_PIN) {
 	// ZERO X
 	if(GPIO_PIN == ZEROX_Pin) {
-		if(oven->getPower()==0) return;
-		trig++;
-		setTime(HAL_GetTick());
-		LL_TIM_EnableCounter(TIM3);
+		if(heater == NULL) return;
+		if(heater->getPower() > 0)
+			trig++;
+		heater->__handleZeroCross();
+	}
+}
+
+/**
+ * Handles an event from the scheduler queue
+ *
+ * @note the control step is held back meanwhile, the menu starts and stops the oven
+ *
+ * @param event: INPUT_EVENT of a button or the encoder
+ */
+void handleEvent(uint16_t event) {
+	controlLoop->lock();
+	handleInput(INPUT_EVENT_TYPE(event), INPUT_EVENT_KEY(event));
+	controlLoop->unlock();
+	// Presses queued together are shown with one redraw
+	scheduler->trigger(uiTask);
+}
+
+/**
+ * Handles a button or encoder event
+ *
+ * @note UP and DOWN step on every press, repeat and encoder detent, so
+ * holding them or turning sets the temprature fast
+ *
+ * @param type: @ref INPUT_EVENT_t event
+ * @param key: @ref INPUT_KEY_t key
+ */
+void handleInput(INPUT_EVENT_t type, INPUT_KEY_t key) {
+	// A press the menu acted on may have just started a run, holding it must not stop it again
+	if(type == INPUT_PRESS && key == INPUT_KEY_SELECT)
+		selectInMenu = menu->isActive();
+	// Holding SELECT stops the oven and returns to the menu
+	if(type == INPUT_LONG && key == INPUT_KEY_SELECT) {
+		if(!selectInMenu && oven->getState() != STATE_OFF) {
+			oven->switchOff();
+			menu->setActive(1);
+		}
 		return;
 	}
+	// SELECT acts on the press only, UP and DOWN on repeats and turns too
+	if(type == INPUT_RELEASE || type == INPUT_LONG) return;
+	if(key == INPUT_KEY_SELECT && type != INPUT_PRESS) return;
 
 	if(menu->isActive()) {
-			menu->buttonHandler(GPIO_PIN);
+			menu->buttonHandler(key);
 			return;
 	}
-	if(oven->getState()==STATE_REFLOW) return;
+	if(oven->getState()==STATE_REFLOW || oven->getState()==STATE_AUTOTUNE) return;
 	// Down
-	if(GPIO_PIN == DOWN_Pin) {
+	if(key == INPUT_KEY_DOWN) {
 		if(w>0) w-=10;
 	}
 	// SELECT
-	if(GPIO_PIN == SELECT_Pin) {
+	if(key == INPUT_KEY_SELECT) {
 		menu->setActive(1);
-		menu->showMenu();
 	}
 	// UP
-	if(GPIO_PIN == UP_Pin) {
+	if(key == INPUT_KEY_UP) {
 		w+=10;
 		if(w>250) w=250;
 	}
 	controller->set(w);
 }
 
-void updateTemprature(void) {
+/**
+ * Control step, runs in the TIM2 interrupt: takes the new samples and regulates the oven
+ */
+void control(void) {
 	sensor->readTemprature();
+	setTemp(sensor->getTemprature1());
+	oven->loop();
+	power = oven->getPower();
+	Trace_Value(TRACE_VALUE_TEMPRATURE, telemetryTemprature(sensor->getHistory1()));
+	Trace_Value(TRACE_VALUE_SETPOINT, ((int64_t)controller->getPrecise().raw() * 100) >> 16);
+	Trace_Value(TRACE_VALUE_AIR_SETPOINT, ((int64_t)oven->getAirSetpoint().raw() * 100) >> 16);
+	Trace_Value(TRACE_VALUE_POWER, power);
+	if(telemetry->isDue())
+		sendTelemetry();
+}
+
+/**
+ * Converts a filtered temprature for the telemetry
+ *
+ * @param *history: Sample history of the sensor
+ * @returns temprature in 0.01 °C, TELEMETRY_NO_READING without samples
+ */
+uint16_t telemetryTemprature(SampleHistory *history) {
+	int64_t t;
+
+	if(history->getCount() == 0) return TELEMETRY_NO_READING;
+	t = ((int64_t)history->getValueQ().raw() * 100) >> 16;
+	if(t < 0) return 0;
+	if(t >= TELEMETRY_NO_READING) return TELEMETRY_NO_READING - 1;
+	return t;
+}
+
+/**
+ * Sends the state of the control step, runs in the TIM2 interrupt
+ */
+void sendTelemetry(void) {
+	TELEMETRY_FRAME_t frame;
+	ProfileController *profcon = oven->getProfCon();
+	int64_t setpoint = ((int64_t)controller->getPrecise().raw() * 100) >> 16;
+
+	frame.tick = HAL_GetTick();
+	frame.temprature1 = telemetryTemprature(sensor->getHistory1());
+	frame.temprature2 = telemetryTemprature(sensor->getHistory2());
+	frame.setpoint = setpoint < 0 ? 0 : setpoint;
+	frame.power = oven->getPower();
+	frame.state = oven->getState();
+	if(oven->getState() == STATE_REFLOW && profcon != NULL) {
+		frame.profile = profcon->getProfile()->id;
+		frame.piece = profcon->getPiece();
+	} else {
+		frame.profile = TELEMETRY_NO_PROFILE;
+		frame.piece = 0;
+	}
+	telemetry->send(&frame);
+}
+
+/**
+ * UI task: the only place the screen is drawn, shows the menu when it
+ * changed or redraws the status screen
+ */
+void updateUI(void) {
+	if(menu->isActive()) {
+		if(menu->needsRedraw())
+			menu->showMenu();
+	} else {
+		updateDisplay();
+	}
+}
+
+/**
+ * Stack task: updates the high water mark of the stack and traces it
+ */
+void checkStack(void) {
+	Trace_Value(TRACE_VALUE_STACK, Stack_GetUsed());
+}
+
+/**
+ * Settings task: writes changed settings to flash
+ *
+ * @note the control step may set new gains, it is held back meanwhile
+ */
+void saveSettings(void) {
+	if(!settings->isDirty()) return;
+	controlLoop->lock();
+	settings->save();
+	controlLoop->unlock();
 }
 
 /**
@@ -98,26 +242,36 @@ void updateDisplay(void) {
 	int tmpInt1 = sensor->getTemprature1()/4;
 	float tmpFrac = sensor->getTemprature1()-(tmpInt1*4);
 	int tmpInt2 = tmpFrac*100/4;
+	int rate;
+	uint32_t delay = heater->getGateDelay(); // µs
+
+	// Heating rate in 0.1 °C/s, the control step updates the history
+	controlLoop->lock();
+	rate = sensor->getHistory1()->getSlope()*10;
+	controlLoop->unlock();
 
 	display->gotoXY(0, 43);
-	sprintf(buf, "%d.%02d°C", tmpInt1, tmpInt2);
-	display->putS(buf, &Font_7x10, WHITE, HORIZONTAL_CENTER);
+	sprintf(buf, "%d.%02d°C %c%d.%d°C/s", tmpInt1, tmpInt2, rate<0 ? '-' : '+', (rate<0 ? -rate : rate)/10, (rate<0 ? -rate : rate)%10);
+	display->putS(buf, &PageFont_7x10, WHITE, HORIZONTAL_CENTER);
 
 	tmpInt1 = sensor->getTemprature2();
 	tmpFrac = sensor->getTemprature2()-tmpInt1;
 	tmpInt2 = trunc(tmpFrac*100);
 	display->gotoXY(0, 53);
 	sprintf(buf, "%d.%02d°C", tmpInt1, tmpInt2);
-	display->putS(buf, &Font_7x10, WHITE, HORIZONTAL_CENTER);
+	display->putS(buf, &PageFont_7x10, WHITE, HORIZONTAL_CENTER);
 
 	display->gotoXY(0, 0);
 	if(oven->getState() == STATE_REFLOW)
-		sprintf(buf, "%i°C %i%% %lums %lus", controller->get(), oven->getPower(), getTimeDelay(), oven->getProfCon()->getTimePassed()/1000);
+		sprintf(buf, "%i°C %i%% %lu.%lums -%lus", controller->get(), oven->getPower(), delay/1000, delay/100%10, oven->getProfCon()->getTimeRemaining()/1000);
+	else if(oven->getState() == STATE_AUTOTUNE)
+		sprintf(buf, "Tune %u°C %i%% %u/%u", oven->getAutotune()->getSetpoint(), oven->getPower(), oven->getAutotune()->getCycles(), AUTOTUNE_CYCLES);
 	else
-		sprintf(buf, "%i°C %i%% %lums", controller->get(), oven->getPower(), getTimeDelay());
-	display->putS(buf, &Font_7x10, WHITE, ABSOLUT);
+		sprintf(buf, "%i°C %i%% %lu.%lums", controller->get(), oven->getPower(), delay/1000, delay/100%10);
+	display->putS(buf, &PageFont_7x10, WHITE, ABSOLUT);
 
-	display->updateScreen();
+	// Changed spans are sent in the background, a frame still in flight drops this one
+	display->updateScreen(FLUSH_DIRTY);
 }
 
 /**
@@ -125,7 +279,7 @@ void updateDisplay(void) {
  */
 void boot(void) {
 	// Init Display
-	display = new SSD1306(&hi2c1, 0x78);
+	display = displayObject.construct(&hi2c1, 0x78);
 	display->fill(BLACK);
 	display->updateScreen();
 	HAL_Delay(100);
@@ -141,36 +295,66 @@ void boot(void) {
 	display->putS("Reflow Oven v.0.1", &Font_7x10, WHITE, HORIZONTAL_CENTER);
 	display->updateScreen();
 
+#ifdef PID_BENCHMARK
+	PID_BENCHMARK_t bench;
+	PID_Benchmark(&bench);
+	display->fill(BLACK);
+	display->gotoXY(0, 0);
+	sprintf(buf, "float %lu cyc", bench.floatCycles);
+	display->putS(buf, &PageFont_7x10, WHITE, ABSOLUT);
+	display->gotoXY(0, 12);
+	sprintf(buf, "Q16.16 %lu cyc", bench.fixedCycles);
+	display->putS(buf, &PageFont_7x10, WHITE, ABSOLUT);
+	display->gotoXY(0, 24);
+	sprintf(buf, "max diff %u%%", bench.maxDifference);
+	display->putS(buf, &PageFont_7x10, WHITE, ABSOLUT);
+	display->updateScreen();
+	HAL_Delay(3000);
+#endif
+
 	// Init Sensor
-	sensor = new MAX6675(&hspi2, CS_GPIO_Port, CS_Pin, CS2_GPIO_Port, CS2_Pin);
+	sensor = sensorObject.construct(&hspi2, CS_GPIO_Port, CS_Pin, CS2_GPIO_Port, CS2_Pin);
 
-	sensor->readTemprature();
+	sensor->start();
 
+	// Wait for the first conversion of both sensors
 	HAL_Delay(500);
+	sensor->readTemprature();
 
-	animation = new AnimationManager(display, &heatUp, 56, 16);
-
-	/* Enable channel 1 */
-	LL_TIM_CC_EnableChannel(TIM3, LL_TIM_CHANNEL_CH1);
+	animation = animationObject.construct(display, &heatUp, 56, 16);
 
-	/* Enable TIM3 outputs */
-	LL_TIM_EnableAllOutputs(TIM3);
+	// Triac gate on TIM3, fired from the zero cross interrupt
+	heater = heaterObject.construct(TIM3);
 
-	/* Enable auto-reload register preload */
-	LL_TIM_EnableARRPreload(TIM3);
+	// Setpoint and board loop, the air loop drives the heater
+	controller = controllerObject.construct(w, Q16_16(boardKp), Q16_16(boardKi), Q16_16(boardKd));
+	airController = airControllerObject.construct(w, Q16_16(kp), Q16_16(ki), Q16_16(kd));
 
-	/* Force update generation */
-	LL_TIM_GenerateEvent_UPDATE(TIM3);
+	// Gains of the last autotune replace the defaults
+	settings = settingsObject.construct(Q16_16(kp), Q16_16(ki), Q16_16(kd));
+	if(settings->load()) {
+		Q16_16 p, i, d;
+		settings->getGains(&p, &i, &d);
+		airController->setGains(p, i, d);
+	}
 
-	LL_TIM_OC_SetCompareCH1(TIM3, 60000 - 60000*0/100);
+	display->gotoXY(0, 50);
 
-	controller = new PIDController(w, kp, ki, kd);
+	oven = ovenObject.construct(controller, sensor, heater);
+	// Without a board thermocouple the air loop controls to the setpoint directly
+	oven->setCascade(airController);
 
-	display->gotoXY(0, 50);
+	// Planned power from heat loss and ramp rate, the PID only corrects the rest
+	feedForward = feedForwardObject.construct();
+	oven->setFeedForward(feedForward);
+	oven->setSettings(settings);
 
-	oven = new OvenHelper(controller, sensor);
+	// PID controls the temprature the thermocouple will show after the dead time
+	smith = smithObject.construct();
+	oven->setSmithPredictor(smith);
 
-	menu = new MenuHelper(oven, display);
+	menu = menuObject.construct(oven, display);
+	menu->setSettings(settings);
 
 	menu->showMenu();
 }
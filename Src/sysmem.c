@@ -63,14 +63,18 @@ register char * stack_ptr asm("sp");
 caddr_t _sbrk(int incr)
 {
 	extern char end asm("end");
+	extern char _Min_Heap_Size asm("_Min_Heap_Size");
 	static char *heap_end;
 	char *prev_heap_end;
+	/* Never grow beyond the heap reserved by the linker script, everything
+	 * above it is painted for the stack watermark (Stack_Init) */
+	char *heap_limit = &end + (unsigned int)&_Min_Heap_Size;
 
 	if (heap_end == 0)
 		heap_end = &end;
 
 	prev_heap_end = heap_end;
-	if (heap_end + incr > stack_ptr)
+	if (heap_end + incr > heap_limit || heap_end + incr > stack_ptr)
 	{
 		errno = ENOMEM;
 		return (caddr_t) -1;
@@ -0,0 +1,70 @@
+/*******************************************************************************
+ * Copyright (C) 2019 Julian Hellner - All Rights Reserved
+ *
+ * The file OvenModel.cpp is part of Reflow.
+ *
+ * Unauthorized copying of this file, via any medium is strictly prohibited
+ * Proprietary and confidential
+ *
+ * Written by Julian Hellner <hellnerjulian@gmail.com>, Jul 20, 2019
+ *
+ ******************************************************************************/
+
+#include "OvenModel.h"
+
+#define STEP 0.001f // s
+
+/**
+ * Initializes the oven at ambient temperature
+ *
+ * @param gain: Steady state rise at full power in °C
+ * @param tau: Time constant in s
+ * @param deadTime: Delay between heater and thermocouple in s
+ * @param ambient: Room temperature in °C
+ * @param boardTau: Time constant of the board thermocouple in s
+ */
+OvenModel::OvenModel(float gain, float tau, float deadTime, float ambient, float boardTau) {
+	this->gain = gain;
+	this->tau = tau;
+	this->ambient = ambient;
+	this->boardTau = boardTau;
+	this->temperature = ambient;
+	this->board = ambient;
+	this->delay.assign(deadTime > STEP ? (uint32_t)(deadTime/STEP) : 1, 0.0f);
+	this->delayIndex = 0;
+}
+
+/**
+ * Advances the model by 1 ms
+ *
+ * @param power: Heater power delivered in this ms, 0 - 1
+ */
+void OvenModel::step(float power) {
+	float delayed;
+
+	// Ring of the last deadTime ms, the oldest entry reaches the thermocouple now
+	delayed = delay[delayIndex];
+	delay[delayIndex] = power;
+	if(++delayIndex >= delay.size()) delayIndex = 0;
+
+	temperature += (gain*delayed - (temperature - ambient)) * STEP / tau;
+	board += (temperature - board) * STEP / boardTau;
+}
+
+/**
+ * Returns the air temperature at the main thermocouple
+ *
+ * @returns temperature in °C
+ */
+float OvenModel::getTemperature() {
+	return this->temperature;
+}
+
+/**
+ * Returns the temperature at the board thermocouple
+ *
+ * @returns temperature in °C
+ */
+float OvenModel::getBoard() {
+	return this->board;
+}
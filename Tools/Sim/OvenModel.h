@@ -0,0 +1,65 @@
+/*******************************************************************************
+ * Copyright (C) 2019 Julian Hellner - All Rights Reserved
+ *
+ * The file OvenModel.h is part of Reflow.
+ *
+ * Unauthorized copying of this file, via any medium is strictly prohibited
+ * Proprietary and confidential
+ *
+ * Written by Julian Hellner <hellnerjulian@gmail.com>, Jul 20, 2019
+ *
+ ******************************************************************************/
+
+#ifndef OVENMODEL_H_
+#define OVENMODEL_H_
+
+#include <stdint.h>
+#include <vector>
+
+/*
+ * First order plus dead time model of the oven:
+ *   tau * dT/dt = gain * u(t - deadTime) - (T - ambient)
+ * The second thermocouple sits on the board and follows the air with its own lag.
+ */
+class OvenModel {
+private:
+	float gain; // °C above ambient at full power
+	float tau; // s
+	float ambient; // °C
+	float boardTau; // s
+	float temperature;
+	float board;
+	std::vector<float> delay; // Heater power of the last deadTime ms
+	uint32_t delayIndex;
+public:
+	/**
+	 * Initializes the oven at ambient temperature
+	 *
+	 * @param gain: Steady state rise at full power in °C
+	 * @param tau: Time constant in s
+	 * @param deadTime: Delay between heater and thermocouple in s
+	 * @param ambient: Room temperature in °C
+	 * @param boardTau: Time constant of the board thermocouple in s
+	 */
+	OvenModel(float gain, float tau, float deadTime, float ambient, float boardTau);
+	/**
+	 * Advances the model by 1 ms
+	 *
+	 * @param power: Heater power delivered in this ms, 0 - 1
+	 */
+	void step(float power);
+	/**
+	 * Returns the air temperature at the main thermocouple
+	 *
+	 * @returns temperature in °C
+	 */
+	float getTemperature(void);
+	/**
+	 * Returns the temperature at the board thermocouple
+	 *
+	 * @returns temperature in °C
+	 */
+	float getBoard(void);
+};
+
+#endif /* OVENMODEL_H_ */
@@ -0,0 +1,781 @@
+/*******************************************************************************
+ * Copyright (C) 2019 Julian Hellner - All Rights Reserved
+ *
+ * The file SimHal.cpp is part of Reflow.
+ *
+ * Unauthorized copying of this file, via any medium is strictly prohibited
+ * Proprietary and confidential
+ *
+ * Written by Julian Hellner <hellnerjulian@gmail.com>, Jul 20, 2019
+ *
+ ******************************************************************************/
+
+/*
+ * Emulated board for the host build. Time only passes while the firmware
+ * sleeps in __WFI() or HAL_Delay(), then every ms is simulated in order:
+ * zero cross (EXTI), triac gate (TIM3), conversion timer (TIM4), control
+ * timer (TIM2), input sampling (TIM1), SPI and UART DMA completion, SysTick and
+ * the oven model.
+ */
+
+#include <chrono>
+#include <math.h>
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include "SimHal.h"
+#include "Timebase.h"
+#include "Trace.h"
+#include "Stack.h"
+
+#define CPU_MHZ 64
+#define APB1_MHZ (CPU_MHZ / 2)
+#define SPI_FRAME_US 8 // 16 bit at 2 MHz
+#define SSD1306_PAGES 8
+#define SSD1306_COLUMNS 128
+#define SIM_STACK_WORDS 256
+
+uint32_t SystemCoreClock = CPU_MHZ * 1000000;
+uint32_t SimPrimask = 0;
+uintptr_t SimMsp;
+static uint32_t simStack[SIM_STACK_WORDS];
+
+GPIO_TypeDef SimGPIOA, SimGPIOB, SimGPIOC;
+TIM_TypeDef SimTIM1, SimTIM2, SimTIM3, SimTIM4;
+USART_TypeDef SimUSART2;
+DMA_TypeDef SimDMA1;
+SysTick_Type SimSysTick;
+CoreDebug_Type SimCoreDebug;
+DWT_Type SimDWT;
+ITM_Type SimITM;
+TPI_Type SimTPI;
+DBGMCU_TypeDef SimDBGMCU;
+
+I2C_TypeDef SimI2C1;
+SPI_TypeDef SimSPI2;
+I2C_HandleTypeDef hi2c1 = { &SimI2C1, HAL_I2C_STATE_READY };
+SPI_HandleTypeDef hspi2 = { &SimSPI2 };
+
+static SIM_CONFIG_t *config;
+static SIM_STATS_t stats;
+static double now; // µs
+static uint32_t tick;
+static std::chrono::steady_clock::time_point wallMark;
+static uint32_t cycleOffset;
+static uint32_t cycleLast;
+static std::mt19937 noiseSource;
+
+// Events, negative when not pending
+static double nextZeroCross;
+static double fireAt;
+static double gateEndAt;
+static double sampleAt;
+static double inputAt;
+static double controlAt;
+static double controlUpdate; // Last update of TIM2, µs
+static double spiDoneAt;
+static double uartDoneAt;
+static uint32_t irqDisabled; // Bit per IRQn masked in the NVIC
+
+// Heater power is integrated over every ms for the oven model
+static float heaterPower;
+static double heaterEnergy;
+static double heaterMark;
+
+// SPI transfer in flight
+static SPI_HandleTypeDef *spiHandle;
+static uint8_t *spiData;
+static uint16_t spiFrame;
+
+// SSD1306 display RAM and command parser
+static uint8_t gddram[SSD1306_PAGES][SSD1306_COLUMNS];
+static uint8_t column, columnStart, columnEnd;
+static uint8_t page, pageStart, pageEnd;
+static uint8_t command, argument, arguments;
+static uint8_t inverted;
+
+// Emulated flash, only the settings page at the end
+#define FLASH_SIM_START 0x0801FC00
+#define FLASH_SIM_END 0x08020000
+static uint8_t flashMapped;
+static uint8_t flashUnlocked;
+
+/*
+ * Core
+ */
+
+/**
+ * Returns the virtual time plus the host time since, in CPU cycles
+ */
+static uint32_t hostCycles(void) {
+	auto host = std::chrono::steady_clock::now() - wallMark;
+	uint64_t cycles = std::chrono::duration_cast<std::chrono::nanoseconds>(host).count() * CPU_MHZ / 1000;
+
+	return (uint32_t)((uint64_t)(now * CPU_MHZ) + cycles);
+}
+
+SimCycleCounter::operator uint32_t() const {
+	uint32_t value = hostCycles() + cycleOffset;
+
+	// Host time beyond the next event would let the counter run backwards
+	if((int32_t)(value - cycleLast) < 0) value = cycleLast;
+	cycleLast = value;
+	return value;
+}
+
+SimCycleCounter& SimCycleCounter::operator=(uint32_t value) {
+	cycleOffset = value - hostCycles();
+	cycleLast = value;
+	return *this;
+}
+
+/**
+ * Returns the stimulus port a member of SimITM.PORT belongs to
+ */
+static uint8_t stimulusPort(const void *member) {
+	return ((const uint8_t*)member - (const uint8_t*)SimITM.PORT) / sizeof(SimStimulusPort);
+}
+
+template<uint8_t SIZE>
+SimStimulus<SIZE>::operator uint32_t() const {
+	// The emulated SWO is never behind
+	return 1;
+}
+
+template<uint8_t SIZE>
+SimStimulus<SIZE>& SimStimulus<SIZE>::operator=(uint32_t value) {
+	uint8_t port = stimulusPort(this);
+	uint8_t i;
+
+	if(!(ITM->TCR & ITM_TCR_ITMENA_Msk) || !(ITM->TER & (1UL << port)))
+		return *this;
+	stats.swoBytes += 1 + SIZE;
+	if(config->swo == NULL)
+		return *this;
+
+	// Instrumentation packet: port, size code 1, 2 or 3, then the payload little endian
+	fputc((port << 3) | (SIZE == 4 ? 3 : SIZE), config->swo);
+	for(i = 0; i < SIZE; i++)
+		fputc((value >> (8*i)) & 0xFF, config->swo);
+	return *this;
+}
+
+template class SimStimulus<1>;
+template class SimStimulus<2>;
+template class SimStimulus<4>;
+
+/**
+ * Moves the virtual time forward, the heater power is integrated on the way
+ *
+ * @param time: New time in µs
+ */
+static void advanceTo(double time) {
+	heaterEnergy += heaterPower * (time - heaterMark);
+	heaterMark = time;
+	now = time;
+	SysTick->VAL = SysTick->LOAD - (uint32_t)((now - tick*1000.0) * CPU_MHZ);
+	wallMark = std::chrono::steady_clock::now();
+}
+
+/**
+ * Returns the power a resistive load receives with phase angle control
+ *
+ * @param fraction: Firing delay as fraction of the half cycle
+ * @returns power 0 - 1
+ */
+static float phasePower(double fraction) {
+	double a = fraction * M_PI;
+
+	return 1 - a/M_PI + sin(2*a)/(2*M_PI);
+}
+
+/**
+ * Returns the MAX6675 frame of a thermocouple
+ *
+ * @param temperature: Temperature at the junction in °C
+ * @returns frame with 0.25 °C resolution in bits 14 - 3
+ */
+static uint16_t thermocoupleFrame(float temperature) {
+	std::normal_distribution<float> noise(0.0f, config->noise > 0 ? config->noise : 1e-9f);
+	float t = temperature + noise(noiseSource);
+
+	if(t < 0) t = 0;
+	if(t > 1023.75f) t = 1023.75f;
+	return (uint16_t)(t * 4) << 3;
+}
+
+/*
+ * Interrupt sources
+ */
+
+/**
+ * Zero cross EXTI, the triac stops conducting and the next half cycle starts
+ */
+static void zeroCross(void) {
+	double halfPeriod = 1e6 / (2.0 * config->mains);
+
+	stats.zeroCrosses++;
+	nextZeroCross += halfPeriod;
+	heaterPower = 0;
+
+	Trace_IsrEnter(TRACE_ISR_ZEROCROSS);
+	HAL_GPIO_EXTI_Callback(ZEROX_Pin);
+	Trace_IsrExit(TRACE_ISR_ZEROCROSS);
+
+	// One pulse mode: the gate fires at compare and is released at reload
+	if(LL_TIM_IsEnabledCounter(TIM3) && TIM3->CCR1 < TIM3->ARR) {
+		double tickUs = (TIM3->PSC + 1) / (double)CPU_MHZ;
+
+		fireAt = now + TIM3->CCR1 * tickUs;
+		gateEndAt = now + (TIM3->ARR + 1) * tickUs;
+		heaterPower = phasePower(TIM3->CCR1 * tickUs / halfPeriod);
+	}
+}
+
+/**
+ * TIM3 compare, same as TIM3_IRQHandler
+ */
+static void fireGate(void) {
+	fireAt = -1;
+	stats.gatePulses++;
+	TIM3->SR |= TIM_SR_CC1IF;
+
+	Trace_IsrEnter(TRACE_ISR_GATE);
+	if(LL_TIM_IsActiveFlag_CC1(TIM3) == 1) {
+		LL_TIM_ClearFlag_CC1(TIM3);
+		HeaterFire_Callback();
+	}
+	Trace_IsrExit(TRACE_ISR_GATE);
+}
+
+/**
+ * TIM3 update, the one pulse timer stops
+ */
+static void releaseGate(void) {
+	gateEndAt = -1;
+	LL_TIM_DisableCounter(TIM3);
+}
+
+/**
+ * TIM4 update, same as TIM4_IRQHandler
+ */
+static void conversionTimer(void) {
+	sampleAt += (TIM4->PSC + 1) * (TIM4->ARR + 1) / (double)CPU_MHZ;
+
+	if(TIM4->DIER & TIM_DIER_UIE) {
+		Trace_IsrEnter(TRACE_ISR_SENSOR_TIMER);
+		TimerUpdate_Callback();
+		Trace_IsrExit(TRACE_ISR_SENSOR_TIMER);
+	}
+}
+
+/**
+ * TIM1 update, same as TIM1_UP_IRQHandler
+ */
+static void inputTimer(void) {
+	inputAt += (TIM1->PSC + 1) * (TIM1->ARR + 1) / (double)CPU_MHZ;
+
+	if(TIM1->DIER & TIM_DIER_UIE) {
+		Trace_IsrEnter(TRACE_ISR_INPUT);
+		InputTimer_Callback();
+		Trace_IsrExit(TRACE_ISR_INPUT);
+	}
+}
+
+/**
+ * TIM2 interrupt, taken when the update is pending and not masked, same as TIM2_IRQHandler
+ */
+static void controlInterrupt(void) {
+	if(!(TIM2->SR & TIM_SR_UIF) || !(TIM2->DIER & TIM_DIER_UIE) || (irqDisabled & (1U << TIM2_IRQn)))
+		return;
+
+	// The counter runs on from the update, a late start shows in it
+	TIM2->CNT = (uint32_t)((now - controlUpdate) * CPU_MHZ / (TIM2->PSC + 1));
+	Trace_IsrEnter(TRACE_ISR_CONTROL);
+	if(LL_TIM_IsActiveFlag_UPDATE(TIM2) == 1) {
+		LL_TIM_ClearFlag_UPDATE(TIM2);
+		ControlTimer_Callback();
+	}
+	Trace_IsrExit(TRACE_ISR_CONTROL);
+}
+
+/**
+ * TIM2 update
+ */
+static void controlTimer(void) {
+	controlUpdate = now;
+	controlAt += (TIM2->PSC + 1) * (TIM2->ARR + 1) / (double)CPU_MHZ;
+	TIM2->SR |= TIM_SR_UIF;
+	controlInterrupt();
+}
+
+/**
+ * SPI2 RX DMA transfer complete
+ */
+static void spiDone(void) {
+	spiDoneAt = -1;
+	memcpy(spiData, &spiFrame, sizeof(spiFrame));
+	Trace_IsrEnter(TRACE_ISR_SPI_DMA);
+	HAL_SPI_RxCpltCallback(spiHandle);
+	Trace_IsrExit(TRACE_ISR_SPI_DMA);
+}
+
+/**
+ * Returns the DMA channel of the USART2 transmitter
+ */
+static DMA_Channel_TypeDef* uartChannel(void) {
+	return &DMA1->Channel[LL_DMA_CHANNEL_7 - 1];
+}
+
+/**
+ * Tells if the DMA feeds the USART2 transmitter
+ */
+static uint8_t uartSending(void) {
+	uint32_t enabled = USART_CR1_UE | USART_CR1_TE;
+
+	return LL_DMA_IsEnabledChannel(DMA1, LL_DMA_CHANNEL_7) && LL_DMA_GetDataLength(DMA1, LL_DMA_CHANNEL_7) > 0 &&
+			(USART2->CR1 & enabled) == enabled && (USART2->CR3 & USART_CR3_DMAT) && USART2->BRR > 0;
+}
+
+/**
+ * USART2 TX DMA transfer complete, the bytes went out at the baud rate
+ */
+static void uartDone(void) {
+	DMA_Channel_TypeDef *channel = uartChannel();
+
+	uartDoneAt = -1;
+	if(config->uart != NULL)
+		fwrite((const void*)channel->CMAR, 1, channel->CNDTR, config->uart);
+	stats.uartBytes += channel->CNDTR;
+	channel->CNDTR = 0;
+	DMA1->ISR |= DMA_ISR_TCIF7;
+
+	// Same as DMA1_Channel7_IRQHandler
+	if(channel->CCR & DMA_CCR_TCIE) {
+		Trace_IsrEnter(TRACE_ISR_TELEMETRY);
+		if(LL_DMA_IsActiveFlag_TC7(DMA1) == 1) {
+			LL_DMA_ClearFlag_TC7(DMA1);
+			TelemetryTx_Callback();
+		}
+		Trace_IsrExit(TRACE_ISR_TELEMETRY);
+	}
+}
+
+/**
+ * Simulates one ms, events inside it are handled in time order
+ */
+static void step(void) {
+	double end = (tick + 1) * 1000.0;
+	double *next;
+	double period;
+
+	while(1) {
+		// Timer started by the firmware since the last event
+		if(LL_TIM_IsEnabledCounter(TIM4) && sampleAt < 0) {
+			period = (TIM4->PSC + 1) * (TIM4->ARR + 1) / (double)CPU_MHZ;
+			sampleAt = now + period;
+		} else if(!LL_TIM_IsEnabledCounter(TIM4)) {
+			sampleAt = -1;
+		}
+		if(LL_TIM_IsEnabledCounter(TIM1) && inputAt < 0) {
+			period = (TIM1->PSC + 1) * (TIM1->ARR + 1) / (double)CPU_MHZ;
+			inputAt = now + period;
+		} else if(!LL_TIM_IsEnabledCounter(TIM1)) {
+			inputAt = -1;
+		}
+		if(LL_TIM_IsEnabledCounter(TIM2) && controlAt < 0) {
+			period = (TIM2->PSC + 1) * (TIM2->ARR + 1) / (double)CPU_MHZ;
+			controlAt = now + period;
+		} else if(!LL_TIM_IsEnabledCounter(TIM2)) {
+			controlAt = -1;
+		}
+		// 10 bits per byte, 8N1
+		if(uartSending() && uartDoneAt < 0) {
+			uartDoneAt = now + LL_DMA_GetDataLength(DMA1, LL_DMA_CHANNEL_7) * 10 * USART2->BRR / (double)APB1_MHZ;
+		} else if(!uartSending()) {
+			uartDoneAt = -1;
+		}
+
+		next = NULL;
+		if(config->mains && nextZeroCross < end) next = &nextZeroCross;
+		if(fireAt >= 0 && fireAt < end && (next == NULL || fireAt < *next)) next = &fireAt;
+		if(gateEndAt >= 0 && gateEndAt < end && (next == NULL || gateEndAt < *next)) next = &gateEndAt;
+		if(sampleAt >= 0 && sampleAt < end && (next == NULL || sampleAt < *next)) next = &sampleAt;
+		if(inputAt >= 0 && inputAt < end && (next == NULL || inputAt < *next)) next = &inputAt;
+		if(controlAt >= 0 && controlAt < end && (next == NULL || controlAt < *next)) next = &controlAt;
+		if(spiDoneAt >= 0 && spiDoneAt < end && (next == NULL || spiDoneAt < *next)) next = &spiDoneAt;
+		if(uartDoneAt >= 0 && uartDoneAt < end && (next == NULL || uartDoneAt < *next)) next = &uartDoneAt;
+		if(next == NULL) break;
+
+		advanceTo(*next);
+		if(next == &nextZeroCross) zeroCross();
+		else if(next == &fireAt) fireGate();
+		else if(next == &gateEndAt) releaseGate();
+		else if(next == &sampleAt) conversionTimer();
+		else if(next == &inputAt) inputTimer();
+		else if(next == &controlAt) controlTimer();
+		else if(next == &uartDoneAt) uartDone();
+		else spiDone();
+	}
+
+	advanceTo(end);
+	tick++;
+	SysTick->VAL = SysTick->LOAD;
+	Timebase_Update();
+
+	config->oven->step(heaterEnergy / 1000.0);
+	stats.heaterEnergy += heaterEnergy / 1e6;
+	heaterEnergy = 0;
+
+	if(config->tick != NULL)
+		config->tick();
+}
+
+void Sim_WaitForInterrupt(void) {
+	// SysTick wakes up at least every ms
+	step();
+}
+
+/**
+ * Attaches the plant and resets the virtual time
+ *
+ * @param *simConfig: Simulation settings, must stay valid
+ */
+void Sim_Init(SIM_CONFIG_t *simConfig) {
+	config = simConfig;
+	memset(&stats, 0, sizeof(stats));
+	now = 0;
+	tick = 0;
+	cycleOffset = 0;
+	cycleLast = 0;
+	wallMark = std::chrono::steady_clock::now();
+	noiseSource.seed(1);
+
+	// First zero cross a bit off the ms grid
+	nextZeroCross = 333;
+	fireAt = -1;
+	gateEndAt = -1;
+	sampleAt = -1;
+	inputAt = -1;
+	controlAt = -1;
+	spiDoneAt = -1;
+	uartDoneAt = -1;
+	irqDisabled = 0;
+	heaterPower = 0;
+	heaterEnergy = 0;
+	heaterMark = 0;
+
+	// Chip selects idle high, the encoder lines are pulled up
+	GPIOB->ODR = CS_Pin | CS2_Pin;
+	GPIOB->IDR = LEFT_Pin | RIGHT_Pin;
+
+	// Firmware reads the flash through plain pointers, so it lives at the target address
+	if(!flashMapped) {
+		uintptr_t base = FLASH_SIM_START & ~(uintptr_t)0xFFF;
+		void *map = mmap((void*)base, FLASH_SIM_END - base, PROT_READ | PROT_WRITE,
+				MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+		if(map != (void*)base) {
+			fprintf(stderr, "Could not map the flash at 0x%08X\n", FLASH_SIM_START);
+			exit(2);
+		}
+		flashMapped = 1;
+	}
+	memset((void*)FLASH_SIM_START, 0xFF, FLASH_SIM_END - FLASH_SIM_START);
+	flashUnlocked = 0;
+}
+
+/**
+ * Returns the virtual time since start
+ *
+ * @returns time in µs
+ */
+uint64_t Sim_GetMicros() {
+	return (uint64_t)now;
+}
+
+/**
+ * Returns the heater power of the current half cycle
+ *
+ * @returns power 0 - 1
+ */
+float Sim_GetHeaterPower() {
+	return heaterPower;
+}
+
+/**
+ * Returns the peripheral counters
+ *
+ * @returns statistics
+ */
+const SIM_STATS_t* Sim_GetStats() {
+	return &stats;
+}
+
+/**
+ * Writes the display RAM as portable bitmap
+ *
+ * @param *path: File to write
+ * @returns 1 on success
+ */
+uint8_t Sim_WriteFramebuffer(const char *path) {
+	FILE *file = fopen(path, "w");
+	uint8_t x, y, lit;
+
+	if(file == NULL) return 0;
+
+	// Lit pixels white like on the panel, PBM uses 1 for black
+	fprintf(file, "P1\n%d %d\n", SSD1306_COLUMNS, SSD1306_PAGES*8);
+	for(y = 0; y < SSD1306_PAGES*8; y++) {
+		for(x = 0; x < SSD1306_COLUMNS; x++) {
+			lit = ((gddram[y/8][x] >> (y%8)) & 1) ^ inverted;
+			fputc(lit ? '0' : '1', file);
+		}
+		fputc('\n', file);
+	}
+	fclose(file);
+	return 1;
+}
+
+/*
+ * Board, replaces Core/Src/main.c
+ */
+
+void InitSystem(void) {
+	// Frames of main() and InitSystem() sit on top of the painted stack
+	SimMsp = (uintptr_t)&simStack[SIM_STACK_WORDS - 16];
+	Stack_Init(simStack, &simStack[SIM_STACK_WORDS]);
+
+	// TIM3: 4 MHz one pulse gate timer, compare interrupt
+	TIM3->PSC = 15;
+	TIM3->ARR = 0xFFFF;
+	LL_TIM_EnableIT_CC1(TIM3);
+
+	// TIM4: 220 ms conversion period of the MAX6675
+	TIM4->PSC = 6399;
+	TIM4->ARR = 2199;
+	LL_TIM_EnableIT_UPDATE(TIM4);
+
+	// TIM1: 1 kHz input sampling, Input enables the update interrupt
+	TIM1->PSC = 63;
+	TIM1->ARR = 999;
+
+	// TIM2: 100 kHz control loop timer, ControlLoop sets the period
+	TIM2->PSC = 639;
+	TIM2->ARR = 9999;
+
+	// USART2: telemetry, transmitted by DMA1 channel 7
+	USART2->BRR = (APB1_MHZ * 1000000 + TELEMETRY_BAUDRATE/2) / TELEMETRY_BAUDRATE;
+	USART2->CR3 = USART_CR3_DMAT;
+	USART2->CR1 = USART_CR1_UE | USART_CR1_TE;
+	DMA1->Channel[LL_DMA_CHANNEL_7 - 1].CPAR = (uintptr_t)&USART2->DR;
+
+	Trace_Init();
+}
+
+void Error_Handler(void) {
+	fprintf(stderr, "Error_Handler at %.3f s\n", now / 1e6);
+	exit(2);
+}
+
+void setTemp(uint16_t t) {
+	(void)t;
+}
+
+/*
+ * HAL
+ */
+
+HAL_StatusTypeDef HAL_Init(void) {
+	SysTick->LOAD = SystemCoreClock / 1000 - 1;
+	SysTick->VAL = SysTick->LOAD;
+	return HAL_OK;
+}
+
+void NVIC_EnableIRQ(IRQn_Type IRQn) {
+	irqDisabled &= ~(1U << IRQn);
+	// An update that got pending while masked is taken right away
+	if(IRQn == TIM2_IRQn) controlInterrupt();
+}
+
+void NVIC_DisableIRQ(IRQn_Type IRQn) {
+	irqDisabled |= 1U << IRQn;
+}
+
+uint32_t HAL_GetTick(void) {
+	return tick;
+}
+
+void HAL_Delay(uint32_t Delay) {
+	uint32_t start = tick;
+
+	// Same minimum wait as the HAL
+	if(Delay < 0xFFFFFFFFU) Delay++;
+	while(tick - start < Delay)
+		step();
+}
+
+void HAL_GPIO_WritePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState) {
+	if(PinState == GPIO_PIN_SET)
+		GPIOx->ODR |= GPIO_Pin;
+	else
+		GPIOx->ODR &= ~GPIO_Pin;
+}
+
+GPIO_PinState HAL_GPIO_ReadPin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin) {
+	return (GPIOx->IDR & GPIO_Pin) ? GPIO_PIN_SET : GPIO_PIN_RESET;
+}
+
+void HAL_GPIO_TogglePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin) {
+	GPIOx->ODR ^= GPIO_Pin;
+}
+
+HAL_StatusTypeDef HAL_FLASH_Unlock(void) {
+	flashUnlocked = 1;
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_FLASH_Lock(void) {
+	flashUnlocked = 0;
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_FLASH_Program(uint32_t TypeProgram, uint32_t Address, uint64_t Data) {
+	uint8_t halfwords = TypeProgram == FLASH_TYPEPROGRAM_WORD ? 2 : 1;
+	uint16_t *cell = (uint16_t*)(uintptr_t)Address;
+	uint8_t i;
+
+	if(!flashUnlocked || Address < FLASH_SIM_START || Address + halfwords*2 > FLASH_SIM_END || (Address & 1))
+		return HAL_ERROR;
+	for(i = 0; i < halfwords; i++) {
+		// Like on target, only erased halfwords can be written
+		if(cell[i] != 0xFFFF) return HAL_ERROR;
+		cell[i] = (uint16_t)(Data >> (16*i));
+	}
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_FLASHEx_Erase(FLASH_EraseInitTypeDef *pEraseInit, uint32_t *PageError) {
+	uint32_t end = pEraseInit->PageAddress + pEraseInit->NbPages * FLASH_PAGE_SIZE;
+
+	*PageError = 0xFFFFFFFF;
+	if(!flashUnlocked || pEraseInit->PageAddress < FLASH_SIM_START || end > FLASH_SIM_END) {
+		*PageError = pEraseInit->PageAddress;
+		return HAL_ERROR;
+	}
+	memset((void*)(uintptr_t)pEraseInit->PageAddress, 0xFF, end - pEraseInit->PageAddress);
+	return HAL_OK;
+}
+
+/**
+ * Feeds a command byte of the SSD1306, tracks the addressing window
+ *
+ * @param byte: Command or argument
+ */
+static void displayCommand(uint8_t byte) {
+	if(arguments == 0) {
+		command = byte;
+		argument = 0;
+		switch(byte) {
+		case 0x20: case 0x81: case 0x8D: case 0xA8: case 0xD3:
+		case 0xD5: case 0xD9: case 0xDA: case 0xDB:
+			arguments = 1;
+			break;
+		case 0x21: case 0x22: case 0xA3:
+			arguments = 2;
+			break;
+		case 0xA6: case 0xA7:
+			inverted = byte & 1;
+			break;
+		}
+		return;
+	}
+
+	if(command == 0x21) {
+		if(argument == 0) columnStart = column = byte & 0x7F;
+		else columnEnd = byte & 0x7F;
+	} else if(command == 0x22) {
+		if(argument == 0) pageStart = page = byte & 0x07;
+		else pageEnd = byte & 0x07;
+	}
+	argument++;
+	arguments--;
+}
+
+/**
+ * Writes display RAM in horizontal addressing mode
+ *
+ * @param byte: Pixel column of 8 pixels
+ */
+static void displayData(uint8_t byte) {
+	gddram[page][column] = byte;
+	if(column++ < columnEnd) return;
+	column = columnStart;
+	if(page++ < pageEnd) return;
+	page = pageStart;
+}
+
+/**
+ * Passes a transfer to the display, the first byte is the control byte
+ *
+ * @param control: 0x00 for commands, 0x40 for data
+ * @param *data: Bytes after the control byte
+ * @param size: Number of bytes
+ */
+static void displayWrite(uint8_t control, uint8_t *data, uint16_t size) {
+	uint16_t i;
+
+	stats.i2cBytes += size + 1;
+	for(i = 0; i < size; i++) {
+		if(control & 0x40) displayData(data[i]);
+		else displayCommand(data[i]);
+	}
+}
+
+HAL_StatusTypeDef HAL_I2C_IsDeviceReady(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint32_t Trials, uint32_t Timeout) {
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_I2C_Master_Transmit(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint8_t *pData, uint16_t Size, uint32_t Timeout) {
+	if(Size == 0) return HAL_ERROR;
+	displayWrite(pData[0], &pData[1], Size - 1);
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_I2C_Mem_Write(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress, uint16_t MemAddSize, uint8_t *pData, uint16_t Size, uint32_t Timeout) {
+	displayWrite(MemAddress, pData, Size);
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_I2C_Mem_Write_DMA(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress, uint16_t MemAddSize, uint8_t *pData, uint16_t Size) {
+	displayWrite(MemAddress, pData, Size);
+
+	// Completes right away, blocking updates spin on the bus state without sleeping
+	HAL_I2C_MemTxCpltCallback(hi2c);
+	return HAL_OK;
+}
+
+HAL_I2C_StateTypeDef HAL_I2C_GetState(I2C_HandleTypeDef *hi2c) {
+	return hi2c->State;
+}
+
+HAL_StatusTypeDef HAL_SPI_Receive_DMA(SPI_HandleTypeDef *hspi, uint8_t *pData, uint16_t Size) {
+	uint8_t cs1 = (CS_GPIO_Port->ODR & CS_Pin) == 0;
+	uint8_t cs2 = (CS2_GPIO_Port->ODR & CS2_Pin) == 0;
+
+	if(spiDoneAt >= 0) return HAL_BUSY;
+	if(Size != 1) return HAL_ERROR;
+
+	// The selected MAX6675 shifts out its last conversion, nobody drives MISO otherwise
+	if(cs1 && !cs2) spiFrame = thermocoupleFrame(config->oven->getTemperature());
+	else if(cs2 && !cs1) spiFrame = thermocoupleFrame(config->oven->getBoard());
+	else spiFrame = 0xFFFF;
+
+	stats.spiReads++;
+	spiHandle = hspi;
+	spiData = pData;
+	spiDoneAt = now + SPI_FRAME_US;
+	return HAL_OK;
+}
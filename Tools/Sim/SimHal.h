@@ -0,0 +1,72 @@
+/*******************************************************************************
+ * Copyright (C) 2019 Julian Hellner - All Rights Reserved
+ *
+ * The file SimHal.h is part of Reflow.
+ *
+ * Unauthorized copying of this file, via any medium is strictly prohibited
+ * Proprietary and confidential
+ *
+ * Written by Julian Hellner <hellnerjulian@gmail.com>, Jul 20, 2019
+ *
+ ******************************************************************************/
+
+#ifndef SIMHAL_H_
+#define SIMHAL_H_
+
+#include <stdio.h>
+
+#include "main.h"
+#include "OvenModel.h"
+
+typedef struct {
+	OvenModel *oven; // Plant read by the thermocouples and driven by the triac
+	uint8_t mains; // Mains frequency in Hz, 0 for no zero cross signal
+	float noise; // Standard deviation of the thermocouple noise in °C
+	void (*tick)(void); // Called after every simulated ms
+	FILE *uart; // Receives the bytes sent on USART2, NULL to drop them
+	FILE *swo; // Receives the ITM packets, NULL to drop them
+} SIM_CONFIG_t;
+
+typedef struct {
+	uint32_t zeroCrosses;
+	uint32_t gatePulses;
+	uint32_t spiReads;
+	uint32_t i2cBytes;
+	uint32_t uartBytes;
+	uint32_t swoBytes;
+	double heaterEnergy; // Full power seconds
+} SIM_STATS_t;
+
+/**
+ * Attaches the plant and resets the virtual time
+ *
+ * @param *simConfig: Simulation settings, must stay valid
+ */
+void Sim_Init(SIM_CONFIG_t *simConfig);
+/**
+ * Returns the virtual time since start
+ *
+ * @returns time in µs
+ */
+uint64_t Sim_GetMicros(void);
+/**
+ * Returns the heater power of the current half cycle
+ *
+ * @returns power 0 - 1
+ */
+float Sim_GetHeaterPower(void);
+/**
+ * Returns the peripheral counters
+ *
+ * @returns statistics
+ */
+const SIM_STATS_t* Sim_GetStats(void);
+/**
+ * Writes the display RAM as portable bitmap
+ *
+ * @param *path: File to write
+ * @returns 1 on success
+ */
+uint8_t Sim_WriteFramebuffer(const char *path);
+
+#endif /* SIMHAL_H_ */
@@ -0,0 +1,405 @@
+/*******************************************************************************
+ * Copyright (C) 2019 Julian Hellner - All Rights Reserved
+ *
+ * The file SimMain.cpp is part of Reflow.
+ *
+ * Unauthorized copying of this file, via any medium is strictly prohibited
+ * Proprietary and confidential
+ *
+ * Written by Julian Hellner <hellnerjulian@gmail.com>, Jul 20, 2019
+ *
+ ******************************************************************************/
+
+/*
+ * Runs the unmodified firmware against the emulated board and an oven model,
+ * starts a reflow profile and reports how well it was followed. Exits with 1
+ * when a limit given on the command line was exceeded, so runs can be used as
+ * regression tests.
+ */
+
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+
+#include "SimHal.h"
+#include "OvenHelper.h"
+#include "Scheduler.h"
+#include "ControlLoop.h"
+#include "Telemetry.h"
+#include "Trace.h"
+
+// Firmware main(), renamed by the build
+int firmware_main(void);
+
+extern OvenHelper *oven;
+extern MAX6675 *sensor;
+extern HeaterDriver *heater;
+extern Scheduler *scheduler;
+extern ControlLoop *controlLoop;
+extern Telemetry *telemetry;
+extern FixedPID_t *controller;
+extern float kp, ki, kd;
+
+typedef struct {
+	uint8_t profile;
+	HEATER_MODE_t mode;
+	uint8_t feedForward;
+	uint8_t smith; // 1 on, 0 off
+	uint8_t cascade;
+	uint16_t autotune; // °C, 0 skips the autotune
+	float gain;
+	float tau;
+	float deadTime;
+	float ambient;
+	float boardTau;
+	uint32_t start; // ms
+	uint32_t timeout; // ms
+	float speed; // Multiple of real time, 0 runs as fast as possible
+	const char *csv;
+	const char *frame;
+	const char *telemetry;
+	const char *trace;
+	float maxOvershoot; // Limits, negative when not checked
+	float maxRms;
+	float maxDuration; // s
+	float maxRuntime; // µs
+} OPTIONS_t;
+
+typedef struct {
+	uint8_t configured;
+	uint8_t tuning;
+	uint8_t started;
+	uint32_t tuneTick;
+	uint32_t tunedTick;
+	uint32_t startTick;
+	uint32_t samples;
+	double squaredError; // Of the controlled thermocouple, board in cascade mode
+	float overshoot;
+	double otherSquaredError; // Of the other one
+	float otherOvershoot;
+	float peak;
+	float target; // Highest setpoint of the profile
+	uint32_t riseTick; // Reached within 5 °C of it
+} RESULT_t;
+
+static OPTIONS_t options = {
+	0, HEATER_PHASE, 1, 1, 1, 0,
+	250.0f, 120.0f, 8.0f, 25.0f, 30.0f,
+	3000, 1800000, 0,
+	NULL, NULL, NULL, NULL,
+	-1, -1, -1, -1
+};
+static SIM_CONFIG_t config;
+static OvenModel *plant;
+static RESULT_t result;
+static FILE *csv;
+static std::chrono::steady_clock::time_point wallStart;
+
+/**
+ * Prints the results and ends the simulation
+ *
+ * @param timeout: 1 if the profile did not finish in time
+ */
+static void finish(uint8_t timeout) {
+	const SIM_STATS_t *stats = Sim_GetStats();
+	double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+	double simulated = HAL_GetTick() / 1000.0;
+	float duration = (HAL_GetTick() - result.startTick) / 1000.0f;
+	float rms = result.samples ? sqrt(result.squaredError / result.samples) : 0;
+	float otherRms = result.samples ? sqrt(result.otherSquaredError / result.samples) : 0;
+	const char *controlled = options.cascade ? "board" : "air", *other = options.cascade ? "air" : "board";
+	float worstRuntime = 0, runtime;
+	uint8_t failed = timeout, i;
+	Autotune *autotune = oven->getAutotune();
+
+	if(csv != NULL) fclose(csv);
+	if(config.uart != NULL) fclose(config.uart);
+	if(config.swo != NULL) fclose(config.swo);
+	if(options.frame != NULL && !Sim_WriteFramebuffer(options.frame))
+		fprintf(stderr, "Could not write %s\n", options.frame);
+
+	printf("profile        %s (%s%s%s%s)\n", curves[options.profile].name, options.mode == HEATER_BURST ? "burst" : "phase",
+			options.feedForward ? ", feed-forward" : "", options.smith ? ", smith predictor" : "",
+			options.cascade ? ", cascade" : "");
+	printf("plant          gain %.0f °C, tau %.0f s, dead time %.1f s, board tau %.0f s\n", options.gain, options.tau,
+			options.deadTime, options.boardTau);
+	if(options.autotune) {
+		Q16_16 kp, ki, kd;
+		Settings stored(Q16_16(0), Q16_16(0), Q16_16(0));
+
+		printf("autotune       %u °C, %s after %.1f s\n", options.autotune,
+				autotune->getState() == AUTOTUNE_DONE ? "done" : "failed", ((result.tunedTick ? result.tunedTick : HAL_GetTick()) - result.tuneTick) / 1000.0f);
+		printf("ultimate       Ku %.2f %%/°C, Pu %.1f s\n", (float)autotune->getUltimateGain(), autotune->getUltimatePeriod() / 1000.0f);
+		if(autotune->getState() != AUTOTUNE_DONE) {
+			printf("FAIL autotune\n");
+			failed = 1;
+		} else if(!stored.load()) {
+			printf("FAIL gains not stored\n");
+			failed = 1;
+		} else {
+			stored.getGains(&kp, &ki, &kd);
+			printf("gains          Kp %.2f, Ki %.3f, Kd %.1f (stored)\n", (float)kp, (float)ki, (float)kd);
+		}
+	}
+	printf("reflow         %.1f s%s\n", duration, timeout ? " (timeout)" : "");
+	printf("peak           %.1f °C, within 5 °C of %.0f °C after %.1f s\n", result.peak, result.target,
+			result.riseTick ? (result.riseTick - result.startTick) / 1000.0f : duration);
+	printf("overshoot      %.2f °C %s, %.2f °C %s\n", result.overshoot, controlled, result.otherOvershoot, other);
+	printf("rms error      %.2f °C %s, %.2f °C %s\n", rms, controlled, otherRms, other);
+	printf("heater energy  %.1f s at full power\n", stats->heaterEnergy);
+	printf("mains          %d Hz, %lu crossings, %lu fired, %lu missed\n", heater->getMains(),
+			(unsigned long)heater->getCrossings(), (unsigned long)heater->getFired(), (unsigned long)heater->getMissed());
+	printf("sensor         %lu reads, %lu dropped, %lu overruns\n", (unsigned long)stats->spiReads,
+			(unsigned long)sensor->getDropped(), (unsigned long)sensor->getOverruns());
+	printf("display        %lu bytes\n", (unsigned long)stats->i2cBytes);
+	// Runtimes are host time, the cycle counter adds it on top of the virtual time
+	printf("task           runs      worst µs  jitter µs\n");
+	for(i = 0; i < scheduler->getTaskCount(); i++) {
+		const TASK_t *task = scheduler->getTask(i);
+		runtime = task->worstCycles / (SystemCoreClock / 1e6f);
+		printf("  %-12s %-9lu %-9.2f %lu\n", task->name, (unsigned long)task->runs,
+				runtime, (unsigned long)scheduler->getWorstJitter(i));
+		if(runtime > worstRuntime) worstRuntime = runtime;
+	}
+	runtime = controlLoop->getWorstRuntime();
+	printf("control        %lu steps of %lu ms, worst %lu µs, latency %lu µs, %lu overruns\n",
+			(unsigned long)controlLoop->getRuns(), (unsigned long)controlLoop->getPeriod(), (unsigned long)runtime,
+			(unsigned long)controlLoop->getWorstLatency(), (unsigned long)controlLoop->getOverruns());
+	if(runtime > worstRuntime) worstRuntime = runtime;
+	printf("telemetry      %lu frames, %lu dropped, %lu bytes\n", (unsigned long)telemetry->getSent(),
+			(unsigned long)telemetry->getDropped(), (unsigned long)stats->uartBytes);
+	printf("trace          %lu bytes, %lu dropped\n", (unsigned long)stats->swoBytes, (unsigned long)Trace_GetDropped());
+	printf("speed          %.0fx real time\n", wall > 0 ? simulated / wall : 0);
+
+	if(options.maxOvershoot >= 0 && result.overshoot > options.maxOvershoot) {
+		printf("FAIL overshoot %.2f > %.2f °C\n", result.overshoot, options.maxOvershoot);
+		failed = 1;
+	}
+	if(options.maxRms >= 0 && rms > options.maxRms) {
+		printf("FAIL rms error %.2f > %.2f °C\n", rms, options.maxRms);
+		failed = 1;
+	}
+	if(options.maxDuration >= 0 && duration > options.maxDuration) {
+		printf("FAIL reflow %.1f > %.1f s\n", duration, options.maxDuration);
+		failed = 1;
+	}
+	if(controlLoop->getOverruns() > 0) {
+		printf("FAIL %lu control overruns\n", (unsigned long)controlLoop->getOverruns());
+		failed = 1;
+	}
+	if(telemetry->getDropped() > 0) {
+		printf("FAIL %lu telemetry frames dropped\n", (unsigned long)telemetry->getDropped());
+		failed = 1;
+	}
+	if(options.maxRuntime >= 0 && worstRuntime > options.maxRuntime) {
+		printf("FAIL task runtime %.2f > %.2f µs\n", worstRuntime, options.maxRuntime);
+		failed = 1;
+	}
+
+	exit(failed);
+}
+
+/**
+ * Drives the scenario and records the control performance, called every ms
+ */
+static void simTick(void) {
+	uint32_t now = HAL_GetTick();
+	float temperature = plant->getTemperature();
+	float controlled = options.cascade ? plant->getBoard() : temperature;
+	float other = options.cascade ? temperature : plant->getBoard();
+	float error, setpoint;
+
+	if(now >= options.timeout) finish(1);
+
+	// Paced runs keep the virtual time at a fixed multiple of the wall clock
+	if(options.speed > 0 && now % 100 == 0)
+		std::this_thread::sleep_until(wallStart + std::chrono::microseconds((uint64_t)(now * 1000 / options.speed)));
+
+	// Firmware still booting
+	if(oven == NULL) return;
+
+	if(!result.started) {
+		if(now < options.start) return;
+		if(!result.configured) {
+			heater->setMode(options.mode);
+			if(!options.feedForward) oven->setFeedForward(NULL);
+			if(!options.smith) oven->setSmithPredictor(NULL);
+			if(!options.cascade) {
+				// Single loop on the air with the gains of the air loop
+				oven->setCascade(NULL);
+				controller->setGains(Q16_16(kp), Q16_16(ki), Q16_16(kd));
+			}
+			result.configured = 1;
+		}
+		if(options.autotune && !result.tuning) {
+			oven->startAutotune(options.autotune);
+			result.tuning = 1;
+			result.tuneTick = now;
+			return;
+		}
+		// The reflow follows with the tuned gains,
+		if(oven->getState() == STATE_AUTOTUNE) return;
+		if(options.autotune && !result.tunedTick) {
+			result.tunedTick = now;
+			if(oven->getAutotune()->getState() != AUTOTUNE_DONE) {
+				result.startTick = now;
+				finish(0);
+			}
+		}
+		// and from a cold oven, like the profiles expect
+		if(options.autotune && temperature > options.ambient + 25) return;
+		oven->startReflow(&curves[options.profile]);
+		result.started = 1;
+		result.startTick = now;
+		for(uint32_t t = 0; t <= oven->getProfCon()->getDuration(); t += 1000) {
+			float w = (float)oven->getProfCon()->getSetpointAt(t);
+			if(w > result.target) result.target = w;
+		}
+		return;
+	}
+
+	if(oven->getState() != STATE_REFLOW) finish(0);
+
+	setpoint = (float)oven->getProfCon()->getSetpoint();
+	if(setpoint > 0) {
+		error = controlled - setpoint;
+		result.squaredError += error * error;
+		result.samples++;
+		if(error > result.overshoot) result.overshoot = error;
+		error = other - setpoint;
+		result.otherSquaredError += error * error;
+		if(error > result.otherOvershoot) result.otherOvershoot = error;
+	}
+	if(controlled > result.peak) result.peak = controlled;
+	if(!result.riseTick && controlled >= result.target - 5) result.riseTick = now;
+
+	if(csv != NULL && (now - result.startTick) % 1000 == 0) {
+		fprintf(csv, "%.0f,%.2f,%.2f,%.2f,%.2f,%.2f,%u\n", (now - result.startTick) / 1000.0, setpoint, temperature,
+				sensor->getHistory1()->getValue(), plant->getBoard(), (float)oven->getAirSetpoint(), oven->getPower());
+	}
+}
+
+static void usage(const char *name) {
+	printf("Usage: %s [options]\n"
+			"  --profile N         Reflow profile index (0)\n"
+			"  --burst             Burst fire instead of phase angle control\n"
+			"  --no-ff             PID only, without feed-forward\n"
+			"  --no-smith          PID on the measured temprature, without dead time compensation\n"
+			"  --no-cascade        Control the air thermocouple only, not the board\n"
+			"  --autotune C        Relay autotune at C first, the profile runs with the tuned gains\n"
+			"  --gain C            Rise above ambient at full power (250)\n"
+			"  --tau S             Oven time constant (120)\n"
+			"  --dead S            Dead time heater to thermocouple (8)\n"
+			"  --ambient C         Room temperature (25)\n"
+			"  --board-tau S       Time constant of the second thermocouple (30)\n"
+			"  --mains HZ          Mains frequency, 0 for no zero cross (50)\n"
+			"  --noise C           Thermocouple noise (0.25)\n"
+			"  --speed X           Pace the simulation at X times real time, e.g. 1000\n"
+			"  --timeout S         Give up after this simulated time (1800)\n"
+			"  --csv FILE          Write setpoint, temperatures and power every second\n"
+			"  --frame FILE        Write the last display frame as PBM\n"
+			"  --telemetry FILE    Write the telemetry stream sent on the UART\n"
+			"  --trace FILE        Write the ITM packets sent on the SWO\n"
+			"  --max-overshoot C   Fail above this overshoot\n"
+			"  --max-rms C         Fail above this rms tracking error\n"
+			"  --max-duration S    Fail when the profile took longer\n"
+			"  --max-runtime US    Fail when a task or control step ran longer (host time)\n", name);
+}
+
+int main(int argc, char **argv) {
+	int i;
+
+	config.mains = 50;
+	config.noise = 0.25f;
+	config.tick = simTick;
+
+	for(i = 1; i < argc; i++) {
+		const char *arg = argv[i];
+		const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+
+		if(strcmp(arg, "--burst") == 0) {
+			options.mode = HEATER_BURST;
+			continue;
+		}
+		if(strcmp(arg, "--no-ff") == 0) {
+			options.feedForward = 0;
+			continue;
+		}
+		if(strcmp(arg, "--no-smith") == 0) {
+			options.smith = 0;
+			continue;
+		}
+		if(strcmp(arg, "--no-cascade") == 0) {
+			options.cascade = 0;
+			continue;
+		}
+		if(value == NULL || strncmp(arg, "--", 2) != 0) {
+			usage(argv[0]);
+			return 2;
+		}
+		i++;
+
+		if(strcmp(arg, "--profile") == 0) options.profile = atoi(value);
+		else if(strcmp(arg, "--autotune") == 0) options.autotune = atoi(value);
+		else if(strcmp(arg, "--gain") == 0) options.gain = atof(value);
+		else if(strcmp(arg, "--tau") == 0) options.tau = atof(value);
+		else if(strcmp(arg, "--dead") == 0) options.deadTime = atof(value);
+		else if(strcmp(arg, "--ambient") == 0) options.ambient = atof(value);
+		else if(strcmp(arg, "--board-tau") == 0) options.boardTau = atof(value);
+		else if(strcmp(arg, "--mains") == 0) config.mains = atoi(value);
+		else if(strcmp(arg, "--noise") == 0) config.noise = atof(value);
+		else if(strcmp(arg, "--speed") == 0) options.speed = atof(value);
+		else if(strcmp(arg, "--timeout") == 0) options.timeout = atof(value) * 1000;
+		else if(strcmp(arg, "--csv") == 0) options.csv = value;
+		else if(strcmp(arg, "--frame") == 0) options.frame = value;
+		else if(strcmp(arg, "--telemetry") == 0) options.telemetry = value;
+		else if(strcmp(arg, "--trace") == 0) options.trace = value;
+		else if(strcmp(arg, "--max-overshoot") == 0) options.maxOvershoot = atof(value);
+		else if(strcmp(arg, "--max-rms") == 0) options.maxRms = atof(value);
+		else if(strcmp(arg, "--max-duration") == 0) options.maxDuration = atof(value);
+		else if(strcmp(arg, "--max-runtime") == 0) options.maxRuntime = atof(value);
+		else {
+			usage(argv[0]);
+			return 2;
+		}
+	}
+	if(options.profile >= curveslen) {
+		fprintf(stderr, "Profile %d does not exist\n", options.profile);
+		return 2;
+	}
+
+	if(options.csv != NULL) {
+		csv = fopen(options.csv, "w");
+		if(csv == NULL) {
+			fprintf(stderr, "Could not open %s\n", options.csv);
+			return 2;
+		}
+		fprintf(csv, "time,setpoint,oven,measured,board,air_setpoint,power\n");
+	}
+	if(options.telemetry != NULL) {
+		config.uart = fopen(options.telemetry, "wb");
+		if(config.uart == NULL) {
+			fprintf(stderr, "Could not open %s\n", options.telemetry);
+			return 2;
+		}
+	}
+	if(options.trace != NULL) {
+		config.swo = fopen(options.trace, "wb");
+		if(config.swo == NULL) {
+			fprintf(stderr, "Could not open %s\n", options.trace);
+			return 2;
+		}
+	}
+
+	plant = new OvenModel(options.gain, options.tau, options.deadTime, options.ambient, options.boardTau);
+	config.oven = plant;
+	Sim_Init(&config);
+	wallStart = std::chrono::steady_clock::now();
+
+	// Never returns, finish() ends the process from the tick hook
+	firmware_main();
+	return 2;
+}
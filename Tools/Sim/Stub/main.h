@@ -0,0 +1,102 @@
+/*******************************************************************************
+ * Copyright (C) 2019 Julian Hellner - All Rights Reserved
+ *
+ * The file main.h is part of Reflow.
+ *
+ * Unauthorized copying of this file, via any medium is strictly prohibited
+ * Proprietary and confidential
+ *
+ * Written by Julian Hellner <hellnerjulian@gmail.com>, Jul 20, 2019
+ *
+ ******************************************************************************/
+
+/*
+ * Host stand-in for Core/Inc/main.h: same pins and callbacks, the LL timer
+ * and DMA functions write the emulated registers.
+ */
+
+#ifndef __MAIN_H
+#define __MAIN_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "stm32f1xx_hal.h"
+
+#define LL_TIM_CHANNEL_CH1 (1U << 0)
+
+static inline void LL_TIM_EnableCounter(TIM_TypeDef *TIMx) { TIMx->CR1 |= TIM_CR1_CEN; }
+static inline void LL_TIM_DisableCounter(TIM_TypeDef *TIMx) { TIMx->CR1 &= ~TIM_CR1_CEN; }
+static inline uint32_t LL_TIM_IsEnabledCounter(TIM_TypeDef *TIMx) { return (TIMx->CR1 & TIM_CR1_CEN) != 0; }
+static inline void LL_TIM_DisableARRPreload(TIM_TypeDef *TIMx) { TIMx->CR1 &= ~TIM_CR1_ARPE; }
+static inline void LL_TIM_SetCounter(TIM_TypeDef *TIMx, uint32_t Counter) { TIMx->CNT = Counter; }
+static inline void LL_TIM_SetAutoReload(TIM_TypeDef *TIMx, uint32_t AutoReload) { TIMx->ARR = AutoReload; }
+static inline void LL_TIM_OC_SetCompareCH1(TIM_TypeDef *TIMx, uint32_t CompareValue) { TIMx->CCR1 = CompareValue; }
+static inline void LL_TIM_OC_DisablePreload(TIM_TypeDef *TIMx, uint32_t Channel) { (void)TIMx; (void)Channel; }
+static inline void LL_TIM_CC_EnableChannel(TIM_TypeDef *TIMx, uint32_t Channels) { TIMx->CCER |= Channels; }
+static inline void LL_TIM_EnableAllOutputs(TIM_TypeDef *TIMx) { TIMx->BDTR |= TIM_BDTR_MOE; }
+static inline void LL_TIM_GenerateEvent_UPDATE(TIM_TypeDef *TIMx) { TIMx->EGR |= TIM_EGR_UG; TIMx->CNT = 0; }
+static inline void LL_TIM_EnableIT_UPDATE(TIM_TypeDef *TIMx) { TIMx->DIER |= TIM_DIER_UIE; }
+static inline void LL_TIM_DisableIT_UPDATE(TIM_TypeDef *TIMx) { TIMx->DIER &= ~TIM_DIER_UIE; }
+static inline uint32_t LL_TIM_IsActiveFlag_UPDATE(TIM_TypeDef *TIMx) { return (TIMx->SR & TIM_SR_UIF) != 0; }
+static inline void LL_TIM_ClearFlag_UPDATE(TIM_TypeDef *TIMx) { TIMx->SR &= ~TIM_SR_UIF; }
+static inline uint32_t LL_TIM_GetCounter(TIM_TypeDef *TIMx) { return TIMx->CNT; }
+static inline void LL_TIM_EnableIT_CC1(TIM_TypeDef *TIMx) { TIMx->DIER |= TIM_DIER_CC1IE; }
+static inline uint32_t LL_TIM_IsActiveFlag_CC1(TIM_TypeDef *TIMx) { return (TIMx->SR & TIM_SR_CC1IF) != 0; }
+static inline void LL_TIM_ClearFlag_CC1(TIM_TypeDef *TIMx) { TIMx->SR &= ~TIM_SR_CC1IF; }
+
+#define LL_DMA_CHANNEL_7 7U
+
+static inline void LL_DMA_EnableChannel(DMA_TypeDef *DMAx, uint32_t Channel) { DMAx->Channel[Channel - 1].CCR |= DMA_CCR_EN; }
+static inline void LL_DMA_DisableChannel(DMA_TypeDef *DMAx, uint32_t Channel) { DMAx->Channel[Channel - 1].CCR &= ~DMA_CCR_EN; }
+static inline uint32_t LL_DMA_IsEnabledChannel(DMA_TypeDef *DMAx, uint32_t Channel) { return (DMAx->Channel[Channel - 1].CCR & DMA_CCR_EN) != 0; }
+static inline void LL_DMA_SetMemoryAddress(DMA_TypeDef *DMAx, uint32_t Channel, uintptr_t MemoryAddress) { DMAx->Channel[Channel - 1].CMAR = MemoryAddress; }
+static inline void LL_DMA_SetDataLength(DMA_TypeDef *DMAx, uint32_t Channel, uint32_t NbData) { DMAx->Channel[Channel - 1].CNDTR = NbData; }
+static inline uint32_t LL_DMA_GetDataLength(DMA_TypeDef *DMAx, uint32_t Channel) { return DMAx->Channel[Channel - 1].CNDTR; }
+static inline void LL_DMA_EnableIT_TC(DMA_TypeDef *DMAx, uint32_t Channel) { DMAx->Channel[Channel - 1].CCR |= DMA_CCR_TCIE; }
+static inline uint32_t LL_DMA_IsActiveFlag_TC7(DMA_TypeDef *DMAx) { return (DMAx->ISR & DMA_ISR_TCIF7) != 0; }
+static inline void LL_DMA_ClearFlag_TC7(DMA_TypeDef *DMAx) { DMAx->ISR &= ~DMA_ISR_TCIF7; }
+
+void Error_Handler(void);
+
+void InitSystem(void);
+void TimerUpdate_Callback(void);
+void HeaterFire_Callback(void);
+void ControlTimer_Callback(void);
+void InputTimer_Callback(void);
+void TelemetryTx_Callback(void);
+void setTemp(uint16_t t);
+
+#define HEATER_Pin GPIO_PIN_6
+#define HEATER_GPIO_Port GPIOA
+#define ZEROX_Pin GPIO_PIN_7
+#define ZEROX_GPIO_Port GPIOA
+#define LD_Power_Pin GPIO_PIN_4
+#define LD_Power_GPIO_Port GPIOC
+#define LEFT_Pin GPIO_PIN_0
+#define LEFT_GPIO_Port GPIOB
+#define RIGHT_Pin GPIO_PIN_1
+#define RIGHT_GPIO_Port GPIOB
+#define DOWN_Pin GPIO_PIN_2
+#define DOWN_GPIO_Port GPIOB
+#define SELECT_Pin GPIO_PIN_10
+#define SELECT_GPIO_Port GPIOB
+#define UP_Pin GPIO_PIN_11
+#define UP_GPIO_Port GPIOB
+#define CS2_Pin GPIO_PIN_12
+#define CS2_GPIO_Port GPIOB
+#define CS_Pin GPIO_PIN_15
+#define CS_GPIO_Port GPIOB
+#define TMS_Pin GPIO_PIN_13
+#define TMS_GPIO_Port GPIOA
+#define TCK_Pin GPIO_PIN_14
+#define TCK_GPIO_Port GPIOA
+
+#define TELEMETRY_BAUDRATE 115200
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __MAIN_H */
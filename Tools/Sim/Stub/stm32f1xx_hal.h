@@ -0,0 +1,337 @@
+/*******************************************************************************
+ * Copyright (C) 2019 Julian Hellner - All Rights Reserved
+ *
+ * The file stm32f1xx_hal.h is part of Reflow.
+ *
+ * Unauthorized copying of this file, via any medium is strictly prohibited
+ * Proprietary and confidential
+ *
+ * Written by Julian Hellner <hellnerjulian@gmail.com>, Jul 20, 2019
+ *
+ ******************************************************************************/
+
+/*
+ * Host stand-in for the HAL and CMSIS headers. Only the parts used by the
+ * application are provided, the peripherals are emulated in SimHal.cpp.
+ */
+
+#ifndef __STM32F1xx_HAL_H
+#define __STM32F1xx_HAL_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define UNUSED(X) (void)X
+#define assert_param(expr) ((void)0U)
+
+typedef enum {
+	HAL_OK = 0x00U,
+	HAL_ERROR = 0x01U,
+	HAL_BUSY = 0x02U,
+	HAL_TIMEOUT = 0x03U
+} HAL_StatusTypeDef;
+
+/* GPIO */
+#define GPIO_PIN_0 ((uint16_t)0x0001)
+#define GPIO_PIN_1 ((uint16_t)0x0002)
+#define GPIO_PIN_2 ((uint16_t)0x0004)
+#define GPIO_PIN_3 ((uint16_t)0x0008)
+#define GPIO_PIN_4 ((uint16_t)0x0010)
+#define GPIO_PIN_5 ((uint16_t)0x0020)
+#define GPIO_PIN_6 ((uint16_t)0x0040)
+#define GPIO_PIN_7 ((uint16_t)0x0080)
+#define GPIO_PIN_8 ((uint16_t)0x0100)
+#define GPIO_PIN_9 ((uint16_t)0x0200)
+#define GPIO_PIN_10 ((uint16_t)0x0400)
+#define GPIO_PIN_11 ((uint16_t)0x0800)
+#define GPIO_PIN_12 ((uint16_t)0x1000)
+#define GPIO_PIN_13 ((uint16_t)0x2000)
+#define GPIO_PIN_14 ((uint16_t)0x4000)
+#define GPIO_PIN_15 ((uint16_t)0x8000)
+
+typedef enum {
+	GPIO_PIN_RESET = 0,
+	GPIO_PIN_SET
+} GPIO_PinState;
+
+typedef struct {
+	volatile uint32_t IDR;
+	volatile uint32_t ODR;
+} GPIO_TypeDef;
+
+/* Timers, only the registers the LL functions in main.h touch */
+#define TIM_CR1_CEN (1U << 0)
+#define TIM_CR1_ARPE (1U << 7)
+#define TIM_DIER_UIE (1U << 0)
+#define TIM_DIER_CC1IE (1U << 1)
+#define TIM_SR_UIF (1U << 0)
+#define TIM_SR_CC1IF (1U << 1)
+#define TIM_EGR_UG (1U << 0)
+#define TIM_BDTR_MOE (1U << 15)
+
+typedef struct {
+	volatile uint32_t CR1;
+	volatile uint32_t DIER;
+	volatile uint32_t SR;
+	volatile uint32_t EGR;
+	volatile uint32_t CCER;
+	volatile uint32_t CNT;
+	volatile uint32_t PSC;
+	volatile uint32_t ARR;
+	volatile uint32_t CCR1;
+	volatile uint32_t BDTR;
+} TIM_TypeDef;
+
+/* USART and DMA, only what the telemetry uses */
+#define USART_CR1_TE (1U << 3)
+#define USART_CR1_UE (1U << 13)
+#define USART_CR3_DMAT (1U << 7)
+#define DMA_CCR_EN (1U << 0)
+#define DMA_CCR_TCIE (1U << 1)
+#define DMA_ISR_TCIF7 (1U << 25)
+
+typedef struct {
+	volatile uint32_t SR;
+	volatile uint32_t DR;
+	volatile uint32_t BRR;
+	volatile uint32_t CR1;
+	volatile uint32_t CR2;
+	volatile uint32_t CR3;
+} USART_TypeDef;
+
+// Addresses are host pointers
+typedef struct {
+	volatile uint32_t CCR;
+	volatile uint32_t CNDTR;
+	volatile uintptr_t CPAR;
+	volatile uintptr_t CMAR;
+} DMA_Channel_TypeDef;
+
+typedef struct {
+	volatile uint32_t ISR;
+	volatile uint32_t IFCR;
+	DMA_Channel_TypeDef Channel[7];
+} DMA_TypeDef;
+
+/* I2C and SPI handles */
+typedef enum {
+	HAL_I2C_STATE_RESET = 0x00U,
+	HAL_I2C_STATE_READY = 0x20U,
+	HAL_I2C_STATE_BUSY = 0x24U,
+	HAL_I2C_STATE_BUSY_TX = 0x21U
+} HAL_I2C_StateTypeDef;
+
+#define I2C_MEMADD_SIZE_8BIT 0x00000001U
+
+typedef struct {
+	uint32_t id;
+} I2C_TypeDef;
+
+typedef struct {
+	uint32_t id;
+} SPI_TypeDef;
+
+typedef struct {
+	I2C_TypeDef *Instance;
+	volatile HAL_I2C_StateTypeDef State;
+} I2C_HandleTypeDef;
+
+typedef struct {
+	SPI_TypeDef *Instance;
+} SPI_HandleTypeDef;
+
+typedef struct {
+	void *Instance;
+} DMA_HandleTypeDef;
+
+/* Cortex-M3 core */
+#define CoreDebug_DEMCR_TRCENA_Msk (1UL << 24)
+#define DWT_CTRL_CYCCNTENA_Msk (1UL << 0)
+
+typedef struct {
+	volatile uint32_t CTRL;
+	volatile uint32_t LOAD;
+	volatile uint32_t VAL;
+	volatile uint32_t CALIB;
+} SysTick_Type;
+
+typedef struct {
+	volatile uint32_t DHCSR;
+	volatile uint32_t DCRSR;
+	volatile uint32_t DCRDR;
+	volatile uint32_t DEMCR;
+} CoreDebug_Type;
+
+/* Trace, the ITM stimulus ports are in the C++ part */
+#define ITM_TCR_TraceBusID_Pos 16U
+#define ITM_TCR_SYNCENA_Msk (1UL << 2)
+#define ITM_TCR_ITMENA_Msk (1UL << 0)
+#define DBGMCU_CR_TRACE_IOEN (1UL << 5)
+#define DBGMCU_CR_TRACE_MODE (3UL << 6)
+
+typedef struct {
+	volatile uint32_t SSPSR;
+	volatile uint32_t CSPSR;
+	volatile uint32_t ACPR;
+	volatile uint32_t SPPR;
+	volatile uint32_t FFCR;
+} TPI_Type;
+
+typedef struct {
+	volatile uint32_t IDCODE;
+	volatile uint32_t CR;
+} DBGMCU_TypeDef;
+
+extern uint32_t SystemCoreClock;
+extern GPIO_TypeDef SimGPIOA, SimGPIOB, SimGPIOC;
+extern TIM_TypeDef SimTIM1, SimTIM2, SimTIM3, SimTIM4;
+extern USART_TypeDef SimUSART2;
+extern DMA_TypeDef SimDMA1;
+extern SysTick_Type SimSysTick;
+extern CoreDebug_Type SimCoreDebug;
+extern TPI_Type SimTPI;
+extern DBGMCU_TypeDef SimDBGMCU;
+
+#define GPIOA (&SimGPIOA)
+#define GPIOB (&SimGPIOB)
+#define GPIOC (&SimGPIOC)
+#define TIM1 (&SimTIM1)
+#define TIM2 (&SimTIM2)
+#define TIM3 (&SimTIM3)
+#define TIM4 (&SimTIM4)
+#define USART2 (&SimUSART2)
+#define DMA1 (&SimDMA1)
+#define SysTick (&SimSysTick)
+#define CoreDebug (&SimCoreDebug)
+#define TPI (&SimTPI)
+#define DBGMCU (&SimDBGMCU)
+
+/* Only the interrupts the application masks on its own */
+typedef enum {
+	TIM2_IRQn = 28
+} IRQn_Type;
+
+void NVIC_EnableIRQ(IRQn_Type IRQn);
+void NVIC_DisableIRQ(IRQn_Type IRQn);
+
+/* Interrupts never preempt the application on the host, they are only taken
+ * while the firmware waits in __WFI() or HAL_Delay() */
+extern uint32_t SimPrimask;
+void Sim_WaitForInterrupt(void);
+
+static inline void __DMB(void) { __sync_synchronize(); }
+static inline void __DSB(void) { __sync_synchronize(); }
+static inline void __ISB(void) { __sync_synchronize(); }
+static inline void __NOP(void) { }
+static inline void __WFI(void) { Sim_WaitForInterrupt(); }
+static inline void __disable_irq(void) { SimPrimask = 1; }
+static inline void __enable_irq(void) { SimPrimask = 0; }
+static inline uint32_t __get_PRIMASK(void) { return SimPrimask; }
+static inline void __set_PRIMASK(uint32_t priMask) { SimPrimask = priMask; }
+
+/* Main stack pointer, in a stack of its own that only the watermark
+ * (Stack.h) looks at, pointer sized on the host */
+extern uintptr_t SimMsp;
+static inline uintptr_t __get_MSP(void) { return SimMsp; }
+
+/* Flash, the last page is mapped at its target address by Sim_Init */
+#define FLASH_PAGE_SIZE 0x400U
+#define FLASH_TYPEERASE_PAGES 0x00U
+#define FLASH_TYPEPROGRAM_HALFWORD 0x01U
+#define FLASH_TYPEPROGRAM_WORD 0x02U
+#define FLASH_BANK_1 1U
+
+typedef struct {
+	uint32_t TypeErase;
+	uint32_t Banks;
+	uint32_t PageAddress;
+	uint32_t NbPages;
+} FLASH_EraseInitTypeDef;
+
+/* HAL API */
+HAL_StatusTypeDef HAL_Init(void);
+uint32_t HAL_GetTick(void);
+void HAL_Delay(uint32_t Delay);
+
+void HAL_GPIO_WritePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState);
+GPIO_PinState HAL_GPIO_ReadPin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin);
+void HAL_GPIO_TogglePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin);
+void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin);
+
+HAL_StatusTypeDef HAL_I2C_IsDeviceReady(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint32_t Trials, uint32_t Timeout);
+HAL_StatusTypeDef HAL_I2C_Master_Transmit(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint8_t *pData, uint16_t Size, uint32_t Timeout);
+HAL_StatusTypeDef HAL_I2C_Mem_Write(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress, uint16_t MemAddSize, uint8_t *pData, uint16_t Size, uint32_t Timeout);
+HAL_StatusTypeDef HAL_I2C_Mem_Write_DMA(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress, uint16_t MemAddSize, uint8_t *pData, uint16_t Size);
+HAL_I2C_StateTypeDef HAL_I2C_GetState(I2C_HandleTypeDef *hi2c);
+void HAL_I2C_MemTxCpltCallback(I2C_HandleTypeDef *hi2c);
+void HAL_I2C_ErrorCallback(I2C_HandleTypeDef *hi2c);
+
+HAL_StatusTypeDef HAL_FLASH_Unlock(void);
+HAL_StatusTypeDef HAL_FLASH_Lock(void);
+HAL_StatusTypeDef HAL_FLASH_Program(uint32_t TypeProgram, uint32_t Address, uint64_t Data);
+HAL_StatusTypeDef HAL_FLASHEx_Erase(FLASH_EraseInitTypeDef *pEraseInit, uint32_t *PageError);
+
+HAL_StatusTypeDef HAL_SPI_Receive_DMA(SPI_HandleTypeDef *hspi, uint8_t *pData, uint16_t Size);
+void HAL_SPI_RxCpltCallback(SPI_HandleTypeDef *hspi);
+void HAL_SPI_ErrorCallback(SPI_HandleTypeDef *hspi);
+
+#ifdef __cplusplus
+}
+
+/*
+ * The cycle counter follows the virtual time, so zero cross periods measure
+ * like on target, plus the host time spent since the last interrupt, so task
+ * runtimes measured by the firmware show the host CPU cost scaled to 64 MHz.
+ */
+class SimCycleCounter {
+public:
+	operator uint32_t() const;
+	SimCycleCounter& operator=(uint32_t value);
+};
+
+typedef struct {
+	volatile uint32_t CTRL;
+	SimCycleCounter CYCCNT;
+} DWT_Type;
+
+extern DWT_Type SimDWT;
+#define DWT (&SimDWT)
+
+/*
+ * A write to a stimulus port goes out as ITM packet on the emulated SWO, a
+ * read tells that the FIFO has room. C++ linkage, fonts.h includes this in
+ * an extern "C" block.
+ */
+extern "C++" {
+template<uint8_t SIZE>
+class SimStimulus {
+public:
+	operator uint32_t() const;
+	SimStimulus& operator=(uint32_t value);
+};
+}
+
+typedef struct {
+	SimStimulus<1> u8;
+	SimStimulus<2> u16;
+	SimStimulus<4> u32;
+} SimStimulusPort;
+
+typedef struct {
+	SimStimulusPort PORT[32];
+	volatile uint32_t TER;
+	volatile uint32_t TPR;
+	volatile uint32_t TCR;
+	volatile uint32_t LAR;
+} ITM_Type;
+
+extern ITM_Type SimITM;
+#define ITM (&SimITM)
+#endif
+
+#endif /* __STM32F1xx_HAL_H */
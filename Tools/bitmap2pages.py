@@ -0,0 +1,340 @@
+#!/usr/bin/env python3
+###############################################################################
+# Copyright (C) 2019 Julian Hellner - All Rights Reserved
+#
+# The file bitmap2pages.py is part of Reflow.
+#
+# Unauthorized copying of this file, via any medium is strictly prohibited
+# Proprietary and confidential
+#
+###############################################################################
+"""
+Converts fonts and sprites into the SSD1306 page layout.
+
+The display stores 8 vertical pixels per byte (bit 0 on top), one row of
+bytes per 8 pixel page. The tables in Src/Display/fonts.c and
+Src/Display/Sprite.cpp are row major and have to be transposed on every
+draw. This tool does the transposition once on the host and emits
+constexpr tables for SSD1306::drawBitmap / the PageFontDef_t overloads.
+
+Every font gets a degree sign ('°'), PageFontDef_t.degree is its index.
+Fonts without one get a ring appended after their last glyph.
+
+Inputs:
+  --c FILE      existing C arrays (FontDef_t / SpriteDef_t definitions)
+  --bdf FILE    BDF bitmap font (per glyph widths from DWIDTH)
+  --png FILE    1 bit image, dark pixels are set; name taken from file name
+
+Example (regenerates the checked in tables):
+  python3 Tools/bitmap2pages.py --c Src/Display/fonts.c --c Src/Display/Sprite.cpp \\
+      --header Inc/Display/PageFonts.h --source Src/Display/PageFonts.cpp
+
+The report on stderr lists flash footprint and the per draw work (byte
+writes for the page table versus pixel writes of the row major table).
+"""
+
+import argparse
+import os
+import re
+import struct
+import sys
+import zlib
+
+
+class Bitmap:
+    """Monochrome bitmap, pixels[y][x] is 0 or 1."""
+
+    def __init__(self, width, height, pixels):
+        self.width = width
+        self.height = height
+        self.pixels = pixels
+
+    def pages(self, width=None):
+        """Returns the bitmap in page layout, padded to width columns."""
+        width = self.width if width is None else width
+        out = []
+        for page in range((self.height + 7) // 8):
+            for x in range(width):
+                b = 0
+                for bit in range(8):
+                    y = page * 8 + bit
+                    if y < self.height and x < self.width and self.pixels[y][x]:
+                        b |= 1 << bit
+                out.append(b)
+        return out
+
+
+class Font:
+    def __init__(self, name, width, height, glyphs, advances, first=32, degree=None):
+        self.name = name
+        self.width = width
+        self.height = height
+        self.glyphs = glyphs
+        self.advances = advances
+        self.first = first
+        self.degree = degree
+        if degree is None:
+            self.glyphs.append(degree_sign(width, height))
+            self.advances.append(width)
+            self.degree = len(self.glyphs) - 1
+
+
+class Sprite:
+    def __init__(self, name, bitmap):
+        self.name = name
+        self.bitmap = bitmap
+
+
+def degree_sign(width, height):
+    """Returns a ring in the top of the cell, about a third of the height."""
+    d = min(max(3, height // 3), width)
+    thickness = max(1, height // 12)
+    x0 = (width - d) // 2
+    pixels = [[0] * width for _ in range(height)]
+    for y in range(d):
+        for x in range(d):
+            r = ((x + 0.5 - d / 2) ** 2 + (y + 0.5 - d / 2) ** 2) ** 0.5
+            if d / 2 - thickness <= r < d / 2:
+                pixels[y + 1][x + x0] = 1
+    return Bitmap(width, height, pixels)
+
+
+def parse_c(path):
+    """Reads uint16_t arrays and their FontDef_t/SpriteDef_t definitions."""
+    text = open(path, encoding="utf-8", errors="replace").read()
+    text = re.sub(r"//[^\n]*", "", text)
+    text = re.sub(r"/\*.*?\*/", "", text, flags=re.S)
+
+    arrays = {}
+    for m in re.finditer(r"const\s+uint16_t\s+(\w+)\s*\[\s*\]\s*=\s*\{(.*?)\};", text, re.S):
+        arrays[m.group(1)] = [int(v, 0) for v in re.findall(r"0[xX][0-9a-fA-F]+|\d+", m.group(2))]
+
+    fonts, sprites = [], []
+    for m in re.finditer(r"FontDef_t\s+(\w+)\s*=\s*\{\s*(\d+)\s*,\s*(\d+)\s*,\s*(\w+)\s*\}", text):
+        name, w, h, data = m.group(1), int(m.group(2)), int(m.group(3)), arrays[m.group(4)]
+        glyphs = []
+        for g in range(len(data) // h):
+            rows = data[g * h:(g + 1) * h]
+            glyphs.append(Bitmap(w, h, [[(r >> (15 - x)) & 1 for x in range(w)] for r in rows]))
+        # Existing fonts are monospaced, advance is the cell width. The
+        # glyph after '~' is the degree sign where the table has one
+        degree = 95 if len(glyphs) > 95 else None
+        fonts.append(Font(name, w, h, glyphs, [w] * len(glyphs), degree=degree))
+
+    for m in re.finditer(r"SpriteDef_t\s+(\w+)\s*=\s*\{\s*(\d+)\s*,\s*(\d+)\s*,\s*(\w+)\s*\}", text):
+        name, w, h, data = m.group(1), int(m.group(2)), int(m.group(3)), arrays[m.group(4)]
+        # Sprite rows are not padded, the bit stream runs through all words
+        pixels = []
+        for y in range(h):
+            row = []
+            for x in range(w):
+                i = y * w + x
+                row.append((data[i // 16] >> (15 - i % 16)) & 1)
+            pixels.append(row)
+        sprites.append(Sprite(name, Bitmap(w, h, pixels)))
+
+    return fonts, sprites
+
+
+def parse_bdf(path, first=32, last=126):
+    """Reads a BDF font, glyphs are placed on the font bounding box baseline."""
+    lines = open(path, encoding="latin-1").read().splitlines()
+    fbx = [int(v) for v in next(l for l in lines if l.startswith("FONTBOUNDINGBOX")).split()[1:]]
+    cell_w, cell_h, off_x, off_y = fbx
+    name = os.path.splitext(os.path.basename(path))[0]
+    name = "Font_" + re.sub(r"\W", "_", name)
+
+    glyphs = {}
+    i = 0
+    while i < len(lines):
+        if not lines[i].startswith("STARTCHAR"):
+            i += 1
+            continue
+        enc, adv, bbx, rows = None, cell_w, None, []
+        i += 1
+        while not lines[i].startswith("ENDCHAR"):
+            parts = lines[i].split()
+            if parts[0] == "ENCODING":
+                enc = int(parts[1])
+            elif parts[0] == "DWIDTH":
+                adv = int(parts[1])
+            elif parts[0] == "BBX":
+                bbx = [int(v) for v in parts[1:5]]
+            elif parts[0] == "BITMAP":
+                i += 1
+                while not lines[i].startswith("ENDCHAR"):
+                    rows.append(int(lines[i], 16) if lines[i].strip() else 0)
+                    i += 1
+                continue
+            i += 1
+        if enc is None or bbx is None:
+            continue
+        w, h, bx, by = bbx
+        bits = ((w + 7) // 8) * 8
+        pixels = [[0] * cell_w for _ in range(cell_h)]
+        top = cell_h - (h + by - off_y)
+        for y, r in enumerate(rows):
+            for x in range(w):
+                px, py = x + bx - off_x, top + y
+                if 0 <= px < cell_w and 0 <= py < cell_h and (r >> (bits - 1 - x)) & 1:
+                    pixels[py][px] = 1
+        glyphs[enc] = (Bitmap(cell_w, cell_h, pixels), min(adv, cell_w))
+
+    blank = (Bitmap(cell_w, cell_h, [[0] * cell_w for _ in range(cell_h)]), cell_w)
+    table = [glyphs.get(c, blank) for c in range(first, last + 1)]
+    degree = None
+    if 176 in glyphs:
+        table.append(glyphs[176])
+        degree = len(table) - 1
+    return Font(name, cell_w, cell_h, [g for g, _ in table], [a for _, a in table], first, degree)
+
+
+def parse_png(path, threshold=128):
+    """Minimal non interlaced PNG reader (8 bit gray, RGB, RGBA, palette)."""
+    data = open(path, "rb").read()
+    if data[:8] != b"\x89PNG\r\n\x1a\n":
+        raise ValueError("%s is not a PNG file" % path)
+    pos, idat, palette = 8, b"", None
+    while pos < len(data):
+        length, kind = struct.unpack(">I4s", data[pos:pos + 8])
+        chunk = data[pos + 8:pos + 8 + length]
+        if kind == b"IHDR":
+            w, h, depth, color, _, _, interlace = struct.unpack(">IIBBBBB", chunk)
+        elif kind == b"PLTE":
+            palette = [chunk[i:i + 3] for i in range(0, len(chunk), 3)]
+        elif kind == b"IDAT":
+            idat += chunk
+        pos += 12 + length
+    if depth != 8 or interlace:
+        raise ValueError("%s: only 8 bit non interlaced PNG supported" % path)
+    channels = {0: 1, 2: 3, 3: 1, 4: 2, 6: 4}[color]
+    raw = zlib.decompress(idat)
+    stride = w * channels
+    prev = bytearray(stride)
+    pixels = []
+    for y in range(h):
+        ftype = raw[y * (stride + 1)]
+        line = bytearray(raw[y * (stride + 1) + 1:(y + 1) * (stride + 1)])
+        for i in range(stride):
+            a = line[i - channels] if i >= channels else 0
+            b = prev[i]
+            c = prev[i - channels] if i >= channels else 0
+            if ftype == 1:
+                line[i] = (line[i] + a) & 0xFF
+            elif ftype == 2:
+                line[i] = (line[i] + b) & 0xFF
+            elif ftype == 3:
+                line[i] = (line[i] + (a + b) // 2) & 0xFF
+            elif ftype == 4:
+                p = a + b - c
+                pa, pb, pc = abs(p - a), abs(p - b), abs(p - c)
+                pred = a if pa <= pb and pa <= pc else (b if pb <= pc else c)
+                line[i] = (line[i] + pred) & 0xFF
+        prev = line
+        row = []
+        for x in range(w):
+            px = line[x * channels:(x + 1) * channels]
+            if color == 3:
+                px = palette[px[0]]
+            gray = sum(px[:3]) // len(px[:3]) if channels >= 3 or color == 3 else px[0]
+            row.append(1 if gray < threshold else 0)
+        pixels.append(row)
+    name = re.sub(r"\W", "_", os.path.splitext(os.path.basename(path))[0])
+    return Sprite(name, Bitmap(w, h, pixels))
+
+
+def c_bytes(values, indent="\t"):
+    lines = []
+    for i in range(0, len(values), 16):
+        lines.append(indent + ", ".join("0x%02x" % v for v in values[i:i + 16]) + ",")
+    return "\n".join(lines)
+
+
+def generate(fonts, sprites, header_name, inputs):
+    source = []
+    report = []
+    stamp = "Generated by Tools/bitmap2pages.py from %s, do not edit" % ", ".join(inputs)
+
+    source.append("/* %s */\n" % stamp)
+    source.append('#include "Display/%s"\n' % header_name)
+
+    decls = []
+    for f in fonts:
+        pages = (f.height + 7) // 8
+        stride = f.width * pages
+        data = []
+        for g in f.glyphs:
+            data += g.pages(f.width)
+        source.append("constexpr uint8_t %s_widths[] = {\n%s\n};" % (f.name, c_bytes(f.advances)))
+        source.append("constexpr uint8_t %s_pages[] = {\n%s\n};" % (f.name, c_bytes(data)))
+        source.append("extern constexpr PageFontDef_t Page%s = {\n\t%d,\n\t%d,\n\t%d,\n\t%d,\n\t%d,\n\t%s_widths,\n\t%s_pages\n};\n"
+                % (f.name, f.width, f.height, f.first, len(f.glyphs), f.degree, f.name, f.name))
+        decls.append("extern const PageFontDef_t Page%s;" % f.name)
+        rowmajor = len(f.glyphs) * f.height * 2
+        report.append("%-16s %3d glyphs  flash %5d B (row major %5d B)  per glyph: %3d byte writes vs %3d pixel writes"
+                % ("Page" + f.name, len(f.glyphs), len(data) + len(f.advances) + 8, rowmajor, stride, f.width * f.height))
+
+    for s in sprites:
+        b = s.bitmap
+        data = b.pages()
+        ident = "Page" + s.name[0].upper() + s.name[1:]
+        source.append("constexpr uint8_t %s_pages[] = {\n%s\n};" % (s.name, c_bytes(data)))
+        source.append("extern constexpr PageSpriteDef_t %s = {\n\t%d,\n\t%d,\n\t%s_pages\n};\n" % (ident, b.width, b.height, s.name))
+        decls.append("extern const PageSpriteDef_t %s;" % ident)
+        rowmajor = (b.width * b.height + 15) // 16 * 2
+        report.append("%-16s %3dx%-3d     flash %5d B (row major %5d B)  per draw:  %3d byte writes vs %4d pixel writes"
+                % (ident, b.width, b.height, len(data) + 4, rowmajor, len(data), b.width * b.height))
+
+    guard = "DISPLAY_" + re.sub(r"\W", "_", header_name).upper() + "_"
+    header = """/* %s */
+
+#ifndef %s
+#define %s
+
+#include "Display/fonts.h"
+#include "Display/Sprite.h"
+
+%s
+
+#endif /* %s */
+""" % (stamp, guard, guard, "\n".join(decls), guard)
+
+    return header, "\n".join(source), report
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Convert fonts/sprites to SSD1306 page layout tables")
+    parser.add_argument("--c", action="append", default=[], help="C source with FontDef_t/SpriteDef_t tables")
+    parser.add_argument("--bdf", action="append", default=[], help="BDF font")
+    parser.add_argument("--png", action="append", default=[], help="PNG sprite")
+    parser.add_argument("--header", required=True, help="header to write")
+    parser.add_argument("--source", required=True, help="C++ source to write")
+    args = parser.parse_args()
+
+    fonts, sprites = [], []
+    for path in args.c:
+        f, s = parse_c(path)
+        fonts += f
+        sprites += s
+    for path in args.bdf:
+        fonts.append(parse_bdf(path))
+    for path in args.png:
+        sprites.append(parse_png(path))
+
+    for f in fonts:
+        if f.height > 32 or f.width > 255:
+            sys.exit("%s: glyphs larger than 255x32 are not supported" % f.name)
+
+    inputs = [p.replace("\\", "/") for p in args.c + args.bdf + args.png]
+    header, source, report = generate(fonts, sprites, os.path.basename(args.header), inputs)
+    with open(args.header, "w") as fh:
+        fh.write(header)
+    with open(args.source, "w") as fh:
+        fh.write(source)
+
+    for line in report:
+        print(line, file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
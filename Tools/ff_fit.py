@@ -0,0 +1,174 @@
+#!/usr/bin/env python3
+###############################################################################
+# Copyright (C) 2019 Julian Hellner - All Rights Reserved
+#
+# The file ff_fit.py is part of Reflow.
+#
+# Unauthorized copying of this file, via any medium is strictly prohibited
+# Proprietary and confidential
+#
+###############################################################################
+"""
+Fits the feed-forward model of the oven from logged runs.
+
+The oven is taken as first order plus dead time:
+  tau * dT/dt = K * u(t - dead) - (T - ambient)
+A least squares fit of dT/dt = a*u(t - dead) + b*T + c is done for every
+dead time, the best one is kept. This gives the thermal gain (power per
+heating rate, 1/a) and the lead of the feed-forward (dead time). The heat
+loss table is then averaged per 25 °C bin from u - gain*dT/dt, bins without
+data fall back to the linear loss of the model.
+
+Input are CSV files with a header and at least the columns
+  time      s
+  measured  °C, filtered thermocouple reading
+  power     %, heater output
+e.g. written by the simulation (Tools/Sim, --csv) or a telemetry log.
+
+Example:
+  python3 Tools/ff_fit.py run1.csv run2.csv
+
+Prints the values for FeedForward.cpp (or setTable/setGain/setLead) and the
+model of SmithPredictor.cpp (or setModel).
+"""
+
+import argparse
+import csv
+import sys
+
+POINTS = 13  # FEEDFORWARD_POINTS
+STEP = 25  # FEEDFORWARD_STEP, °C
+MIN_BIN_SAMPLES = 10
+
+
+def load(path):
+    """Returns time, temperature and power lists of a log, resampled to 1 s."""
+    with open(path, newline='') as f:
+        rows = list(csv.DictReader(f))
+    if not rows:
+        return [], []
+    for column in ('time', 'measured', 'power'):
+        if column not in rows[0]:
+            sys.exit('%s: column "%s" missing' % (path, column))
+
+    temperature, power = [], []
+    next_time = float(rows[0]['time'])
+    for row in rows:
+        if float(row['time']) < next_time:
+            continue
+        temperature.append(float(row['measured']))
+        power.append(float(row['power']))
+        next_time += 1.0
+    return temperature, power
+
+
+def slopes(temperature, span):
+    """Central difference over +-span samples, None at the edges."""
+    result = [None] * len(temperature)
+    for i in range(span, len(temperature) - span):
+        result[i] = (temperature[i + span] - temperature[i - span]) / (2.0 * span)
+    return result
+
+
+def solve3(m, v):
+    """Solves the 3x3 system m*x = v by Gaussian elimination."""
+    a = [row[:] + [v[i]] for i, row in enumerate(m)]
+    for col in range(3):
+        pivot = max(range(col, 3), key=lambda r: abs(a[r][col]))
+        if abs(a[pivot][col]) < 1e-12:
+            return None
+        a[col], a[pivot] = a[pivot], a[col]
+        for r in range(3):
+            if r != col:
+                factor = a[r][col] / a[col][col]
+                for c in range(col, 4):
+                    a[r][c] -= factor * a[col][c]
+    return [a[i][3] / a[i][i] for i in range(3)]
+
+
+def samples(logs, dead):
+    """Yields (u delayed, T, dT/dt) of all logs for a dead time in s."""
+    for temperature, power, slope in logs:
+        for i in range(dead, len(temperature)):
+            if slope[i] is not None:
+                yield power[i - dead], temperature[i], slope[i]
+
+
+def fit(logs, dead):
+    """Least squares fit for one dead time, returns (a, b, c, residual)."""
+    m = [[0.0] * 3 for _ in range(3)]
+    v = [0.0] * 3
+    for u, t, s in samples(logs, dead):
+        x = (u, t, 1.0)
+        for r in range(3):
+            v[r] += x[r] * s
+            for c in range(3):
+                m[r][c] += x[r] * x[c]
+    coefficients = solve3(m, v)
+    if coefficients is None:
+        return None
+    a, b, c = coefficients
+    residual = sum((s - a * u - b * t - c) ** 2 for u, t, s in samples(logs, dead))
+    return a, b, c, residual
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split('\n')[1])
+    parser.add_argument('logs', nargs='+', help='CSV logs')
+    parser.add_argument('--max-dead', type=int, default=30, help='longest dead time tried in s')
+    parser.add_argument('--span', type=int, default=3, help='slope taken over +-span s')
+    args = parser.parse_args()
+
+    logs = []
+    for path in args.logs:
+        temperature, power = load(path)
+        logs.append((temperature, power, slopes(temperature, args.span)))
+
+    best = None
+    for dead in range(args.max_dead + 1):
+        result = fit(logs, dead)
+        if result is not None and result[0] > 0 and result[1] < 0:
+            if best is None or result[3] < best[1][3]:
+                best = (dead, result)
+    if best is None:
+        sys.exit('No plausible fit, the logs need heating and cooling phases')
+
+    dead, (a, b, c, _) = best
+    tau = -1.0 / b
+    k = -a / b
+    ambient = -c / b
+    gain = 1.0 / a
+
+    # Heat loss per bin, what the heater delivered minus what went into heating
+    sums = [0.0] * POINTS
+    counts = [0] * POINTS
+    for u, t, s in samples(logs, dead):
+        index = int(round(t / STEP))
+        if 0 <= index < POINTS and abs(t - index * STEP) <= STEP / 2:
+            sums[index] += u - gain * s
+            counts[index] += 1
+
+    table = []
+    for i in range(POINTS):
+        if counts[i] >= MIN_BIN_SAMPLES:
+            loss = sums[i] / counts[i]
+        else:
+            loss = (i * STEP - ambient) / k
+        table.append(min(1000, max(0, int(round(loss * 10)))))
+
+    print('// K %.3f °C/%%, tau %.1f s, ambient %.1f °C, dead time %d s' % (k, tau, ambient, dead), file=sys.stderr)
+    print('// samples per bin: %s' % ', '.join(str(n) for n in counts), file=sys.stderr)
+    print('// FeedForward.cpp')
+    print('static const uint16_t defaultTable[FEEDFORWARD_POINTS] = {')
+    print('\t' + ', '.join(str(p) for p in table))
+    print('};')
+    print('#define DEFAULT_GAIN %.1ff // %% per °C/s' % gain)
+    print('#define DEFAULT_LEAD %d // ms' % (dead * 1000))
+    print('// SmithPredictor.cpp')
+    print('#define DEFAULT_GAIN %.2ff // °C per %%' % k)
+    print('#define DEFAULT_TAU %d // s' % round(tau))
+    print('#define DEFAULT_DEAD_TIME %d // ms' % (dead * 1000))
+
+
+if __name__ == '__main__':
+    main()
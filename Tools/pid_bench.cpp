@@ -0,0 +1,67 @@
+/*******************************************************************************
+ * Host benchmark of the float and Q16_16 PID controller
+ *
+ * Runs both instantiations of PIDController over the same heating ramp,
+ * prints the time per step and the largest output difference.
+ *
+ * Built with the simulation (Tools/Sim), or from the project root:
+ *   g++ -O2 -DSTM32F103xB -ITools/Sim/Stub -IInc \
+ *       Tools/pid_bench.cpp Src/PIDController.cpp -o pid_bench
+ *
+ * @note the host has a hardware FPU, so the float version is not penalised
+ * like on the Cortex-M3. Use PID_Benchmark() with PID_BENCHMARK defined for
+ * cycle counts on target.
+ ******************************************************************************/
+
+#include <chrono>
+#include <stdio.h>
+
+#include "PIDController.h"
+
+#define STEPS 4096
+#define ROUNDS 2000
+
+// compute() gets the step time passed, only the constructor reads the clock
+extern "C" uint64_t Timebase_GetMicros(void) {
+	return 0;
+}
+
+template<typename T>
+static double run(T *x, T slope, int *out) {
+	auto start = std::chrono::steady_clock::now();
+
+	for(int r = 0; r < ROUNDS; r++) {
+		PIDController<T> pid(150, T(1.8f), T(0.25f), T(25.0f));
+		for(int i = 0; i < STEPS; i++)
+			out[i] = (int)pid.compute(x[i], slope, 220);
+	}
+
+	auto end = std::chrono::steady_clock::now();
+	return std::chrono::duration<double, std::nano>(end - start).count() / ((double)ROUNDS * STEPS);
+}
+
+int main(void) {
+	static float floatX[STEPS];
+	static Q16_16 fixedX[STEPS];
+	static int floatOut[STEPS], fixedOut[STEPS];
+	int maxDifference = 0;
+
+	for(int i = 0; i < STEPS; i++) {
+		// Heating ramp with overshoot and some sensor noise
+		floatX[i] = 25.0f + (i % 256) * 0.75f + (i % 7) * 0.25f;
+		fixedX[i] = Q16_16(floatX[i]);
+	}
+
+	double floatTime = run<float>(floatX, 1.75f/0.22f, floatOut);
+	double fixedTime = run<Q16_16>(fixedX, Q16_16(1.75f/0.22f), fixedOut);
+
+	for(int i = 0; i < STEPS; i++) {
+		int diff = floatOut[i] > fixedOut[i] ? floatOut[i] - fixedOut[i] : fixedOut[i] - floatOut[i];
+		if(diff > maxDifference) maxDifference = diff;
+	}
+
+	printf("float   %6.2f ns/step\n", floatTime);
+	printf("Q16_16  %6.2f ns/step\n", fixedTime);
+	printf("max output difference %d%%\n", maxDifference);
+	return 0;
+}
@@ -0,0 +1,149 @@
+#!/usr/bin/env python3
+###############################################################################
+# Copyright (C) 2019 Julian Hellner - All Rights Reserved
+#
+# The file ram_report.py is part of Reflow.
+#
+# Unauthorized copying of this file, via any medium is strictly prohibited
+# Proprietary and confidential
+#
+###############################################################################
+"""
+Prints the RAM budget of a firmware image.
+
+Every long-lived object is reserved at link time (Inc/StaticObject.h), so
+the ELF tells the whole RAM use: .data and .bss, plus the heap and stack
+the linker script reserves (_Min_Heap_Size, _Min_Stack_Size). RAM is taken
+from _sdata (its start) to _estack (its end). The largest variables are
+listed below the totals.
+
+Runs as post-build step of the project. Reads the ELF directly, no toolchain
+is needed; names are demangled when c++filt is found. Images without the
+linker script symbols (e.g. the simulation, Tools/Sim) only get the
+sections and variables listed.
+
+Example:
+  python3 Tools/ram_report.py Debug/Reflow.elf --min-free 1024
+"""
+
+import argparse
+import shutil
+import struct
+import subprocess
+import sys
+
+SHF_WRITE, SHF_ALLOC = 0x1, 0x2
+SHT_SYMTAB, SHT_NOBITS = 2, 8
+STT_OBJECT = 1
+
+
+class Elf:
+    def __init__(self, data):
+        if data[:4] != b'\x7fELF':
+            raise ValueError('not an ELF file')
+        self.data = data
+        self.wide = data[4] == 2
+        self.order = '<' if data[5] == 1 else '>'
+        if self.wide:
+            shoff, = self.unpack('Q', 0x28)
+            shentsize, shnum, shstrndx = self.unpack('HHH', 0x3A)
+        else:
+            shoff, = self.unpack('I', 0x20)
+            shentsize, shnum, shstrndx = self.unpack('HHH', 0x2E)
+        self.sections = [self.section(shoff + i * shentsize) for i in range(shnum)]
+        names = self.sections[shstrndx]
+        for section in self.sections:
+            section['name'] = self.string(names['offset'] + section['name'])
+
+    def unpack(self, fmt, offset):
+        return struct.unpack_from(self.order + fmt, self.data, offset)
+
+    def string(self, offset):
+        return self.data[offset:self.data.index(b'\0', offset)].decode('ascii', 'replace')
+
+    def section(self, offset):
+        if self.wide:
+            name, type, flags, addr, off, size, link = self.unpack('IIQQQQI', offset)
+        else:
+            name, type, flags, addr, off, size, link = self.unpack('IIIIIII', offset)
+        return {'name': name, 'type': type, 'flags': flags, 'addr': addr, 'offset': off, 'size': size, 'link': link}
+
+    def symbols(self):
+        """Yields (name, value, size, type, section index) of the symbol table."""
+        for table in self.sections:
+            if table['type'] != SHT_SYMTAB:
+                continue
+            strings = self.sections[table['link']]['offset']
+            entry = 24 if self.wide else 16
+            for offset in range(table['offset'], table['offset'] + table['size'], entry):
+                if self.wide:
+                    name, info, _, shndx, value, size = self.unpack('IBBHQQ', offset)
+                else:
+                    name, value, size, info, _, shndx = self.unpack('IIIBBH', offset)
+                yield self.string(strings + name), value, size, info & 0x0F, shndx
+
+
+def demangle(names):
+    """Returns the demangled names, unchanged without c++filt."""
+    tool = shutil.which('arm-none-eabi-c++filt') or shutil.which('c++filt')
+    if not tool or not names:
+        return names
+    result = subprocess.run([tool], input='\n'.join(names), capture_output=True, text=True)
+    lines = result.stdout.splitlines()
+    return lines if result.returncode == 0 and len(lines) == len(names) else names
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split('\n')[1])
+    parser.add_argument('elf', help='linked firmware image')
+    parser.add_argument('--top', type=int, default=15, help='number of variables to list')
+    parser.add_argument('--min-free', type=int, default=0, help='exit with 1 when less RAM stays unreserved, bytes')
+    args = parser.parse_args()
+
+    with open(args.elf, 'rb') as f:
+        elf = Elf(f.read())
+
+    # Writable sections that take RAM, ._user_heap_stack is reported from the symbols
+    ram = [(i, s) for i, s in enumerate(elf.sections)
+           if s['flags'] & SHF_ALLOC and s['flags'] & SHF_WRITE and s['size'] and s['name'] != '._user_heap_stack']
+    indices = set(i for i, _ in ram)
+    symbols = {}
+    variables = []
+    for name, value, size, type, shndx in elf.symbols():
+        symbols.setdefault(name, value)
+        if type == STT_OBJECT and size and shndx in indices:
+            variables.append((size, name, elf.sections[shndx]['name']))
+
+    print('%-20s %8s' % ('section', 'bytes'))
+    used = 0
+    for _, section in ram:
+        print('%-20s %8d%s' % (section['name'], section['size'], '' if section['type'] == SHT_NOBITS else '  (+ flash copy)'))
+        used += section['size']
+
+    status = 0
+    if all(name in symbols for name in ('_sdata', '_estack', '_Min_Heap_Size', '_Min_Stack_Size')):
+        heap, stack = symbols['_Min_Heap_Size'], symbols['_Min_Stack_Size']
+        total = symbols['_estack'] - symbols['_sdata']
+        free = total - used - heap - stack
+        print('%-20s %8d' % ('heap (reserved)', heap))
+        print('%-20s %8d' % ('stack (reserved)', stack))
+        print('%-20s %8d  %.1f%% of %d' % ('used', used + heap + stack, 100.0 * (used + heap + stack) / total, total))
+        print('%-20s %8d' % ('free', free))
+        if free < args.min_free:
+            print('RAM budget exceeded: %d bytes free, %d required' % (free, args.min_free), file=sys.stderr)
+            status = 1
+    else:
+        print('%-20s %8d' % ('used', used))
+
+    variables.sort(reverse=True)
+    variables = variables[:args.top]
+    names = demangle([name for _, name, _ in variables])
+    print()
+    print('%8s  %-12s %s' % ('bytes', 'section', 'variable'))
+    for (size, _, section), name in zip(variables, names):
+        print('%8d  %-12s %s' % (size, section, name))
+    sys.exit(status)
+
+
+if __name__ == '__main__':
+    main()
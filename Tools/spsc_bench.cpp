@@ -0,0 +1,145 @@
+/*******************************************************************************
+ * Host stress test and benchmark of the SpscQueue
+ *
+ * A producer and a consumer thread hand items through the queue as fast as
+ * they can, like an interrupt and the main loop but truly in parallel. The
+ * consumer checks that every item arrives once, in order and not torn, for
+ * single items (push/pop) and for blocks (pushBlock/peekBlock/consume, as
+ * used by the telemetry DMA). Prints the throughput of both.
+ *
+ * Built with the simulation (Tools/Sim), or from the project root:
+ *   g++ -O2 -pthread -ITools/Sim/Stub -IInc Tools/spsc_bench.cpp -o spsc_bench
+ *   ./spsc_bench [items]
+ *
+ * @note exits with 1 on the first item that is lost, repeated or torn
+ ******************************************************************************/
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <thread>
+
+#include "SpscQueue.h"
+
+#define ITEMS 20000000UL
+#define BLOCK_MAX 29 // Telemetry frames are up to TELEMETRY_ENCODED_MAX bytes
+
+typedef struct {
+	uint32_t sequence;
+	uint32_t check; // Derived from sequence, a torn item does not match
+	uint64_t pad; // Larger than a word, copied in several stores
+} ITEM_t;
+
+static uint32_t checkOf(uint32_t sequence) {
+	return ~sequence * 2654435761U;
+}
+
+/**
+ * Passes single items from a producer to a consumer thread
+ *
+ * @param items: Number of items
+ * @returns errors, the seconds taken in *seconds
+ */
+static unsigned long runItems(unsigned long items, double *seconds) {
+	static SpscQueue<ITEM_t, 64> queue;
+	unsigned long errors = 0;
+	auto start = std::chrono::steady_clock::now();
+
+	std::thread producer([&]() {
+		ITEM_t item;
+
+		for(uint32_t i = 0; i < items; i++) {
+			item.sequence = i;
+			item.check = checkOf(i);
+			item.pad = (uint64_t)i << 32 | i;
+			while(!queue.push(item))
+				std::this_thread::yield();
+		}
+	});
+
+	ITEM_t item;
+	for(uint32_t expected = 0; expected < items; ) {
+		if(!queue.pop(&item)) {
+			std::this_thread::yield();
+			continue;
+		}
+		if(item.sequence != expected || item.check != checkOf(expected) || item.pad != ((uint64_t)expected << 32 | expected)) {
+			if(errors++ == 0)
+				fprintf(stderr, "item %u: got %u (check %s)\n", expected, item.sequence, item.check == checkOf(item.sequence) ? "ok" : "torn");
+			expected = item.sequence;
+		}
+		expected++;
+	}
+	producer.join();
+
+	*seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	if(!queue.isEmpty()) errors++;
+	return errors;
+}
+
+/**
+ * Passes a byte stream in blocks of varying size, the consumer takes the
+ * contiguous part like a DMA transfer
+ *
+ * @param bytes: Number of bytes
+ * @returns errors, the seconds taken in *seconds
+ */
+static unsigned long runBlocks(unsigned long bytes, double *seconds) {
+	static SpscQueue<uint8_t, 256> queue;
+	unsigned long errors = 0;
+	auto start = std::chrono::steady_clock::now();
+
+	std::thread producer([&]() {
+		uint8_t block[BLOCK_MAX];
+		uint32_t sent = 0;
+		uint16_t size, i;
+
+		while(sent < bytes) {
+			size = 1 + sent % BLOCK_MAX;
+			if(size > bytes - sent) size = bytes - sent;
+			for(i = 0; i < size; i++)
+				block[i] = (uint8_t)(sent + i);
+			while(!queue.pushBlock(block, size))
+				std::this_thread::yield();
+			sent += size;
+		}
+	});
+
+	const uint8_t *data;
+	uint16_t length, i;
+	for(uint32_t received = 0; received < bytes; ) {
+		length = queue.peekBlock(&data);
+		if(length == 0) {
+			std::this_thread::yield();
+			continue;
+		}
+		for(i = 0; i < length; i++) {
+			if(data[i] != (uint8_t)(received + i) && errors++ == 0)
+				fprintf(stderr, "byte %u: got %u\n", received + i, data[i]);
+		}
+		received += length;
+		queue.consume(length);
+	}
+	producer.join();
+
+	*seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	if(!queue.isEmpty()) errors++;
+	return errors;
+}
+
+int main(int argc, char **argv) {
+	unsigned long items = argc > 1 ? strtoul(argv[1], NULL, 0) : ITEMS;
+	unsigned long errors;
+	double seconds;
+
+	errors = runItems(items, &seconds);
+	printf("push/pop        %10lu items %8.2f Mitems/s %lu errors\n", items, items / seconds / 1e6, errors);
+	if(errors) return 1;
+
+	errors = runBlocks(items, &seconds);
+	printf("block/consume   %10lu bytes %8.2f MB/s     %lu errors\n", items, items / seconds / 1e6, errors);
+	if(errors) return 1;
+
+	printf("%u hardware threads\n", std::thread::hardware_concurrency());
+	return 0;
+}
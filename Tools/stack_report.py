@@ -0,0 +1,187 @@
+#!/usr/bin/env python3
+###############################################################################
+# Copyright (C) 2019 Julian Hellner - All Rights Reserved
+#
+# The file stack_report.py is part of Reflow.
+#
+# Unauthorized copying of this file, via any medium is strictly prohibited
+# Proprietary and confidential
+#
+###############################################################################
+"""
+Prints the worst case stack depth of every entry point of a firmware image.
+
+The frame of each function comes from the .su files of -fstack-usage, the
+calls from the disassembly of the image (objdump): bl/blx, and b.w to the
+start of another function (tail calls). The deepest path is searched from
+main and from every interrupt handler (*_Handler). Functions without a
+frame size (libraries, assembly) count as 0 and are marked '?', indirect
+calls (function pointers, virtual calls) cannot be followed and mark their
+caller with '*', recursion is reported and cut.
+
+An interrupt pushes an exception frame (32 bytes) on top of whatever it
+preempted. The total assumes every handler nests into the deepest point of
+main, which overestimates unless all priorities differ. Compare it with the
+high water mark of the running firmware (Inc/Stack.h).
+
+Runs as post-build step of the project, build with -fstack-usage.
+
+Example:
+  python3 Tools/stack_report.py Debug/Reflow.elf --su-dir Debug --max 4096
+"""
+
+import argparse
+import os
+import re
+import shutil
+import subprocess
+import sys
+
+EXCEPTION_FRAME = 32
+SU_LINE = re.compile(r'^(?:.*?):\d+:\d+:(.*)\t(\d+)\t(\S+)$')
+FUNCTION = re.compile(r'^[0-9a-f]+ <(.*)>:$')
+CALL = re.compile(r'\t(bl|blx|call|callq)\s+[0-9a-f]+ <(.*?)(\+0x[0-9a-f]+)?>$')
+TAIL = re.compile(r'\t(b\.w|b|jmp|jmpq)\s+[0-9a-f]+ <(.*?)>$')
+INDIRECT = re.compile(r'\t(blx\s+r\d+|blx\s+(ip|lr)|call[q]?\s+\*)')
+
+
+def key(name):
+    """Returns the function name without return type, template and call arguments."""
+    name = re.sub(r' \[(with|clone) .*\]$', '', name.split('@')[0])
+    while True:
+        stripped = re.sub(r'<[^<>]*>', '', name)
+        if stripped == name:
+            break
+        name = stripped
+    name = name.split('(')[0].strip()
+    # Conversion operators have a type in their name
+    match = re.search(r'\S*operator\b.*$', name)
+    if match:
+        return match.group(0)
+    return name.split(' ')[-1] if name else name
+
+
+def read_frames(directory):
+    """Returns the frame size per function and the functions with a dynamic frame."""
+    frames, dynamic = {}, set()
+    for root, _, files in os.walk(directory):
+        for file in files:
+            if not file.endswith('.su'):
+                continue
+            with open(os.path.join(root, file)) as f:
+                for line in f:
+                    match = SU_LINE.match(line.rstrip('\n'))
+                    if not match:
+                        continue
+                    name = key(match.group(1))
+                    frames[name] = max(frames.get(name, 0), int(match.group(2)))
+                    if match.group(3) != 'static':
+                        dynamic.add(name)
+    return frames, dynamic
+
+
+def read_calls(elf, objdump):
+    """Returns the called functions per function and the functions with indirect calls."""
+    output = subprocess.run([objdump, '-d', '-C', '--no-show-raw-insn', elf],
+                            capture_output=True, text=True, check=True).stdout
+    calls, indirect = {}, set()
+    current = None
+    for line in output.splitlines():
+        match = FUNCTION.match(line)
+        if match:
+            current = key(match.group(1))
+            calls.setdefault(current, set())
+            continue
+        if current is None:
+            continue
+        match = CALL.search(line) or TAIL.search(line)
+        # A branch into a function is a jump within it
+        if match and not re.search(r'\+0x[0-9a-f]+$', match.group(2)):
+            callee = key(match.group(2))
+            if callee != current:
+                calls[current].add(callee)
+        elif INDIRECT.search(line):
+            indirect.add(current)
+    return calls, indirect
+
+
+class Graph:
+    def __init__(self, frames, dynamic, calls, indirect):
+        self.frames = frames
+        self.dynamic = dynamic
+        self.calls = calls
+        self.indirect = indirect
+        self.memo = {}
+        self.recursive = set()
+
+    def deepest(self, function, path=()):
+        """Returns (depth, path) of the deepest call chain from function."""
+        if function in path:
+            self.recursive.add(function)
+            return 0, []
+        if function in self.memo:
+            return self.memo[function]
+        depth, chain = 0, []
+        for callee in sorted(self.calls.get(function, ())):
+            d, c = self.deepest(callee, path + (function,))
+            if d > depth:
+                depth, chain = d, c
+        result = (self.frames.get(function, 0) + depth, [function] + chain)
+        self.memo[function] = result
+        return result
+
+    def mark(self, function):
+        return ('?' if function not in self.frames else '') + \
+               ('*' if function in self.indirect else '') + \
+               ('~' if function in self.dynamic else '')
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split('\n')[1])
+    parser.add_argument('elf', help='linked firmware image')
+    parser.add_argument('--su-dir', default='.', help='directory searched for the .su files')
+    parser.add_argument('--objdump', help='objdump of the target, arm-none-eabi-objdump by default')
+    parser.add_argument('--root', action='append', help='entry point, main and all *_Handler by default')
+    parser.add_argument('--path', action='store_true', help='print the deepest call chain of every entry point')
+    parser.add_argument('--max', type=int, help='exit with 1 when the total exceeds this, bytes')
+    args = parser.parse_args()
+
+    objdump = args.objdump or shutil.which('arm-none-eabi-objdump') or shutil.which('objdump')
+    if not objdump:
+        sys.exit('no objdump found')
+    frames, dynamic = read_frames(args.su_dir)
+    if not frames:
+        sys.exit('no .su files in %s, build with -fstack-usage' % args.su_dir)
+    calls, indirect = read_calls(args.elf, objdump)
+    graph = Graph(frames, dynamic, calls, indirect)
+
+    roots = args.root or ['main'] + sorted(f for f in calls if f.endswith('_Handler'))
+    results = [(root,) + graph.deepest(root) for root in roots if root in calls]
+    if not results:
+        sys.exit('none of the entry points is in the image')
+
+    print('%8s  %s' % ('bytes', 'entry point'))
+    for root, depth, chain in results:
+        print('%8d  %s%s' % (depth, root, graph.mark(root)))
+        if args.path:
+            for function in chain[1:]:
+                print('%8d    %s%s' % (frames.get(function, 0), function, graph.mark(function)))
+
+    base = max([depth for root, depth, _ in results if not root.endswith('_Handler')] or [0])
+    handlers = [depth + EXCEPTION_FRAME for root, depth, _ in results if root.endswith('_Handler')]
+    total = base + sum(handlers)
+    print()
+    print('%8d  total, %d handlers nested on the deepest entry point' % (total, len(handlers)))
+    print('? no frame size, * indirect calls not followed, ~ dynamic frame')
+    unknown = sorted(f for f in graph.memo if f not in frames)
+    if unknown:
+        print('no frame size: %s' % ', '.join(unknown[:20]) + (' ...' if len(unknown) > 20 else ''))
+    if graph.recursive:
+        print('recursion cut at: %s' % ', '.join(sorted(graph.recursive)))
+    if args.max is not None and total > args.max:
+        print('Stack budget exceeded: %d bytes, %d allowed' % (total, args.max), file=sys.stderr)
+        sys.exit(1)
+
+
+if __name__ == '__main__':
+    main()
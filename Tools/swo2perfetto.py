@@ -0,0 +1,180 @@
+#!/usr/bin/env python3
+###############################################################################
+# Copyright (C) 2019 Julian Hellner - All Rights Reserved
+#
+# The file swo2perfetto.py is part of Reflow.
+#
+# Unauthorized copying of this file, via any medium is strictly prohibited
+# Proprietary and confidential
+#
+###############################################################################
+"""
+Converts a captured SWO stream into a Chrome/Perfetto trace.
+
+The firmware (Inc/Trace.h) writes one 32 bit word per event to the ITM
+stimulus port of its kind: the id in the top byte, the cycle counter >> 4
+below. Values follow their stamp on a port of their own. The stamps are
+unwrapped into a continuous time, which needs an event at least every 4 s;
+the control timer interrupt alone gives ten per second.
+
+Tasks of the main loop and interrupt handlers become slices on two tracks,
+values become counters. Open the JSON in https://ui.perfetto.dev or
+chrome://tracing. A summary of the time spent per task and interrupt is
+printed as well.
+
+The input is the raw ITM byte stream: from a debugger (SWV capture to a file,
+e.g. OpenOCD "tpiu config ... file") or from a USB UART on PB3 at 2 Mbaud,
+or from the simulation (Tools/Sim, --trace).
+
+Example:
+  python3 Tools/swo2perfetto.py capture.swo --json trace.json
+"""
+
+import argparse
+import json
+import sys
+
+STAMP_SHIFT = 4  # TRACE_STAMP_SHIFT
+STAMP_BITS = 24
+PORT_TASK_BEGIN, PORT_TASK_END, PORT_ISR_ENTER, PORT_ISR_EXIT, PORT_VALUE, PORT_VALUE_DATA = range(1, 7)
+TASK_EVENTS = 0x7F  # TRACE_TASK_EVENTS
+ISRS = ('zero cross', 'input', 'gate', 'sensor timer', 'spi', 'spi dma', 'control', 'telemetry',
+        'i2c', 'i2c error', 'i2c dma', 'systick')  # TRACE_ISR_t
+VALUES = (('temprature', 0.01), ('setpoint', 0.01), ('air setpoint', 0.01), ('power', 1), ('stack', 1))  # TRACE_VALUE_t
+TRACK_MAIN, TRACK_ISR = 1, 2
+
+
+def packets(data):
+    """Yields (port, size, payload) of the instrumentation packets, skips the rest."""
+    i = 0
+    while i < len(data):
+        header = data[i]
+        i += 1
+        size = header & 0x03
+        if size == 0:
+            # Sync (0x00 ... 0x80) and overflow, timestamp and extension packets may have continuation bytes
+            if header not in (0x00, 0x70, 0x80) and header & 0x80:
+                while i < len(data) and data[i] & 0x80:
+                    i += 1
+                i += 1
+            continue
+        size = 4 if size == 3 else size
+        if i + size > len(data):
+            return
+        payload = int.from_bytes(data[i:i + size], 'little')
+        i += size
+        # Hardware source packets (DWT) have bit 2 set
+        if not header & 0x04:
+            yield header >> 3, size, payload
+
+
+class Converter:
+    def __init__(self, tasks, mhz):
+        self.tasks = tasks
+        self.ticks_per_us = mhz / (1 << STAMP_SHIFT)
+        self.last = None
+        self.time = 0
+        self.events = []
+        self.open = {}  # (track, id) -> start time
+        self.value = None
+        self.totals = {}
+        self.unmatched = 0
+
+    def stamp(self, word):
+        """Returns the time in µs of a stamp, unwrapped against the previous one."""
+        ticks = word & ((1 << STAMP_BITS) - 1)
+        if self.last is not None:
+            self.time += (ticks - self.last) & ((1 << STAMP_BITS) - 1)
+        self.last = ticks
+        return self.time / self.ticks_per_us
+
+    def name(self, track, id):
+        if track == TRACK_ISR:
+            return ISRS[id] if id < len(ISRS) else 'isr %d' % id
+        if id == TASK_EVENTS:
+            return 'events'
+        return self.tasks[id] if id < len(self.tasks) else 'task %d' % id
+
+    def begin(self, track, id, time):
+        if (track, id) in self.open:
+            self.unmatched += 1
+        self.open[(track, id)] = time
+
+    def end(self, track, id, time):
+        start = self.open.pop((track, id), None)
+        if start is None:
+            self.unmatched += 1
+            return
+        name = self.name(track, id)
+        self.events.append({'name': name, 'ph': 'X', 'ts': start, 'dur': time - start, 'pid': 1, 'tid': track})
+        total = self.totals.setdefault(name, [0, 0.0, 0.0])
+        total[0] += 1
+        total[1] += time - start
+        total[2] = max(total[2], time - start)
+
+    def feed(self, port, size, payload):
+        if port == PORT_VALUE_DATA:
+            if self.value is not None and size == 4:
+                id, time = self.value
+                name, scale = VALUES[id] if id < len(VALUES) else ('value %d' % id, 1)
+                value = payload - (1 << 32) if payload & 0x80000000 else payload
+                self.events.append({'name': name, 'ph': 'C', 'ts': time, 'pid': 1, 'args': {name: value * scale}})
+            self.value = None
+            return
+        if size != 4 or not PORT_TASK_BEGIN <= port <= PORT_VALUE:
+            return
+        # A value whose data got dropped
+        self.value = None
+        id = payload >> 24
+        time = self.stamp(payload)
+        if port == PORT_TASK_BEGIN:
+            self.begin(TRACK_MAIN, id, time)
+        elif port == PORT_TASK_END:
+            self.end(TRACK_MAIN, id, time)
+        elif port == PORT_ISR_ENTER:
+            self.begin(TRACK_ISR, id, time)
+        elif port == PORT_ISR_EXIT:
+            self.end(TRACK_ISR, id, time)
+        else:
+            self.value = (id, time)
+
+    def trace(self):
+        meta = [{'name': 'process_name', 'ph': 'M', 'pid': 1, 'args': {'name': 'Reflow'}},
+                {'name': 'thread_name', 'ph': 'M', 'pid': 1, 'tid': TRACK_MAIN, 'args': {'name': 'main loop'}},
+                {'name': 'thread_name', 'ph': 'M', 'pid': 1, 'tid': TRACK_ISR, 'args': {'name': 'interrupts'}}]
+        return {'traceEvents': meta + self.events, 'displayTimeUnit': 'ns'}
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split('\n')[1])
+    parser.add_argument('capture', help='raw ITM byte stream')
+    parser.add_argument('--json', help='trace to write, stdout by default')
+    parser.add_argument('--tasks', default='ui,stack,settings', help='scheduler task names in order of addTask, comma separated')
+    parser.add_argument('--mhz', type=float, default=64, help='core clock')
+    parser.add_argument('--strict', action='store_true', help='exit with 1 on unmatched begin/end events')
+    args = parser.parse_args()
+
+    with open(args.capture, 'rb') as f:
+        data = f.read()
+    converter = Converter(args.tasks.split(','), args.mhz)
+    for port, size, payload in packets(data):
+        converter.feed(port, size, payload)
+
+    out = open(args.json, 'w') if args.json else sys.stdout
+    json.dump(converter.trace(), out)
+    if out is not sys.stdout:
+        out.close()
+
+    span = converter.time / converter.ticks_per_us
+    print('%-14s %8s %12s %10s %10s %7s' % ('', 'count', 'total ms', 'avg µs', 'max µs', 'load'), file=sys.stderr)
+    for name, (count, total, worst) in sorted(converter.totals.items(), key=lambda t: -t[1][1]):
+        print('%-14s %8d %12.2f %10.2f %10.2f %6.2f%%' % (name, count, total / 1000, total / count, worst,
+              100 * total / span if span else 0), file=sys.stderr)
+    print('%.3f s traced, %d events, %d unmatched' % (span / 1e6, len(converter.events), converter.unmatched),
+          file=sys.stderr)
+    if args.strict and (converter.unmatched or not converter.events):
+        sys.exit(1)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,200 @@
+#!/usr/bin/env python3
+###############################################################################
+# Copyright (C) 2019 Julian Hellner - All Rights Reserved
+#
+# The file telemetry_decode.py is part of Reflow.
+#
+# Unauthorized copying of this file, via any medium is strictly prohibited
+# Proprietary and confidential
+#
+###############################################################################
+"""
+Decodes the binary telemetry stream of the controller to CSV.
+
+Every frame is a packed TELEMETRY_FRAME_t (Inc/Telemetry.h) and its
+CRC-16/CCITT-FALSE, COBS encoded and ended by a 0x00 byte. Frames with a bad
+CRC, length or version are skipped, gaps in the sequence number show frames
+the controller dropped or the receiver lost.
+
+The CSV has one typed column per field, missing values are left empty:
+  time      s since the first frame
+  tick      ms, HAL_GetTick of the controller
+  sequence  frame counter
+  measured  °C, filtered sensor 1 (air)
+  board     °C, filtered sensor 2 (board)
+  setpoint  °C
+  power     %, heater output
+  state     OFF, BAKE, REFLOW or AUTOTUNE
+  profile   curve id while a profile runs
+  piece     piece of the profile trajectory
+so it can be fed to Tools/ff_fit.py or loaded into pandas/Parquet as is.
+
+Examples:
+  python3 Tools/telemetry_decode.py --port /dev/ttyUSB0 --csv run.csv
+  python3 Tools/telemetry_decode.py capture.bin --csv run.csv --parquet run.parquet
+"""
+
+import argparse
+import csv
+import struct
+import sys
+
+VERSION = 1  # TELEMETRY_VERSION
+FRAME = struct.Struct('<BHIHHHBBBB')  # TELEMETRY_FRAME_t
+NO_READING = 0xFFFF  # TELEMETRY_NO_READING
+NO_PROFILE = 0xFF  # TELEMETRY_NO_PROFILE
+STATES = ('OFF', 'BAKE', 'REFLOW', 'AUTOTUNE')  # STATE_t
+COLUMNS = ('time', 'tick', 'sequence', 'measured', 'board', 'setpoint', 'power', 'state', 'profile', 'piece')
+
+
+def crc16(data):
+    """Returns the CRC-16/CCITT-FALSE of data, same as Telemetry.cpp."""
+    crc = 0xFFFF
+    for byte in data:
+        crc ^= byte << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021 if crc & 0x8000 else crc << 1) & 0xFFFF
+    return crc
+
+
+def cobs_decode(data):
+    """Returns the decoded bytes, None when the encoding is broken."""
+    out = bytearray()
+    i = 0
+    while i < len(data):
+        code = data[i]
+        if code == 0 or i + code > len(data):
+            return None
+        out += data[i + 1:i + code]
+        i += code
+        if code < 0xFF and i < len(data):
+            out.append(0)
+    return bytes(out)
+
+
+class Decoder:
+    """Splits a byte stream into frames and keeps the error counts."""
+
+    def __init__(self):
+        self.pending = bytearray()
+        self.frames = 0
+        self.errors = 0
+        self.lost = 0
+        self.sequence = None
+        self.first_tick = None
+
+    def feed(self, data):
+        """Returns the rows of the frames completed by data."""
+        rows = []
+        self.pending += data
+        while True:
+            end = self.pending.find(0)
+            if end < 0:
+                return rows
+            encoded = bytes(self.pending[:end])
+            del self.pending[:end + 1]
+            if encoded:
+                row = self.decode(encoded)
+                if row is not None:
+                    rows.append(row)
+
+    def decode(self, encoded):
+        raw = cobs_decode(encoded)
+        if raw is None or len(raw) != FRAME.size + 2 or raw[0] != VERSION:
+            self.errors += 1
+            return None
+        if crc16(raw[:FRAME.size]) != struct.unpack_from('<H', raw, FRAME.size)[0]:
+            self.errors += 1
+            return None
+
+        version, sequence, tick, air, board, setpoint, power, state, profile, piece = FRAME.unpack_from(raw)
+        if self.sequence is not None:
+            self.lost += (sequence - self.sequence - 1) & 0xFFFF
+        self.sequence = sequence
+        if self.first_tick is None:
+            self.first_tick = tick
+        self.frames += 1
+
+        return {
+            'time': ((tick - self.first_tick) & 0xFFFFFFFF) / 1000.0,
+            'tick': tick,
+            'sequence': sequence,
+            'measured': None if air == NO_READING else air / 100.0,
+            'board': None if board == NO_READING else board / 100.0,
+            'setpoint': setpoint / 100.0,
+            'power': power,
+            'state': STATES[state] if state < len(STATES) else str(state),
+            'profile': None if profile == NO_PROFILE else profile,
+            'piece': None if profile == NO_PROFILE else piece,
+        }
+
+
+def source(args):
+    """Yields chunks of the stream from the serial port or the file."""
+    if args.port:
+        try:
+            import serial
+        except ImportError:
+            sys.exit('--port needs pyserial (pip install pyserial)')
+        with serial.Serial(args.port, args.baud, timeout=1) as port:
+            while True:
+                yield port.read(256)
+    else:
+        with (sys.stdin.buffer if args.input == '-' else open(args.input, 'rb')) as f:
+            while True:
+                chunk = f.read(4096)
+                if not chunk:
+                    return
+                yield chunk
+
+
+def write_parquet(path, rows):
+    try:
+        import pyarrow
+        import pyarrow.parquet
+    except ImportError:
+        sys.exit('--parquet needs pyarrow (pip install pyarrow)')
+    types = {'time': pyarrow.float64(), 'tick': pyarrow.uint32(), 'sequence': pyarrow.uint16(),
+             'measured': pyarrow.float32(), 'board': pyarrow.float32(), 'setpoint': pyarrow.float32(),
+             'power': pyarrow.uint8(), 'state': pyarrow.string(), 'profile': pyarrow.uint8(), 'piece': pyarrow.uint8()}
+    table = pyarrow.table({c: pyarrow.array([row[c] for row in rows], type=types[c]) for c in COLUMNS})
+    pyarrow.parquet.write_table(table, path)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split('\n')[1])
+    parser.add_argument('input', nargs='?', default='-', help='captured stream, - for stdin')
+    parser.add_argument('--port', help='read from this serial port instead, until Ctrl-C')
+    parser.add_argument('--baud', type=int, default=115200, help='baud rate of the port (TELEMETRY_BAUDRATE)')
+    parser.add_argument('--csv', help='CSV to write, stdout by default')
+    parser.add_argument('--parquet', help='also write a Parquet file, needs pyarrow')
+    parser.add_argument('--strict', action='store_true', help='exit with 1 on bad or lost frames')
+    args = parser.parse_args()
+
+    decoder = Decoder()
+    rows = []
+    out = open(args.csv, 'w', newline='') if args.csv else sys.stdout
+    writer = csv.DictWriter(out, COLUMNS)
+    writer.writeheader()
+    try:
+        for chunk in source(args):
+            for row in decoder.feed(chunk):
+                writer.writerow({c: '' if row[c] is None else row[c] for c in COLUMNS})
+                if args.parquet:
+                    rows.append(row)
+            if args.port:
+                out.flush()
+    except KeyboardInterrupt:
+        pass
+    if out is not sys.stdout:
+        out.close()
+    if args.parquet:
+        write_parquet(args.parquet, rows)
+
+    print('%d frames, %d bad, %d lost' % (decoder.frames, decoder.errors, decoder.lost), file=sys.stderr)
+    if args.strict and (decoder.errors or decoder.lost or not decoder.frames):
+        sys.exit(1)
+
+
+if __name__ == '__main__':
+    main()